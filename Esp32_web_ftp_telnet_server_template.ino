@@ -61,13 +61,16 @@ measurements httpRequestCount (60);         // measure how many web connections
 measurements rssi (60);                     // measure WiFi signal quality
 // ...
 
+#include "./servers/CoroutineTcpServer.hpp"             // coroutine versions of Example 10 and Example 11, C++20 compilers only
 #include "examples.h" // Example 07, Example 08, Example 09, Example 10, Example 11
 
 
 #include "./servers/webServer.hpp"                      // Web server
 httpServer  *httpSrv = NULL;                            // pointer to Web server
-String httpRequestHandler (String& httpRequest);
-void wsRequestHandler (String& wsRequest, WebSocket *webSocket);
+String httpRequestHandler (HttpRequest& httpRequest);
+HttpRoutes httpRoutes;                                  // REST functions of this sketch ...
+bool addHttpRoutes ();                                  // ... added here
+void wsRequestHandler (HttpRequest& wsRequest, WebSocket *webSocket);
 String startWebServer () {
   if (getWiFiMode () == WIFI_OFF) {
     webDmesg ("Could not start HTTP server since there is no network.");
@@ -75,12 +78,25 @@ String startWebServer () {
   }
  
   if (!httpSrv) {
+    if (!httpRoutes.count ()) addHttpRoutes ();         // routes are added only once, before the first server uses them
     httpSrv = new httpServer (httpRequestHandler,         // a callback function that will handle HTTP requests that are not handled by webServer itself
                               wsRequestHandler,           // a callback function that will handle WS requests, NULL to ignore WS requests
                               8192,                       // 8 KB stack size is usually enough, if httpRequestHandler uses more stack increase this value until server is stable
                               (char *) "0.0.0.0",         // start HTTP server on all available ip addresses
                               80,                         // HTTP port
-                              NULL);                      // we won't use firewall callback function for HTTP server
+                              NULL,                       // we won't use firewall callback function for HTTP server
+                              NULL,                       // ... nor firewall rules
+                              TcpTaskPolicy (portNUM_PROCESSORS - 1,     // run event loop on the last core (APP_CPU), away from WiFi stack on core 0 ...
+                                             TCP_ROUND_ROBIN_CORES)); // ... and spread request handler threads over all the cores
+    if (httpSrv && httpSrv->started ()) {
+      httpSrv->setRoutes (&httpRoutes);                         // ask httpRoutes for replies that httpRequestHandler doesn't provide
+      httpSrv->setAdmissionControl (16,                         // run at most 16 request handler threads at the same time
+                                    4,                          // at most 4 of them may come from the same IP
+                                    32768,                      // keep at least 32 KB of heap free for the rest of the system
+                                    TcpAdmissionControl::REPLY);// reply with 503 to requests that exceed limits, TcpAdmissionControl::QUEUE would leave them waiting instead
+      httpSrv->setRateLimit (10,                                // each client IP may open 10 connections per second ...
+                             20);                               // ... after a burst of 20 (a page with its pictures), faster connections are reset
+    }
     if (httpSrv)
       if (httpSrv->started ())                                    return "HTTP server started.";  
       else                    { delete (httpSrv); httpSrv = NULL; return "Could not start HTTP server."; }
@@ -91,102 +107,111 @@ String stopWebServer () {
   if (httpSrv) { delete (httpSrv); httpSrv = NULL; return "HTTP server stopped. Active connections will continue to run anyway."; } 
   else                                             return "HTTP server is not running.";
 }
-String httpRequestHandler (String& httpRequest) { // - normally httpRequest is HTTP request, webSocket is NULL, function returns a reply in HTML, json, ... formats or "" if request is unhandeled
+String httpRequestHandler (HttpRequest& httpRequest) { // - normally httpRequest is HTTP request, webSocket is NULL, function returns a reply in HTML, json, ... formats or "" if request is unhandeled
                                                   // httpRequestHandler is supposed to be used with smaller replies,
                                                   // if you want to reply with larger pages you may consider FTP-ing .html files onto the file system (/var/www/html/ by default)
                                                   // - has to be reentrant!
+                                                  // - it is asked before httpRoutes, REST functions are easier to add to httpRoutes below (addHttpRoutes)
 
   // ----- just a demonstration - delete this code if it is not needed -----
 
   httpRequestCount.increaseCounter ();                            // gether some statistics
 
+  // ----- HTTP request has not been handled by httpRequestHandler - let httpRoutes and then webServer try to handle it -----
+
+  return ""; 
+}
+bool addHttpRoutes () { // adds REST functions to httpRoutes once, before web server starts, so that each request finds its route handler in one look-up per path segment
+                        // - route handlers have to be reentrant!
+                        // - {value} path segment matches anything, route handler reads it with httpRequest.getPathParameter ("value")
+
+  // ----- just a demonstration - delete the routes that are not needed -----
+
   // example05 variables
   static String niceSwitch1 = "false";  
   static int niceSlider3 = 3;
   static String niceRadio5 = "fm";
 
+  static HttpRouteHandler getBuiltInLed = [] (HttpRequest& httpRequest) -> String { return "{\"id\":\"" + String (HOSTNAME) + "\",\"builtInLed\":\"" + (digitalRead (2) ? String ("on") : String ("off")) + "\"}\r\n"; };
+
+  bool routesAdded = true;
+
   // ----- handle HTTP protocol requests -----
-  
-       if (httpRequest.substring (0, 20) == "GET /example01.html ")       { // used by Example 01
+
+  routesAdded &= httpRoutes.add ("GET", "/example01.html",          [] (HttpRequest& httpRequest) -> String { // used by Example 01
                                                                             return String ("<HTML>Example 01 - dynamic HTML page<br><br><hr />") + (digitalRead (2) ? "Led is on." : "Led is off.") + String ("<hr /></HTML>");
-                                                                          }
-  else if (httpRequest.substring (0, 16) == "GET /builtInLed ")           { // used by Example 02, Example 03, Example 04, index.html
-                                                                          getBuiltInLed:
-                                                                            return "{\"id\":\"" + String (HOSTNAME) + "\",\"builtInLed\":\"" + (digitalRead (2) ? String ("on") : String ("off")) + "\"}\r\n";
-                                                                          }                                                                    
-  else if (httpRequest.substring (0, 19) == "PUT /builtInLed/on ")        { // used by Example 03, Example 04
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/builtInLed",              [] (HttpRequest& httpRequest) -> String { // used by Example 02, Example 03, Example 04, index.html
+                                                                            return getBuiltInLed (httpRequest);
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/builtInLed/on",           [] (HttpRequest& httpRequest) -> String { // used by Example 03, Example 04
                                                                             digitalWrite (2, HIGH);
-                                                                            goto getBuiltInLed;
-                                                                          }
-  else if (httpRequest.substring (0, 20) == "PUT /builtInLed/off ")       { // used by Example 03, Example 04, index.html
+                                                                            return getBuiltInLed (httpRequest);
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/builtInLed/off",          [] (HttpRequest& httpRequest) -> String { // used by Example 03, Example 04, index.html
                                                                             digitalWrite (2, LOW);
-                                                                            goto getBuiltInLed;
-                                                                          }
-  else if (httpRequest.substring (0, 12) == "GET /upTime ")               { // used by index.html
+                                                                            return getBuiltInLed (httpRequest);
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/upTime",                  [] (HttpRequest& httpRequest) -> String { // used by index.html
                                                                             unsigned long long l = millis () / 1000; // counts up to 50 days
                                                                             if (rtc.isGmtTimeSet ()) l = rtc.getGmtTime () - rtc.getGmtStartupTime (); // correct timing
-                                                                            // int s = l % 60;
-                                                                            // l /= 60;
-                                                                            // int m = l % 60;
-                                                                            // l /= 60;
-                                                                            // int h = l % 24;
-                                                                            // l /= 24;
-                                                                            // return "{\"id\":\"" + ESP_NAME_FOR_JSON + "\",\"upTime\":\"" + String ((int) l) + " days " + String (h) + " hours " + String (m) + " minutes " + String (s) + " seconds\"}";
                                                                             return "{\"id\":\"" + String (HOSTNAME) + "\",\"upTime\":\"" + String ((unsigned long) l) + " sec\"}\r\n";
-                                                                          }                                                                    
-  else if (httpRequest.substring (0, 14) == "GET /freeHeap ")             { // used by index.html
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/freeHeap",                [] (HttpRequest& httpRequest) -> String { // used by index.html
                                                                             return freeHeap.toJson (5);
-                                                                          }
-  else if (httpRequest.substring (0, 22) == "GET /httpRequestCount ")     { // used by index.html
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/httpRequestCount",        [] (HttpRequest& httpRequest) -> String { // used by index.html
                                                                             return httpRequestCount.toJson (5);
-                                                                          }
-  else if (httpRequest.substring (0, 10) == "GET /rssi ")                 { // used by index.html
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/rssi",                    [] (HttpRequest& httpRequest) -> String { // used by index.html
                                                                             return rssi.toJson (5);
-                                                                          }
-  else if (httpRequest.substring (0, 17) == "GET /niceSwitch1 ")          { // used by example05.html
-                                                                          returnNiceSwitch1State:
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/netstat",                 [] (HttpRequest& httpRequest) -> String { // live connections and server statistics, the same as telnet netstat command
+                                                                            return TcpConnectionRegistry::json ();
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/httpFileCache",           [] (HttpRequest& httpRequest) -> String { // hits, misses and evictions of web server's file cache
+                                                                            return httpFileCache.json ();
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/niceSwitch1",             [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             return "{\"id\":\"niceSwitch1\",\"value\":\"" + niceSwitch1 + "\"}"; // read switch state from variable or in some other way
-                                                                          }
-  else if (httpRequest.substring (0, 17) == "PUT /niceSwitch1/")          { // used by example05.html
-                                                                            niceSwitch1 = httpRequest.substring (17, 22); // "true " or "false"
-                                                                            niceSwitch1.trim ();
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceSwitch1/{value}",     [] (HttpRequest& httpRequest) -> String { // used by example05.html
+                                                                            niceSwitch1 = httpRequest.getPathParameter ("value").toString (); // "true" or "false"
                                                                             Serial.println ("[Got request from web browser for niceSwitch1]: " + niceSwitch1 + "\n");
-                                                                            goto returnNiceSwitch1State; // return success (or possible failure) back to the client
-                                                                          }
-  else if (httpRequest.substring (0, 25) == "PUT /niceButton2/pressed ")  { // used by example05.html
+                                                                            return "{\"id\":\"niceSwitch1\",\"value\":\"" + niceSwitch1 + "\"}"; // return success (or possible failure) back to the client
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceButton2/pressed",     [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             Serial.printf ("[Got request from web browser for niceButton2]: pressed\n");
                                                                             return "{\"id\":\"niceButton2\",\"value\":\"pressed\"}"; // the client will actually not use this return value at all but we must return something
-                                                                          }
-  else if (httpRequest.substring (0, 17) == "GET /niceSlider3 ")          { // used by example05.html
-                                                                          returnNiceSlider3Value:
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/niceSlider3",             [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             return "{\"id\":\"niceSlider3\",\"value\":\"" + String (niceSlider3) + "\"}"; // read slider value from variable or in some other way
-                                                                          }
-  else if (httpRequest.substring (0, 17) == "PUT /niceSlider3/")          { // used by example05.html
-                                                                            niceSlider3 = httpRequest.substring (17, 19).toInt (); // 0 .. 10
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceSlider3/{value}",     [] (HttpRequest& httpRequest) -> String { // used by example05.html
+                                                                            niceSlider3 = httpRequest.getPathParameter ("value").toInt (); // 0 .. 10
                                                                             Serial.printf ("[Got request from web browser for niceSlider3]: %i\n", niceSlider3);
-                                                                            goto returnNiceSlider3Value; // return success (or possible failure) back to the client
-                                                                          }
-  else if (httpRequest.substring (0, 25) == "PUT /niceButton4/pressed ")  { // used by example05.html
+                                                                            return "{\"id\":\"niceSlider3\",\"value\":\"" + String (niceSlider3) + "\"}"; // return success (or possible failure) back to the client
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceButton4/pressed",     [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             Serial.printf ("[Got request from web browser for niceButton4]: pressed\n");
                                                                             return "{\"id\":\"niceButton4\",\"value\":\"pressed\"}"; // the client will actually not use this return value at all but we must return something
-                                                                          }
-  else if (httpRequest.substring (0, 16) == "GET /niceRadio5 ")           { // used by example05.html
-                                                                          returnNiceRadio5Value:
+                                                                          });
+  routesAdded &= httpRoutes.add ("GET", "/niceRadio5",              [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             return "{\"id\":\"niceRadio5\",\"modulation\":\"" + niceRadio5 + "\"}"; // read radio button selection from variable or in some other way
-                                                                          }
-  else if (httpRequest.substring (0, 16) == "PUT /niceRadio5/")           { // used by example05.html
-                                                                            niceRadio5 = httpRequest.substring (16, 18); // "am", "fm"
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceRadio5/{value}",      [] (HttpRequest& httpRequest) -> String { // used by example05.html
+                                                                            niceRadio5 = httpRequest.getPathParameter ("value").toString (); // "am", "fm"
                                                                             Serial.printf ("[Got request from web browser for niceRadio5]: %s\n", niceRadio5.c_str ());
-                                                                            goto returnNiceRadio5Value; // return success (or possible failure) back to the client
-                                                                          }
-  else if (httpRequest.substring (0, 25) == "PUT /niceButton6/pressed ")  { // used by example05.html
+                                                                            return "{\"id\":\"niceRadio5\",\"modulation\":\"" + niceRadio5 + "\"}"; // return success (or possible failure) back to the client
+                                                                          });
+  routesAdded &= httpRoutes.add ("PUT", "/niceButton6/pressed",     [] (HttpRequest& httpRequest) -> String { // used by example05.html
                                                                             Serial.printf ("[Got request from web browser for niceButton6]: pressed\n");
                                                                             return "{\"id\":\"niceButton6\",\"value\":\"pressed\"}"; // the client will actually not use this return value at all but we must return something
-                                                                          }
+                                                                          });
 
   // ----- respond to GET /currentTime if you want to have a REST time server -----
 
-  else if (httpRequest.substring (0, 17) == "GET /currentTime ")          { 
+  routesAdded &= httpRoutes.add ("GET", "/currentTime",             [] (HttpRequest& httpRequest) -> String {
                                                                             if (rtc.isGmtTimeSet ()) {
                                                                               time_t tmp = rtc.getGmtTime ();
                                                                               while (tmp == rtc.getGmtTime ()) SPIFFSsafeDelay (1); // wait for second to end
@@ -195,24 +220,32 @@ String httpRequestHandler (String& httpRequest) { // - normally httpRequest is H
                                                                             } else {
                                                                               return ""; // let webServer return 404 - not found
                                                                             }
-                                                                          }
+                                                                          });
 
-  // ----- HTTP request has not been handled by httpRequestHandler - let the webServer try to handle it itself -----
-
-  else                                                                    return ""; 
+  if (!routesAdded) webDmesg ("[httpServer] could not add all HTTP routes.");
+  return routesAdded;
 }
-void wsRequestHandler (String& wsRequest, WebSocket *webSocket) { //     // - has to be reentrant!
+void wsRequestHandler (HttpRequest& wsRequest, WebSocket *webSocket) { //     // - has to be reentrant!
                                                                     
   // ----- handle WS (WebSockets) protocol requests -----
 
-       if (wsRequest.substring (0, 21) == "GET /runOscilloscope ")      runOscilloscope (webSocket);      // used by oscilloscope.html
-  else if (wsRequest.substring (0, 26) == "GET /example10_WebSockets ") example10_webSockets (webSocket); // used by Example 10
+       if (wsRequest.getPath () == "/runOscilloscope")      runOscilloscope (webSocket);      // used by oscilloscope.html
+  else if (wsRequest.getPath () == "/example10_WebSockets") example10_webSockets (webSocket); // used by Example 10
 }
 
-bool telnetAndFtpFirewall (char *IP) {          // firewall callback function, return true if IP is accepted or false if not
-                                                // - has to be reentrant!
-  if (!strcmp (IP, "10.0.0.2")) return false;   // block 10.0.0.2 (for some reason) ... please note that this is just an example
-  else                          return true;    // ... but let every other client through
+TcpFirewall telnetAndFtpFirewall;               // firewall rules for telnet and FTP servers, they are read from /etc/firewall.conf
+bool loadFirewallRules () {
+  String rules = readEntireTextFile ("/etc/firewall.conf");
+  if (rules == "") { // create /etc/firewall.conf if it doesn't exist
+    TcpDmesg ("[firewall] /etc/firewall.conf does not exist, creating new one.");
+    rules = "# firewall rules for telnet and FTP servers: allow|deny <IP>(/<prefix length>) or default allow|deny\r\n"
+            "# the most specific rule that matches client's IP decides, the default rule decides if no other rule matches\r\n"
+            "\r\n"
+            "default allow\r\n"
+            "deny 10.0.0.2     # block 10.0.0.2 (for some reason) ... please note that this is just an example\r\n";
+    if (!writeEntireFile (rules, "/etc/firewall.conf")) TcpDmesg ("[firewall] unable to create file /etc/firewall.conf.");
+  }
+  return telnetAndFtpFirewall.loadRules (rules);
 }
 
 
@@ -228,7 +261,8 @@ String startFtpServer () {
   if (!ftpSrv) {
     ftpSrv = new ftpServer ((char *) "0.0.0.0",         // start FTP server on all available ip addresses
                             21,                         // controll connection FTP port
-                            telnetAndFtpFirewall);      // use firewall callback function for FTP server or NULL
+                            NULL,                       // firewall callback function is not needed ...
+                            &telnetAndFtpFirewall);     // ... since rules from /etc/firewall.conf are used for FTP server, or NULL
     if (ftpSrv)
       if (ftpSrv->started ())                                   return "FTP server started.";  
       else                    { delete (ftpSrv); ftpSrv = NULL; return "Could not start FTP server."; }
@@ -256,7 +290,8 @@ String startTelnetServer () {
                                   8192,                 // 8 KB stack size is usually enough, if telnetCommandHanlder uses more stack increase this value until server is stable
                                   (char *) "0.0.0.0",   // start telnt server on all available ip addresses
                                   23,                   // telnet port
-                                  telnetAndFtpFirewall);// use firewall callback function for telnet server or NULL
+                                  NULL,                 // firewall callback function is not needed ...
+                                  &telnetAndFtpFirewall);// ... since rules from /etc/firewall.conf are used for telnet server, or NULL
     if (telnetSrv)
       if (telnetSrv->started ())                                        return "Telnet server started.";  
       else                      { delete (telnetSrv); telnetSrv = NULL; return "Could not start Telnet server."; }
@@ -291,6 +326,14 @@ String telnetCommandHandler (int argc, String argv [], String homeDirectory) { /
     if (homeDirectory == "/") return stopTelnetServer (); // note that the level of rights is determined by homeDirecory
     else                      return "You must have root rights to stop Telnet sever.";
 
+  // ----- firewall -----
+
+  } else if (argc == 1 && argv [0] == "firewall") {
+    return telnetAndFtpFirewall.listRules ();
+  } else if (argc == 2 && argv [0] == "firewall" && argv [1] == "reload") {
+    if (homeDirectory == "/") return loadFirewallRules () ? "Firewall rules reloaded from /etc/firewall.conf." : "Firewall rules in /etc/firewall.conf are not valid, see dmesg."; 
+    else                      return "You must have root rights to reload firewall rules.";
+
   } else if (argc == 3 && argv [0] == "ifconfig" && argv [1] == "AP" && argv [2] == "up") {
                               WiFi.mode (WIFI_AP_STA);
                               return "AP is up.";
@@ -375,6 +418,8 @@ void setup () {
 
   connectNetwork ();                              // network should be connected after file system is mounted since it reads its configuration from file system
 
+  loadFirewallRules ();                           // telnet and FTP servers use firewall rules from /etc/firewall.conf
+
   // listFilesOnFlashDrive ();
 
   startWebServer ();
@@ -11,6 +11,8 @@
  *            May, 20, 2019, Bojan Jurca
   *          - elimination of compiler warnings and some bugs
  *            Jun 10, 2020, Bojan Jurca            
+ *          - added coroutine versions of Example 10 and Example 11 (CoroutineTcpServer, C++20 compilers only)
+ *            October 16, 2026
  *  
  */
 
@@ -129,6 +131,17 @@ errorInCommunication:
     
 void morseEchoServerConnectionHandler (TcpConnection *connection, void *parameter); // connection handler callback function
 
+// Morse table is shared with coroutine version of example 11 below. It is static so it won't use the stack
+static const char *morse [43] = {"----- ", ".---- ", "..--- ", "...-- ", "....- ", // 0, 1, 2, 3, 4
+                                 "..... ", "-.... ", "--... ", "---.. ", "----. ", // 5, 6, 7, 8, 9
+                                 "   ", "", "", "", "", "", "",                    // space and some characters not in Morse table
+                                 ".- ", "-... ", "-.-. ", "-.. ", ". ",            // A, B, C, D, E
+                                 "..-. ", "--. ", ".... ", ".. ", ".--- ",         // F, G, H, I, J
+                                 "-.- ", ".-.. ", "-- ", "-. ", "--- ",            // K, L, M, N, O
+                                 ".--. ", "--.- ", ".-. ", "... ", "- ",           // P, Q, R, S, T
+                                 "..- ", "...- ", ".-- ", "-..- ", "-.-- ",        // U, V, W, X, Y
+                                 "--.. "};                                         // Z
+
 void example11_morseEchoServer () {
   if (getWiFiMode () == WIFI_OFF) {
     Serial.printf ("[%10lu] [example 11] Could not start Morse server since there is no network.\n", millis ());
@@ -164,16 +177,6 @@ void morseEchoServerConnectionHandler (TcpConnection *connection, void *paramete
   char inputBuffer [256] = {0}; // reserve some stack memory for incomming packets
   char outputBuffer [256] = {0}; // reserve some stack memory for output buffer 
   int bytesToSend;
-  // construct Morse table. Make it static so it won't use the stack
-  static const char *morse [43] = {"----- ", ".---- ", "..--- ", "...-- ", "....- ", // 0, 1, 2, 3, 4
-                                   "..... ", "-.... ", "--... ", "---.. ", "----. ", // 5, 6, 7, 8, 9
-                                   "   ", "", "", "", "", "", "",                    // space and some characters not in Morse table
-                                   ".- ", "-... ", "-.-. ", "-.. ", ". ",            // A, B, C, D, E
-                                   "..-. ", "--. ", ".... ", ".. ", ".--- ",         // F, G, H, I, J
-                                   "-.- ", ".-.. ", "-- ", "-. ", "--- ",            // K, L, M, N, O
-                                   ".--. ", "--.- ", ".-. ", "... ", "- ",           // P, Q, R, S, T
-                                   "..- ", "...- ", ".-- ", "-..- ", "-.-- ",        // U, V, W, X, Y
-                                   "--.. "};                                         // Z
   char finiteState = ' '; // finite state machine to detect quit, valid states are ' ', 'q', 'u', 'i', 't'
   unsigned char c;
   int index;  
@@ -255,3 +258,202 @@ endThisConnection: // first check if there is still some data in outputBuffer an
   }
   Serial.printf ("[%10lu] [example 11] connection has just ended\n", millis ());
 }
+
+
+#ifdef __cpp_impl_coroutine // CoroutineTcpServer needs C++20 compiler
+
+// Example 11 written as a coroutine - the same Morse echo server driven by CoroutineTcpServer. All the connections share one
+// event loop thread, instead of 4 KB stack each connection only costs its coroutine frame (about the size of inputBuffer 
+// and outputBuffer) - see host/benchmarks/coroutines.cpp. Call it instead of example11_morseEchoServer () to try it.
+
+coTask morseEchoServerCoroutine (CoroutineTcpConnection *connection, void *parameter); // connection handler coroutine
+
+void example11_coroutineMorseEchoServer () {
+  if (getWiFiMode () == WIFI_OFF) {
+    Serial.printf ("[%10lu] [example 11] Could not start Morse server since there is no network.\n", millis ());
+    return;
+  }
+  
+  // start new coroutine TCP server
+  CoroutineTcpServer *myServer = new CoroutineTcpServer (morseEchoServerCoroutine,   // coroutine that is going to handle the connections
+                                                         NULL,                       // no additional parameter will be passed to morseEchoServerCoroutine
+                                                         180000,                     // time-out - close connection if it is inactive for more than 3 minutes
+                                                         (char *) "0.0.0.0",         // serverIP, 0.0.0.0 means that the server will accept connections on all available IP addresses
+                                                         24,                         // server port number, 
+                                                         NULL);                      // don't use firewall in this example
+  // check success
+  if (myServer->started ()) {
+    Serial.printf ("[%10lu] [example 11] coroutine Morse echo server started, try \"telnet <server IP> 24\" to try it\n", millis ());
+  
+    // let the server run for 30 seconds - this much time you have to connect to it to test how it works
+    SPIFFSsafeDelay (30000);
+  
+    // shut down the server - unlike threaded TcpServer this also ends active connections since they run in server's event loop
+    delete (myServer);
+    Serial.printf ("[%10lu] [example 11] coroutine Morse echo server stopped\n", millis ());
+  } else {
+    Serial.printf ("[%10lu] [example 11] unable to start coroutine Morse echo server\n", millis ());
+  }
+}
+
+coTask morseEchoServerCoroutine (CoroutineTcpConnection *connection, void *parameterNotUsed) { // connection handler coroutine
+  Serial.printf ("[%10lu] [example 11] new connection arrived from %s\n", millis (), connection->getOtherSideIP ());
+  
+  char inputBuffer [256] = {0}; // buffers live in coroutine frame now
+  char outputBuffer [256] = {0};
+  int bytesToSend;
+  char finiteState = ' '; // finite state machine to detect quit, valid states are ' ', 'q', 'u', 'i', 't'
+  
+  // send welcome reply first as soon as new connection arrives - in a readable form
+  sprintf (outputBuffer, "Type anything except quit. Quit will end the connection.%c%c%c\r\n", IAC, DONT, ECHO); 
+  bytesToSend = strlen (outputBuffer);
+  if (co_await connection->sendData (outputBuffer, bytesToSend) != bytesToSend) {
+    Serial.printf ("[%10lu] [example 11] error while sending response\n", millis ());
+    co_return;
+  }
+  *outputBuffer = 0; // mark outputBuffer as empty
+  
+  // Read and process input stream until "quit" substring arrives or 0 bytes are received (connection has ended).
+  while (int received = co_await connection->recvData (inputBuffer, sizeof (inputBuffer))) {
+    for (int i = 0; i < received; i ++) {
+      // calculate index of morse table entry
+      unsigned char c = inputBuffer [i];
+      int index = 11;                                 // no character in morse table
+      if (c == ' ') index = 10;                       // space in morse table
+      else if (c >= '0' && c <= 'Z') index = c - '0'; // letter in morse table
+      else if (c >= 'a' && c <= 'z') index = c - 80;  // letter converted to upper case in morse table
+
+      // fill outputBuffer if there is still some space left otherwise empty it
+      if (strlen (outputBuffer) + 7 > sizeof (outputBuffer)) {
+        bytesToSend = strlen (outputBuffer);
+  if (co_await connection->sendData (outputBuffer, bytesToSend) != bytesToSend) {
+          Serial.printf ("[%10lu] [example 11] error while sending response\n", millis ());
+          co_return;
+        }
+        strcpy (outputBuffer, morse [index]); // start filling outputBuffer with morse letter
+      } else {
+        strcat (outputBuffer, morse [index]); // append morse letter to outputBuffer
+      }
+
+      // calculat finite machine state to detect if "quit" has been entered
+      switch (c) {
+        case 'Q':
+        case 'q': finiteState = 'q';
+                  break;
+        case 'U':
+        case 'u': if (finiteState == 'q') finiteState = 'u'; else finiteState = ' ';
+                  break;
+        case 'I':
+        case 'i': if (finiteState == 'u') finiteState = 'i'; else finiteState = ' ';
+                  break;
+        case 'T':
+        case 't': if (finiteState == 'i') { // quit has been entered, send what is left in outputBuffer and end the connection
+                    bytesToSend = strlen (outputBuffer);
+                    if (co_await connection->sendData (outputBuffer, bytesToSend) != bytesToSend) Serial.printf ("[%10lu] [example 11] error while sending response\n", millis ());
+                    Serial.printf ("[%10lu] [example 11] connection has just ended\n", millis ());
+                    co_return;
+                  }
+                  finiteState = ' ';
+                  break; 
+        default:  finiteState = ' ';
+                  break;
+      }
+    } // for loop
+    bytesToSend = strlen (outputBuffer);
+  if (co_await connection->sendData (outputBuffer, bytesToSend) != bytesToSend) {
+      Serial.printf ("[%10lu] [example 11] error while sending response\n", millis ());
+      co_return;
+    }    
+    *outputBuffer = 0; // mark outputBuffer as empty
+  } // while loop
+  Serial.printf ("[%10lu] [example 11] connection has just ended\n", millis ());
+}
+
+
+// Example 10 written as a coroutine - WebSocket server that talks to example10.html the same way example10_webSockets () does, but
+// the connection, from HTTP request to the last frame, is handled by a coroutine in CoroutineTcpServer event loop. Only small 
+// (up to 125 bytes) and medium frames that fit into the buffer are supported. Change ws://self.location.host in example10.html to
+// ws://<server IP>:81 to try it.
+
+coTask webSocketsCoroutine (CoroutineTcpConnection *connection, void *parameter); // connection handler coroutine
+
+CoroutineTcpServer *example10_coroutineWebSockets () { // starts coroutine WebSocket server on port 81 and returns it, delete it to stop the server
+  CoroutineTcpServer *myServer = new CoroutineTcpServer (webSocketsCoroutine,        // coroutine that is going to handle the connections
+                                                         NULL,                       // no additional parameter will be passed to webSocketsCoroutine
+                                                         300000,                     // time-out - 5 minutes like WebSockets of httpServer
+                                                         (char *) "0.0.0.0",         // serverIP, 0.0.0.0 means that the server will accept connections on all available IP addresses
+                                                         81,                         // server port number
+                                                         NULL);                      // don't use firewall in this example
+  if (myServer->started ()) {
+    Serial.printf ("[%10lu] [example 10] coroutine WebSocket server started on port 81\n", millis ());
+  } else {
+    Serial.printf ("[%10lu] [example 10] unable to start coroutine WebSocket server\n", millis ());
+  }
+  return myServer;
+}
+
+coTask webSocketsCoroutine (CoroutineTcpConnection *connection, void *parameterNotUsed) {
+  char buffer [512]; // HTTP request first, then payloads of WebSocket frames
+  byte header [8];   // WebSocket frame header: 2 bytes, 2 bytes of medium payload length (if present) and 4 bytes of mask
+  int length = 0;
+
+  // read HTTP request and reply with WebSocket handshake
+  do {
+    int received = co_await connection->recvData (buffer + length, sizeof (buffer) - 1 - length);
+    if (!received) co_return;
+    buffer [length += received] = 0;
+    if (length == sizeof (buffer) - 1) co_return; // HTTP request is too long
+  } while (!strstr (buffer, "\r\n\r\n"));
+  {
+    char acceptKey [32];
+    if (strncmp (buffer, "GET /example10_WebSockets ", 26) || !webSocketAcceptKey (buffer, acceptKey)) co_return;
+    sprintf (buffer, "HTTP/1.1 101 Switching Protocols \r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", acceptKey);
+  }
+  if (!co_await connection->sendData (buffer)) co_return;
+
+  // read frames
+  while (true) {
+    if (co_await connection->recvAll ((char *) header, 6) != 6) co_return; // connection has ended
+    byte opcode = header [0] & 0b00001111; // 1 = text, 2 = binary, 8 = close
+    if (opcode == WebSocket::CLOSE) {
+      Serial.printf ("[%10lu] [example 10] browser requested to close webSocket\n", millis ());
+      co_return;
+    }
+    if (!(header [0] & 0b10000000) || (opcode != WebSocket::STRING && opcode != WebSocket::BINARY)) goto errorInCommunication; // fragmented or control frames are not supported
+    length = header [1] & 0b01111111; // mask bit is always set in frames that come from browsers, cut it off
+    byte *mask = header + 2;
+    if (length == 126) { // medium payload, read additional 2 bytes of header
+      if (co_await connection->recvAll ((char *) header + 6, 2) != 2) co_return;
+      length = header [2] << 8 | header [3];
+      mask = header + 4;
+    }
+    if (length >= (int) sizeof (buffer)) goto errorInCommunication; // large payloads don't fit into the buffer
+    if (co_await connection->recvAll (buffer, length) != length) co_return;
+    for (int i = 0; i < length; i++) buffer [i] ^= mask [i % 4];
+    buffer [length] = 0;
+
+    if (opcode == WebSocket::STRING) { // text received
+      Serial.printf ("[%10lu] [example 10] got text from browser over webSocket: %s\n", millis (), buffer);
+    } else { // binary data received
+      Serial.printf ("[%10lu] [example 10] got %i bytes of binary data from browser over webSocket\n", millis (), length);
+      // like in example 10 we'll just assume that binary data is array of 16 bit integers
+      int16_t *i = (int16_t *) buffer;
+      while ((char *) (i + 1) <= buffer + length) Serial.printf (" %i", *i ++);
+      Serial.printf ("\n[%10lu] [example 10] if the sequence is -21 13 -8 5 -3 2 -1 1 0 1 1 2 3 5 8 13 21 34 55 89 144 233 377 610 987 1597 2584 4181 6765 10946 17711 28657\n"
+                       "             it means that both, endianness and complements are compatible with javascript client.\n", millis ());
+      // send text frame (short frames, no masking)
+      const char *text = "Thank you webSocket client, I'm sending back 8 32 bit binary floats.";
+      header [0] = 0b10000000 | WebSocket::STRING; header [1] = strlen (text);
+      if (!co_await connection->sendData ((char *) header, 2) || !co_await connection->sendData ((char *) text)) goto errorInCommunication;
+      // send binary frame
+      float geometricSequence [8] = {1.0}; for (int i = 1; i < 8; i++) geometricSequence [i] = geometricSequence [i - 1] / 2;
+      header [0] = 0b10000000 | WebSocket::BINARY; header [1] = sizeof (geometricSequence);
+      if (!co_await connection->sendData ((char *) header, 2) || !co_await connection->sendData ((char *) geometricSequence, sizeof (geometricSequence))) goto errorInCommunication;
+    }
+  }
+
+errorInCommunication:
+  Serial.printf ("[%10lu] [example 10] error in communication, closing connection\n", millis ());
+}
+
+#endif
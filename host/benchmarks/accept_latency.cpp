@@ -0,0 +1,72 @@
+/*
+ * accept_latency.cpp - measures TcpServer listener behaviour on host
+ *
+ *  - idle listener wake-ups: voluntary context switches per second while 4 threaded servers wait for connections,
+ *  - accept latency: time from client's connect () to the moment connection handler starts running.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <sys/resource.h>
+
+#include "TcpServer.hpp"
+
+volatile unsigned long handlerStartMicros = 0;
+
+void measuringConnectionHandler (TcpConnection *connection, void *parameter) {
+  handlerStartMicros = micros ();
+}
+
+int main (int argc, char *argv []) {
+  int connections = argc > 1 ? atoi (argv [1]) : 200;
+
+  TcpServer *servers [4];
+  for (int i = 0; i < 4; i++) {
+    servers [i] = new TcpServer (measuringConnectionHandler, NULL, 4096, 1000, (char *) "127.0.0.1", 19080 + i, NULL);
+    if (!servers [i]->started ()) { printf ("could not start server on port %i\n", 19080 + i); return 1; }
+  }
+
+  // idle wake-ups
+  struct rusage before, after;
+  getrusage (RUSAGE_SELF, &before);
+  unsigned long startMillis = millis ();
+  sleep (2);
+  getrusage (RUSAGE_SELF, &after);
+  double seconds = (millis () - startMillis) / 1000.0;
+  double cpuMillis = ((after.ru_utime.tv_sec - before.ru_utime.tv_sec) + (after.ru_stime.tv_sec - before.ru_stime.tv_sec)) * 1000.0 + ((after.ru_utime.tv_usec - before.ru_utime.tv_usec) + (after.ru_stime.tv_usec - before.ru_stime.tv_usec)) / 1000.0;
+  printf ("idle listeners:     4\n");
+  printf ("idle wake-ups:      %.0f / s\n", (after.ru_nvcsw - before.ru_nvcsw) / seconds);
+  printf ("idle CPU time:      %.1f ms / s\n", cpuMillis / seconds);
+
+  // accept latency
+  std::vector<unsigned long> latency;
+  for (int i = 0; i < connections; i++) {
+    handlerStartMicros = 0;
+    int s = socket (PF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons (19080);
+    a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    unsigned long connectMicros = micros ();
+    if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { printf ("connect error %i\n", errno); return 1; }
+    while (!handlerStartMicros && micros () - connectMicros < 1000000) sched_yield ();
+    if (handlerStartMicros) latency.push_back (handlerStartMicros - connectMicros);
+    close (s);
+    usleep (1000);
+  }
+  std::sort (latency.begin (), latency.end ());
+  if (latency.size ()) {
+    unsigned long sum = 0; for (auto l : latency) sum += l;
+    printf ("accept latency:     mean %lu us, p50 %lu us, p99 %lu us, max %lu us (%i connections)\n", sum / latency.size (), latency [latency.size () / 2], latency [latency.size () * 99 / 100], latency.back (), (int) latency.size ());
+  }
+
+  // shutdown
+  startMillis = millis ();
+  for (int i = 0; i < 4; i++) delete servers [i];
+  printf ("shutdown of 4 servers: %lu ms\n", millis () - startMillis);
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * connection_churn.cpp - measures how connection open / close scales with the number of parallel threads on host
+ *
+ *  - close path: each thread calls getThisSideIP () and closeConnection () on its own set of already established
+ *    connections, so the only thing threads could contend for is a lock shared by all the connections,
+ *  - open / close: client threads open short connections to threaded TcpServer whose handler asks for this side IP,
+ *    reads a small request and replies.
+ *  Both are run with 1, 2, 4 and 8 threads and report the total time (or rate) over all the connections: with no shared
+ *  lock time per connection should not grow with threads and it should shrink with threads up to the number of cores.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <thread>
+
+#include "TcpServer.hpp"
+
+#define CHURN_PORT 19093
+
+void churnConnectionHandler (TcpConnection *connection, void *parameter) {
+  char buffer [64];
+  if (*connection->getThisSideIP () && connection->recvData (buffer, sizeof (buffer)) > 0) connection->sendData ((char *) "OK\r\n");
+}
+
+// establishes connections to a plain listening socket and wraps the accepted sides into non-threaded TcpConnections
+bool establishConnections (int listeningSocket, int count, std::vector<TcpConnection *> *connections, std::vector<int> *clientSockets) {
+  struct sockaddr_in a = {};
+  socklen_t len = sizeof (a);
+  getsockname (listeningSocket, (struct sockaddr *) &a, &len);
+  for (int i = 0; i < count; i++) {
+    int c = socket (PF_INET, SOCK_STREAM, 0);
+    if (c == -1 || connect (c, (struct sockaddr *) &a, sizeof (a)) == -1) return false;
+    int s = accept (listeningSocket, NULL, NULL);
+    if (s == -1) return false;
+    clientSockets->push_back (c);
+    connections->push_back (new TcpConnection (s, (char *) "127.0.0.1", 60000));
+  }
+  return true;
+}
+
+void closePath (int listeningSocket, int threads, int connectionsPerThread) {
+  std::vector<std::vector<TcpConnection *>> connections (threads);
+  std::vector<int> clientSockets;
+  for (int i = 0; i < threads; i++) if (!establishConnections (listeningSocket, connectionsPerThread, &connections [i], &clientSockets)) { printf ("could not establish connections\n"); exit (1); }
+
+  std::vector<std::thread> workers;
+  std::atomic<int> ready (0);
+  std::atomic<bool> go (false);
+  for (int i = 0; i < threads; i++) workers.push_back (std::thread ([&, i] () {
+    ready ++;
+    while (!go);
+    for (auto c : connections [i]) {
+      for (int j = 0; j < 3; j++) if (!*c->getThisSideIP ()) { printf ("getThisSideIP () failed\n"); exit (1); }
+      c->closeConnection ();
+    }
+  }));
+  while (ready < threads);
+  unsigned long startMicros = micros ();
+  go = true;
+  for (auto &t : workers) t.join ();
+  unsigned long elapsed = micros () - startMicros;
+  printf ("  %i thread%s %8.0f ns per connection (3 x getThisSideIP + closeConnection)\n", threads, threads == 1 ? ": " : "s:", elapsed * 1000.0 / threads / connectionsPerThread);
+
+  for (auto &v : connections) for (auto c : v) delete c;
+  for (int c : clientSockets) close (c);
+}
+
+std::atomic<unsigned long> failedConnections;
+
+void openClose (int threads, int connectionsPerThread) {
+  failedConnections = 0;
+  std::vector<std::thread> clients;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < threads; i++) clients.push_back (std::thread ([=] () {
+    for (int j = 0; j < connectionsPerThread; j++) {
+      int s = socket (PF_INET, SOCK_STREAM, 0);
+      struct sockaddr_in a = {};
+      a.sin_family = AF_INET;
+      a.sin_port = htons (CHURN_PORT);
+      a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+      char buffer [64];
+      if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1 || send (s, "GET\r\n", 5, 0) != 5 || recv (s, buffer, sizeof (buffer), 0) <= 0) failedConnections ++;
+      close (s);
+    }
+  }));
+  for (auto &t : clients) t.join ();
+  double seconds = (micros () - startMicros) / 1000000.0;
+  printf ("  %i thread%s %8.0f connections / s (%lu failed)\n", threads, threads == 1 ? ": " : "s:", threads * connectionsPerThread / seconds, failedConnections.load ());
+}
+
+int main (int argc, char *argv []) {
+  int connectionsPerThread = argc > 1 ? atoi (argv [1]) : 500;
+
+  int listeningSocket = socket (PF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (listeningSocket == -1 || bind (listeningSocket, (struct sockaddr *) &a, sizeof (a)) == -1 || listen (listeningSocket, 128) == -1) { printf ("could not create listening socket\n"); return 1; }
+
+  printf ("close path\n");
+  for (int threads = 1; threads <= 8; threads *= 2) closePath (listeningSocket, threads, connectionsPerThread);
+  close (listeningSocket);
+
+  TcpServer *server = new TcpServer (churnConnectionHandler, NULL, 4096, 1000, (char *) "127.0.0.1", CHURN_PORT, NULL);
+  if (!server->started ()) { printf ("could not start server on port %i\n", CHURN_PORT); return 1; }
+  printf ("open / close\n");
+  for (int threads = 1; threads <= 8; threads *= 2) openClose (threads, connectionsPerThread);
+  delete server;
+  delay (100); // let the threads finish
+  return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * core_affinity.cpp - compares TcpTaskPolicy settings of threaded TcpServer on host
+ *
+ *  Client threads open short connections, each sends a small request and waits for a small reply (the same load as worker_pool).
+ *  The server runs with tasks floating between cores (the default), with everything pinned to core 0, with connection threads spread
+ *  round-robin and with one listener per core. Host build maps ESP32 core n to CPU n modulo the number of online CPUs, so the
+ *  results only differ on a machine with more than one CPU. Reported are connections per second, request latency and the CPUs
+ *  that connection threads have actually run on.
+ *
+ *  usage: core_affinity [connections]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+
+#include "TcpServer.hpp"
+
+#define MAX_CPUS 64
+
+std::atomic<unsigned long> connectionsOnCpu [MAX_CPUS];
+
+void echoConnectionHandler (TcpConnection *connection, void *parameter) {
+  int cpu = sched_getcpu ();
+  if (cpu >= 0 && cpu < MAX_CPUS) connectionsOnCpu [cpu] ++;
+  char buffer [64];
+  if (connection->recvData (buffer, sizeof (buffer)) > 0) connection->sendData ((char *) "OK\r\n");
+}
+
+std::atomic<unsigned long> failedConnections;
+
+void client (int port, int connections, std::vector<unsigned long> *latency) {
+  for (int i = 0; i < connections; i++) {
+    int s = socket (PF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons (port);
+    a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    unsigned long startMicros = micros ();
+    char buffer [64];
+    if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1 || send (s, "GET\r\n", 5, 0) != 5 || recv (s, buffer, sizeof (buffer), 0) <= 0) failedConnections ++;
+    else latency->push_back (micros () - startMicros);
+    close (s);
+  }
+}
+
+void run (const char *title, int port, const TcpTaskPolicy &taskPolicy, int clients, int connections) {
+  TcpServer *server = new TcpServer (echoConnectionHandler, NULL, 4096, 1000, (char *) "127.0.0.1", port, NULL, 0, 0, NULL, taskPolicy);
+  if (!server->started ()) { printf ("could not start server on port %i\n", port); exit (1); }
+  failedConnections = 0;
+  for (int i = 0; i < MAX_CPUS; i++) connectionsOnCpu [i] = 0;
+
+  std::vector<std::vector<unsigned long>> latency (clients);
+  std::vector<std::thread> clientThreads;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < clients; i++) clientThreads.push_back (std::thread (client, port, connections / clients, &latency [i]));
+  for (auto &t : clientThreads) t.join ();
+  double seconds = (micros () - startMicros) / 1000000.0;
+
+  std::vector<unsigned long> all;
+  for (auto &l : latency) all.insert (all.end (), l.begin (), l.end ());
+  std::sort (all.begin (), all.end ());
+  printf ("%s\n", title);
+  printf ("  listeners:        %u\n", server->getListenerCount ());
+  printf ("  connections:      %lu / s (%lu failed)\n", (unsigned long) (all.size () / seconds), failedConnections.load ());
+  if (all.size ()) printf ("  latency:          p50 %lu us, p99 %lu us\n", all [all.size () / 2], all [all.size () * 99 / 100]);
+  printf ("  connections on:  ");
+  for (int i = 0; i < MAX_CPUS; i++) if (connectionsOnCpu [i]) printf (" CPU %i: %lu", i, connectionsOnCpu [i].load ());
+  printf ("\n");
+  delete server;
+  delay (100); // let the threads finish
+}
+
+int main (int argc, char *argv []) {
+  int connections = argc > 1 ? atoi (argv [1]) : 4000;
+  int clients = 8;
+
+  printf ("%li online CPUs, ESP32 core n runs on CPU n %% %li\n", sysconf (_SC_NPROCESSORS_ONLN), sysconf (_SC_NPROCESSORS_ONLN));
+  run ("any core (default)", 19190, TcpTaskPolicy (), clients, connections);
+  run ("everything on core 0", 19191, TcpTaskPolicy (0, 0), clients, connections);
+  run ("listener on core 0, connections round-robin", 19192, TcpTaskPolicy (0, TCP_ROUND_ROBIN_CORES), clients, connections);
+  run ("listener per core, connections round-robin", 19193, TcpTaskPolicy (TCP_ANY_CORE, TCP_ROUND_ROBIN_CORES, tskNORMAL_PRIORITY, true), clients, connections);
+  return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * coroutines.cpp - compares memory per connection of thread-per-connection and coroutine versions of Example 10 and Example 11
+ *
+ *  - Morse echo: morseEchoServerConnectionHandler in threaded TcpServer (4 KB stack) and morseEchoServerCoroutine in CoroutineTcpServer,
+ *  - WebSocket: example10_webSockets in a request thread (8 KB stack, like httpServer of the sketch) and webSocketsCoroutine in
+ *    CoroutineTcpServer.
+ *  The given number of clients connect and wait idle after the welcome message (or WebSocket handshake). Reported is the drop of
+ *  simulated ESP32 free heap (which includes task stacks, see host/include/Arduino.h) per connection and an average round-trip
+ *  time of one request over all the connections. Needs C++20 (see Makefile), server messages go to stderr, results to stdout.
+ *
+ *  usage: coroutines [connections]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+
+#include "../../Esp32_web_ftp_telnet_server_template.ino"
+
+#define MORSE_THREADED_PORT     19024
+#define MORSE_COROUTINE_PORT    19025
+#define WS_THREADED_PORT        19081
+#define WS_COROUTINE_PORT       19082
+#define MAX_CONNECTIONS         256
+
+
+// ----- output -----
+
+FILE *results;
+int resultsFd;
+__attribute__ ((constructor (101))) void redirectServerMessages () { resultsFd = dup (1); dup2 (2, 1); } // before static initialization of the sketch starts printing
+
+
+// ----- threaded WebSocket server, the way httpServer runs example10_webSockets -----
+
+void webSocketsConnectionHandler (TcpConnection *connection, void *parameter) {
+  char buffer [512];
+  int length = 0;
+  do {
+    int received = connection->recvData (buffer + length, sizeof (buffer) - 1 - length);
+    if (!received) return;
+    buffer [length += received] = 0;
+  } while (!strstr (buffer, "\r\n\r\n"));
+  WebSocket webSocket (connection, String (buffer));
+  example10_webSockets (&webSocket);
+}
+
+
+// ----- clients -----
+
+int connectTo (int port) {
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct timeval timeOut = {10, 0};
+  setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+bool recvUntil (int s, const char *delimiter) { // reads (and drops) the reply until delimiter
+  char buffer [1024];
+  int length = 0;
+  while (length < (int) sizeof (buffer) - 1) {
+    int received = recv (s, buffer + length, sizeof (buffer) - 1 - length, 0);
+    if (received <= 0) return false;
+    buffer [length += received] = 0;
+    if (strstr (buffer, delimiter)) return true;
+  }
+  return false;
+}
+
+bool recvBytes (int s, int bytes) {
+  char buffer [1024];
+  while (bytes > 0) {
+    int received = recv (s, buffer, bytes < (int) sizeof (buffer) ? bytes : sizeof (buffer), 0);
+    if (received <= 0) return false;
+    bytes -= received;
+  }
+  return true;
+}
+
+bool morseOpen (int s)    { return recvUntil (s, "\r\n"); } // welcome message
+
+bool morseRequest (int s) { return send (s, "sos", 3, 0) == 3 && recvUntil (s, "... --- ... "); }
+
+bool wsOpen (int s)       {
+  const char *request = "GET /example10_WebSockets HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+  return send (s, request, strlen (request), 0) == (int) strlen (request) && recvUntil (s, "\r\n\r\n");
+}
+
+bool wsRequest (int s)    { // masked binary frame with 32 16 bit integers, the reply is a text frame and a binary frame
+  unsigned char frame [6 + 64] = {0x82, 0x80 | 64, 1, 2, 3, 4};
+  for (int i = 0; i < 64; i++) frame [6 + i] = i ^ frame [2 + i % 4];
+  return send (s, frame, sizeof (frame), 0) == sizeof (frame) && recvBytes (s, 2 + 68 + 2 + 32);
+}
+
+void run (const char *title, int port, int connections, bool (*open) (int), bool (*request) (int)) {
+  int s [MAX_CONNECTIONS];
+  int opened = 0;
+  delay (100); // let the server settle
+  unsigned long heapBefore = ESP.getFreeHeap ();
+  while (opened < connections && (s [opened] = connectTo (port)) != -1) if (!open (s [opened ++])) break;
+  delay (100); // let the servers finish whatever they do when connection arrives
+  long heapPerConnection = opened ? ((long) heapBefore - (long) ESP.getFreeHeap ()) / opened : 0;
+
+  int failed = connections - opened;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < opened; i++) if (!request (s [i])) failed ++;
+  unsigned long roundTrip = opened ? (micros () - startMicros) / opened : 0;
+
+  fprintf (results, "  %-22s %6li bytes of heap per connection, round trip %5lu us, %i failed\n", title, heapPerConnection, roundTrip, failed);
+  for (int i = 0; i < opened; i++) close (s [i]);
+  delay (200); // let the connections close
+}
+
+int main (int argc, char *argv []) {
+  results = fdopen (resultsFd, "w");
+  setvbuf (results, NULL, _IOLBF, 0);
+  int connections = argc > 1 ? atoi (argv [1]) : 24;
+  if (connections > MAX_CONNECTIONS) connections = MAX_CONNECTIONS;
+
+  fprintf (results, "Morse echo (example 11), %i idle connections\n", connections);
+  TcpServer *threadedServer = new TcpServer (morseEchoServerConnectionHandler, NULL, 4096, 180000, (char *) "127.0.0.1", MORSE_THREADED_PORT, NULL);
+  if (!threadedServer->started ()) { fprintf (results, "could not start server on port %i\n", MORSE_THREADED_PORT); return 1; }
+  run ("threaded TcpServer:", MORSE_THREADED_PORT, connections, morseOpen, morseRequest);
+  delete threadedServer;
+  CoroutineTcpServer *coroutineServer = new CoroutineTcpServer (morseEchoServerCoroutine, NULL, 180000, (char *) "127.0.0.1", MORSE_COROUTINE_PORT, NULL);
+  if (!coroutineServer->started ()) { fprintf (results, "could not start server on port %i\n", MORSE_COROUTINE_PORT); return 1; }
+  run ("CoroutineTcpServer:", MORSE_COROUTINE_PORT, connections, morseOpen, morseRequest);
+  delete coroutineServer;
+
+  fprintf (results, "WebSocket (example 10), %i idle connections\n", connections);
+  threadedServer = new TcpServer (webSocketsConnectionHandler, NULL, 8192, 300000, (char *) "127.0.0.1", WS_THREADED_PORT, NULL);
+  if (!threadedServer->started ()) { fprintf (results, "could not start server on port %i\n", WS_THREADED_PORT); return 1; }
+  run ("threaded TcpServer:", WS_THREADED_PORT, connections, wsOpen, wsRequest);
+  delete threadedServer;
+  coroutineServer = new CoroutineTcpServer (webSocketsCoroutine, NULL, 300000, (char *) "127.0.0.1", WS_COROUTINE_PORT, NULL);
+  if (!coroutineServer->started ()) { fprintf (results, "could not start server on port %i\n", WS_COROUTINE_PORT); return 1; }
+  run ("CoroutineTcpServer:", WS_COROUTINE_PORT, connections, wsOpen, wsRequest);
+  delete coroutineServer;
+
+  delay (100); // let the threads finish
+  return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * file_cache.cpp - compares httpServer serving static files with and without HttpFileCache
+ *
+ *  Client threads repeat GET of 5 files with the sizes of the sketch's html files (index.html, example05.html, oscilloscope.html
+ *  and the two .png icons) over keep-alive connections. At the same time another thread takes SPIFFSsemaphore every 2 ms, the
+ *  way FTP, telnet and user management do, and measures how long it has to wait for it. The same load runs with the cache turned
+ *  off (setCapacity (0, 0), the behaviour before the cache), with the default cache that holds all 5 files and with a 16 KB cache
+ *  that has to evict files. Reported are requests per second, semaphore waiting times and cache counters.
+ *
+ *  usage: file_cache [clients] [seconds]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "../../Esp32_web_ftp_telnet_server_template.ino"
+
+#define FILE_CACHE_HTTP_PORT 19580
+#define MAX_CLIENTS          32
+
+
+// ----- output -----
+
+FILE *results;
+int resultsFd;
+__attribute__ ((constructor (101))) void redirectServerMessages () { resultsFd = dup (1); dup2 (2, 1); } // before static initialization of the sketch starts printing
+
+
+// ----- files -----
+
+struct benchFile { const char *name; unsigned long size; };
+benchFile files [] = {{"index.html", 6807}, {"example05.html", 9355}, {"oscilloscope.html", 39561}, {"android-192.png", 1818}, {"apple-180.png", 1596}};
+#define FILES (sizeof (files) / sizeof (files [0]))
+
+bool writeFiles () {
+  for (unsigned int i = 0; i < FILES; i++) {
+    String fileName = String ("/var/www/html/") + files [i].name;
+    File file = SPIFFS.open (fileName.c_str (), FILE_WRITE);
+    if (!file) return false;
+    for (unsigned long j = 0; j < files [i].size; j++) file.write ((uint8_t) ('a' + j % 26));
+    file.close ();
+  }
+  return true;
+}
+
+
+// ----- clients -----
+
+std::atomic<bool> running;
+std::atomic<unsigned long> requests;
+std::atomic<unsigned long> failedRequests;
+
+int connectTo (int port) {
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct timeval timeOut = {10, 0};
+  setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+bool readReply (int s, char *buffer, int bufferSize, unsigned long expectedLength, bool *connectionClose) { // reads one reply and checks its length, returns true if it is 200
+  int length = 0, received;
+  char *endOfHeader;
+  buffer [0] = 0;
+  while (!(endOfHeader = strstr (buffer, "\r\n\r\n")) && length < bufferSize - 1 && (received = recv (s, buffer + length, bufferSize - 1 - length, 0)) > 0) {
+    length += received;
+    buffer [length] = 0;
+  }
+  if (!endOfHeader) return false;
+  char *p = strstr (buffer, "Content-Length:");
+  unsigned long contentLength = p && p < endOfHeader ? atol (p + 15) : 0;
+  *connectionClose = strstr (buffer, "Connection:close") && strstr (buffer, "Connection:close") < endOfHeader;
+  bool ok = !strncmp (buffer + 8, " 200", 4) && contentLength == expectedLength;
+  unsigned long contentReceived = length - (endOfHeader + 4 - buffer);
+  while (contentReceived < contentLength && (received = recv (s, buffer, bufferSize, 0)) > 0) contentReceived += received; // content is not checked, only counted
+  return ok && contentReceived == contentLength;
+}
+
+void client (int clientNumber) {
+  char buffer [8192];
+  int s = -1;
+  for (unsigned int i = clientNumber; running; i++) {
+    if (s == -1 && (s = connectTo (FILE_CACHE_HTTP_PORT)) == -1) { failedRequests ++; delay (10); continue; }
+    benchFile *f = &files [i % FILES];
+    String request = String ("GET /") + f->name + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    bool connectionClose = true;
+    if (send (s, request.c_str (), request.length (), MSG_NOSIGNAL) == (int) request.length () && readReply (s, buffer, sizeof (buffer), f->size, &connectionClose)) requests ++; else failedRequests ++;
+    if (connectionClose) { close (s); s = -1; }
+  }
+  if (s != -1) close (s);
+}
+
+
+// ----- SPIFFSsemaphore contender, like FTP or telnet -----
+
+std::vector<unsigned long> waitMicros;
+
+void contender () {
+  while (running) {
+    unsigned long startMicros = micros ();
+    xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
+      waitMicros.push_back (micros () - startMicros);
+    xSemaphoreGive (SPIFFSsemaphore);
+    delay (2);
+  }
+}
+
+void run (const char *title, unsigned long capacity, unsigned long maxFileSize, int clients, int seconds) {
+  httpFileCache.setCapacity (capacity, maxFileSize);
+  httpFileCache.invalidate (NULL);
+  unsigned long hitsBefore = httpFileCache.getHits (), missesBefore = httpFileCache.getMisses (), evictionsBefore = httpFileCache.getEvictions ();
+  requests = failedRequests = 0;
+  waitMicros.clear ();
+  running = true;
+  std::vector<std::thread> clientThreads;
+  for (int i = 0; i < clients; i++) clientThreads.push_back (std::thread (client, i));
+  std::thread contenderThread (contender);
+  delay (seconds * 1000);
+  unsigned long measuredRequests = requests.load ();
+  running = false;
+  for (auto &t : clientThreads) t.join ();
+  contenderThread.join ();
+  std::sort (waitMicros.begin (), waitMicros.end ());
+  unsigned long waitSum = 0; for (unsigned long w : waitMicros) waitSum += w;
+  size_t n = waitMicros.size ();
+  fprintf (results, "%s\n", title);
+  fprintf (results, "  requests:        %lu / s, %lu failed\n", measuredRequests / seconds, failedRequests.load ());
+  fprintf (results, "  semaphore wait:  %lu us average, %lu us p99, %lu us max\n", n ? waitSum / n : 0, n ? waitMicros [n * 99 / 100] : 0, n ? waitMicros [n - 1] : 0);
+  fprintf (results, "  cache:           %lu hits, %lu misses, %lu evictions, %u files, %lu bytes\n", httpFileCache.getHits () - hitsBefore, httpFileCache.getMisses () - missesBefore, httpFileCache.getEvictions () - evictionsBefore, httpFileCache.getCount (), httpFileCache.getSize ());
+  delay (300); // let the server release connections
+}
+
+int main (int argc, char *argv []) {
+  results = fdopen (resultsFd, "w");
+  setvbuf (results, NULL, _IOLBF, 0);
+  int clients = argc > 1 ? atoi (argv [1]) : 4;
+  int seconds = argc > 2 ? atoi (argv [2]) : 5;
+  if (clients < 1) clients = 1;
+  if (clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+  if (seconds < 1) seconds = 1;
+
+  // start the sketch in a fresh SPIFFS directory so that httpServer finds webserver home directory
+  setenv ("HOST_PORT_OFFSET", "19000", 0);
+  char spiffsRoot [] = "/tmp/esp32_file_cache_XXXXXX";
+  if (!mkdtemp (spiffsRoot)) { perror ("mkdtemp"); return 1; }
+  setenv ("SPIFFS_ROOT", spiffsRoot, 1);
+  setup ();
+  if (!writeFiles ()) { fprintf (results, "could not write files into %s\n", spiffsRoot); return 1; }
+
+  httpServer *server = new httpServer (NULL, NULL, 8192, (char *) "127.0.0.1", FILE_CACHE_HTTP_PORT, NULL);
+  if (!server->started ()) { fprintf (results, "could not start server on port %i\n", FILE_CACHE_HTTP_PORT); return 1; }
+  server->setAdmissionControl (16, 0, 0, TcpAdmissionControl::REPLY);
+
+  fprintf (results, "%i clients, %i s\n", clients, seconds);
+  run ("without cache", 0, 0, clients, seconds);
+  run ("cache of 64 KB, files up to 40 KB", HTTP_FILE_CACHE_SIZE, HTTP_FILE_CACHE_MAX_FILE_SIZE, clients, seconds);
+  run ("cache of 16 KB, files up to 10 KB", 16384, 10240, clients, seconds);
+
+  if (system (("rm -rf " + std::string (spiffsRoot)).c_str ())) fprintf (stderr, "could not remove %s\n", spiffsRoot);
+  _exit (0); // servers' threads are still running, don't wait for them
+}
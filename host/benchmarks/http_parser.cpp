@@ -0,0 +1,198 @@
+/*
+ * http_parser.cpp - compares HttpRequest parser with the way httpServer used to read HTTP requests
+ *
+ *  The String way: the request is collected in a String (searching for "\r\n\r\n" in every new block of data), copied for the
+ *  request handler, checked for "CONNECTION: UPGRADE" and "CONNECTION: CLOSE" with stristr, and the handler compares
+ *  httpRequest.substring (0, n) with each of its routes - the sketch's httpRequestHandler has 19 of them.
+ *
+ *  The HttpRequest way: the request is collected in a String and parsed in place while it arrives, Connection header is
+ *  looked up once, the handler compares method and path views with its routes.
+ *
+ *  Both run on a typical browser request arriving in one block and in 64 byte blocks. Reported are nanoseconds and malloc
+ *  calls per request.
+ *
+ *  Route dispatch of an already parsed request then compares the if / else chain (comparing method and path views with
+ *  each route in turn) with HttpRoutes look-up, for the first and the 14th of the sketch's 19 routes and for the last of
+ *  1000 routes. PUT /niceSlider3/5 matches /niceSlider3/{value} pattern in HttpRoutes.
+ *
+ *  usage: http_parser [requests]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added route dispatch
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "HttpRequest.hpp"
+#include "HttpRoutes.hpp"
+
+
+// ----- count malloc calls of the whole process -----
+
+std::atomic<unsigned long> mallocCalls;
+extern "C" void *__libc_malloc (size_t size);
+extern "C" void *malloc (size_t size) { mallocCalls.fetch_add (1, std::memory_order_relaxed); return __libc_malloc (size); }
+
+
+const char *browserRequest = "GET /niceRadio5 HTTP/1.1\r\n"
+                             "Host: 10.0.0.3\r\n"
+                             "Connection: keep-alive\r\n"
+                             "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+                             "Accept: application/json, text/plain, */*\r\n"
+                             "Referer: http://10.0.0.3/example05.html\r\n"
+                             "Accept-Encoding: gzip, deflate\r\n"
+                             "Accept-Language: en-US,en;q=0.9,sl;q=0.8\r\n"
+                             "Cache-Control: no-cache\r\n"
+                             "Pragma: no-cache\r\n"
+                             "\r\n";
+
+// routes of sketch's httpRequestHandler, the request above matches the 16th
+const char *routes [][2] = {{"GET", "/example01.html"}, {"GET", "/builtInLed"}, {"PUT", "/builtInLed/on"}, {"PUT", "/builtInLed/off"}, {"GET", "/upTime"},
+                            {"GET", "/freeHeap"}, {"GET", "/httpRequestCount"}, {"GET", "/rssi"}, {"GET", "/netstat"}, {"GET", "/niceSwitch1"},
+                            {"PUT", "/niceSwitch1/"}, {"PUT", "/niceButton2/pressed"}, {"GET", "/niceSlider3"}, {"PUT", "/niceSlider3/"}, {"PUT", "/niceButton4/pressed"},
+                            {"GET", "/niceRadio5"}, {"PUT", "/niceRadio5/"}, {"PUT", "/niceButton6/pressed"}, {"GET", "/currentTime"}};
+#define ROUTES (sizeof (routes) / sizeof (routes [0]))
+String routePrefixes [ROUTES]; // "GET /niceRadio5 " like the sketch used to compare with
+
+char *stristr (char *haystack, char *needle) { // as it is in webServer.hpp
+  if (!haystack || !needle) return NULL;
+  int nCheckLimit = strlen (needle);
+  int hCheckLimit = strlen (haystack) - nCheckLimit + 1;
+  for (int i = 0; i < hCheckLimit; i++) {
+    int j = i;
+    int k = 0;
+    while (*(needle + k)) {
+        char nChar = *(needle + k ++); if (nChar >= 'a' && nChar <= 'z') nChar -= 32;
+        char hChar = *(haystack + j ++); if (hChar >= 'a' && hChar <= 'z') hChar -= 32;
+        if (nChar != hChar) break;
+    }
+    if (!*(needle + k)) return haystack + i;
+  }
+  return NULL;
+}
+
+volatile int sink; // keeps the compiler from optimizing the work away
+
+int stringWay (int blockSize) {
+  int requestLength = strlen (browserRequest);
+  String received;
+  for (int i = 0; i < requestLength; i += blockSize) { // event loop
+    char block [1024]; int l = requestLength - i < blockSize ? requestLength - i : blockSize;
+    memcpy (block, browserRequest + i, l); block [l] = 0;
+    unsigned int searchFrom = received.length () < 3 ? 0 : received.length () - 3;
+    received += block;
+    if (received.indexOf ("\r\n\r\n", searchFrom) >= 0) break;
+  }
+  String httpRequest = received; // request handler thread
+  char *buffer = (char *) httpRequest.c_str ();
+  int result = stristr (buffer, (char *) "CONNECTION: UPGRADE") ? 1 : 0;
+  result += stristr (buffer, (char *) "CONNECTION: CLOSE") ? 2 : 0;
+  for (unsigned int r = 0; r < ROUTES; r++) // httpRequestHandler
+    if (httpRequest.substring (0, routePrefixes [r].length ()) == routePrefixes [r]) { result += r; break; }
+  return result;
+}
+
+int httpRequestWay (int blockSize) {
+  int requestLength = strlen (browserRequest);
+  String received;
+  HttpRequest request;
+  for (int i = 0; i < requestLength; i += blockSize) { // event loop
+    char block [1024]; int l = requestLength - i < blockSize ? requestLength - i : blockSize;
+    memcpy (block, browserRequest + i, l); block [l] = 0;
+    received += block;
+    if (request.parse (received.c_str (), received.length ()) != HttpRequest::INCOMPLETE) break;
+  }
+  HttpStringView connection = request.getHeader ("Connection"); // request handler thread
+  int result = connection.hasToken ("upgrade") ? 1 : 0;
+  result += request.keepAlive () ? 0 : 2;
+  HttpStringView method = request.getMethod (), path = request.getPath ();
+  for (unsigned int r = 0; r < ROUTES; r++) // httpRequestHandler
+    if (method == routes [r][0] && path == routes [r][1]) { result += r; break; }
+  return result;
+}
+
+// ----- route dispatch -----
+
+#define MANY_ROUTES 1000
+String manyPaths [MANY_ROUTES];
+HttpRoutes sketchRoutes;
+HttpRoutes manyRoutes;
+HttpRequest dispatchedRequest;
+String dispatchedText;
+unsigned int chainRoutes;
+
+String routeHandler (HttpRequest& httpRequest) { return ""; }
+
+int ifElseChain (int) {
+  HttpStringView method = dispatchedRequest.getMethod (), path = dispatchedRequest.getPath ();
+  for (unsigned int r = 0; r < chainRoutes; r++) {
+    const char *routeMethod = r < ROUTES ? routes [r][0] : "GET";
+    const char *routePath = r < ROUTES ? routes [r][1] : manyPaths [r].c_str ();
+    if (method == routeMethod && (routePath [strlen (routePath) - 1] == '/' ? path.startsWith (routePath) : path == routePath)) return r;
+  }
+  return -1;
+}
+
+int sketchRoutesFind (int) { return sketchRoutes.find (dispatchedRequest) ? 1 : 0; }
+
+int manyRoutesFind (int) { return manyRoutes.find (dispatchedRequest) ? 1 : 0; }
+
+void dispatch (const char *request) { // parses the request that dispatch runs will use
+  dispatchedText = request;
+  dispatchedRequest.reset ();
+  dispatchedRequest.parse (dispatchedText.c_str (), dispatchedText.length ());
+}
+
+void run (const char *title, int (*way) (int), int blockSize, int requests) {
+  sink = way (blockSize); // warm up
+  unsigned long mallocCallsBefore = mallocCalls.load ();
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < requests; i++) sink = way (blockSize);
+  unsigned long elapsedMicros = micros () - startMicros;
+  unsigned long measuredMallocCalls = mallocCalls.load () - mallocCallsBefore;
+  printf ("  %-34s %6lu ns per request, %5.1f malloc calls per request\n", title, elapsedMicros * 1000 / requests, (double) measuredMallocCalls / requests);
+}
+
+int main (int argc, char *argv []) {
+  int requests = argc > 1 ? atoi (argv [1]) : 200000;
+  if (requests < 1) requests = 1;
+  for (unsigned int r = 0; r < ROUTES; r++) routePrefixes [r] = String (routes [r][0]) + " " + routes [r][1] + (routes [r][1][strlen (routes [r][1]) - 1] == '/' ? "" : " ");
+
+  printf ("%zu byte request, %i requests\n", strlen (browserRequest), requests);
+  printf ("request arrives in one block\n");
+  run ("String, stristr, substring", stringWay, 64 * 1024, requests);
+  run ("HttpRequest", httpRequestWay, 64 * 1024, requests);
+  printf ("request arrives in 64 byte blocks\n");
+  run ("String, stristr, substring", stringWay, 64, requests);
+  run ("HttpRequest", httpRequestWay, 64, requests);
+
+  for (unsigned int r = 0; r < ROUTES; r++) {
+    String pattern = routes [r][1];
+    if (pattern.endsWith ("/")) pattern += "{value}";
+    if (!sketchRoutes.add (routes [r][0], pattern.c_str (), routeHandler) || !manyRoutes.add (routes [r][0], pattern.c_str (), routeHandler)) { printf ("could not add route %s\n", pattern.c_str ()); return 1; }
+  }
+  for (unsigned int r = ROUTES; r < MANY_ROUTES; r++) {
+    manyPaths [r] = "/sensor" + String (r) + "/value";
+    if (!manyRoutes.add ("GET", manyPaths [r].c_str (), routeHandler)) { printf ("could not add route %s\n", manyPaths [r].c_str ()); return 1; }
+  }
+  printf ("route dispatch, first of %u routes: GET /example01.html\n", (unsigned int) ROUTES);
+  dispatch ("GET /example01.html HTTP/1.1\r\n\r\n");
+  chainRoutes = ROUTES;
+  run ("if / else chain", ifElseChain, 0, requests);
+  run ("HttpRoutes", sketchRoutesFind, 0, requests);
+  printf ("route dispatch, 14th of %u routes: PUT /niceSlider3/5\n", (unsigned int) ROUTES);
+  dispatch ("PUT /niceSlider3/5 HTTP/1.1\r\n\r\n");
+  run ("if / else chain", ifElseChain, 0, requests);
+  run ("HttpRoutes", sketchRoutesFind, 0, requests);
+  printf ("route dispatch, last of %i routes: GET /sensor%i/value\n", MANY_ROUTES, MANY_ROUTES - 1);
+  dispatch (("GET " + manyPaths [MANY_ROUTES - 1] + " HTTP/1.1\r\n\r\n").c_str ());
+  chainRoutes = MANY_ROUTES;
+  run ("if / else chain", ifElseChain, 0, requests);
+  run ("HttpRoutes", manyRoutesFind, 0, requests);
+  return 0;
+}
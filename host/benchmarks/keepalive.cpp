@@ -0,0 +1,197 @@
+/*
+ * keepalive.cpp - compares httpServer HTTP/1.1 persistent connections with closing the connection after each reply
+ *
+ *  Client threads repeat GET /builtInLed HTTP/1.1 (answered by sketch's httpRoutes). They read each reply up to its
+ *  Content-Length and send the next request through the same connection unless the server has answered with Connection:close,
+ *  in which case they connect again. The same load runs with keep-alive turned off (setKeepAlive (0, 0), the behaviour before
+ *  persistent connections), with the default limit of 100 requests per connection, with 10 requests per connection and with
+ *  10 requests pipelined in one send, after which the client reads all 10 replies. Before that, PUT with a body followed by
+ *  GET in the same send checks that the body is not mistaken for the next pipelined request.
+ *  Reported are requests and connections per second, malloc calls per request (heap churn) and the lowest and average simulated
+ *  ESP32 free heap (which includes task stacks, see host/include/Arduino.h) sampled during the run.
+ *
+ *  usage: keepalive [clients] [seconds]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added pipelined requests
+ *            October 16, 2026
+ *          - added pipelined PUT with body check
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <thread>
+#include <atomic>
+
+#include "../../Esp32_web_ftp_telnet_server_template.ino"
+
+#define KEEPALIVE_HTTP_PORT 19480
+#define MAX_CLIENTS         32
+
+
+// ----- output -----
+
+FILE *results;
+int resultsFd;
+__attribute__ ((constructor (101))) void redirectServerMessages () { resultsFd = dup (1); dup2 (2, 1); } // before static initialization of the sketch starts printing
+
+
+// ----- heap churn: count malloc calls of the whole process -----
+
+std::atomic<unsigned long> mallocCalls;
+extern "C" void *__libc_malloc (size_t size);
+extern "C" void *malloc (size_t size) { mallocCalls.fetch_add (1, std::memory_order_relaxed); return __libc_malloc (size); }
+
+
+// ----- clients -----
+
+std::atomic<bool> running;
+std::atomic<unsigned long> requests;
+std::atomic<unsigned long> failedRequests;
+std::atomic<unsigned long> connections;
+
+int connectTo (int port) {
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct timeval timeOut = {10, 0};
+  setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+bool readReply (int s, char *buffer, int bufferSize, int *length, bool *connectionClose) { // reads one reply, the bytes of the next (pipelined) replies stay in buffer, returns true if it is 200
+  int received;
+  char *endOfHeader;
+  buffer [*length] = 0;
+  while (!(endOfHeader = strstr (buffer, "\r\n\r\n")) && *length < bufferSize - 1 && (received = recv (s, buffer + *length, bufferSize - 1 - *length, 0)) > 0) {
+    *length += received;
+    buffer [*length] = 0;
+  }
+  if (!endOfHeader) return false;
+  char *p = strstr (buffer, "Content-Length:");
+  int replyLength = endOfHeader + 4 - buffer + (p && p < endOfHeader ? atoi (p + 15) : 0);
+  *connectionClose = strstr (buffer, "Connection:close") && strstr (buffer, "Connection:close") < endOfHeader;
+  bool ok = !strncmp (buffer + 8, " 200", 4);
+  while (*length < replyLength && replyLength < bufferSize && (received = recv (s, buffer + *length, bufferSize - 1 - *length, 0)) > 0) *length += received;
+  if (*length < replyLength) return false;
+  memmove (buffer, buffer + replyLength, *length - replyLength);
+  *length -= replyLength;
+  return ok;
+}
+
+void client (int pipelineDepth) {
+  std::string request;
+  for (int i = 0; i < pipelineDepth; i++) request += "GET /builtInLed HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"; // pipelined requests go out in one send
+  char buffer [8192];
+  int length = 0;
+  int s = -1;
+  while (running) {
+    if (s == -1) {
+      if ((s = connectTo (KEEPALIVE_HTTP_PORT)) == -1) { failedRequests ++; delay (10); continue; }
+      connections ++;
+      length = 0;
+    }
+    bool connectionClose = false;
+    if (send (s, request.c_str (), request.length (), MSG_NOSIGNAL) == (int) request.length ()) {
+      for (int i = 0; i < pipelineDepth && !connectionClose; i++) // the server ignores pipelined requests after the one it answers with Connection:close
+        if (readReply (s, buffer, sizeof (buffer), &length, &connectionClose)) requests ++; else { failedRequests ++; connectionClose = true; }
+    } else {
+      failedRequests ++;
+      connectionClose = true;
+    }
+    if (connectionClose) { close (s); s = -1; }
+  }
+  if (s != -1) close (s);
+}
+
+bool checkPipelinedBody (std::string body) { // PUT /niceSlider3/7 with body and GET /niceSlider3 in one send, both have to be answered with 200 and the second reply has to be GET's
+  std::string request = std::string ("PUT /niceSlider3/7 HTTP/1.1\r\nHost: 127.0.0.1\r\nContent-Length: ") + std::to_string (body.length ()) + "\r\n\r\n" + body +
+                        "GET /niceSlider3 HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  int s = connectTo (KEEPALIVE_HTTP_PORT);
+  if (s == -1) return false;
+  char buffer [8192];
+  int length = 0, received;
+  bool connectionClose = false;
+  bool ok = send (s, request.c_str (), request.length (), MSG_NOSIGNAL) == (int) request.length () && readReply (s, buffer, sizeof (buffer), &length, &connectionClose) && !connectionClose;
+  if (ok) { // wait for the whole reply to GET, if the body was taken for a request it would be the reply to the body instead
+    buffer [length] = 0;
+    while (!strstr (buffer, "{\"id\":\"niceSlider3\",\"value\":\"7\"}") && length < (int) sizeof (buffer) - 1 && (received = recv (s, buffer + length, sizeof (buffer) - 1 - length, 0)) > 0) {
+      length += received;
+      buffer [length] = 0;
+    }
+    ok = strstr (buffer, "{\"id\":\"niceSlider3\",\"value\":\"7\"}") && readReply (s, buffer, sizeof (buffer), &length, &connectionClose) && !length;
+  }
+  close (s);
+  return ok;
+}
+
+void run (const char *title, httpServer *server, unsigned long idleMillis, unsigned int maxRequests, int pipelineDepth, int clients, int seconds) {
+  server->setKeepAlive (idleMillis, maxRequests);
+  requests = failedRequests = connections = 0;
+  running = true;
+  std::vector<std::thread> clientThreads;
+  for (int i = 0; i < clients; i++) clientThreads.push_back (std::thread (client, pipelineDepth));
+  delay (100); // let the clients get going
+  unsigned long mallocCallsBefore = mallocCalls.load ();
+  unsigned long requestsBefore = requests.load ();
+  unsigned long connectionsBefore = connections.load ();
+  unsigned long minFreeHeap = ESP.getFreeHeap (), freeHeapSum = 0, samples = 0;
+  unsigned long startMillis = millis ();
+  while (millis () - startMillis < (unsigned long) seconds * 1000) {
+    unsigned long freeHeap = ESP.getFreeHeap ();
+    if (freeHeap < minFreeHeap) minFreeHeap = freeHeap;
+    freeHeapSum += freeHeap; samples ++;
+    delay (1);
+  }
+  unsigned long measuredRequests = requests.load () - requestsBefore;
+  unsigned long measuredConnections = connections.load () - connectionsBefore;
+  unsigned long measuredMallocCalls = mallocCalls.load () - mallocCallsBefore;
+  running = false;
+  for (auto &t : clientThreads) t.join ();
+  fprintf (results, "%s\n", title);
+  fprintf (results, "  requests:     %lu / s, %lu failed\n", measuredRequests / seconds, failedRequests.load ());
+  fprintf (results, "  connections:  %lu / s\n", measuredConnections / seconds);
+  fprintf (results, "  heap churn:   %.1f malloc calls per request\n", measuredRequests ? (double) measuredMallocCalls / measuredRequests : 0.0);
+  fprintf (results, "  free heap:    %lu bytes lowest, %lu bytes average\n", minFreeHeap, samples ? freeHeapSum / samples : 0);
+  delay (300); // let the server release connections
+}
+
+int main (int argc, char *argv []) {
+  results = fdopen (resultsFd, "w");
+  setvbuf (results, NULL, _IOLBF, 0);
+  int clients = argc > 1 ? atoi (argv [1]) : 4;
+  int seconds = argc > 2 ? atoi (argv [2]) : 5;
+  if (clients < 1) clients = 1;
+  if (clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+  if (seconds < 1) seconds = 1;
+
+  // start the sketch in a fresh SPIFFS directory so that httpServer finds webserver home directory
+  setenv ("HOST_PORT_OFFSET", "19000", 0);
+  char spiffsRoot [] = "/tmp/esp32_keepalive_XXXXXX";
+  if (!mkdtemp (spiffsRoot)) { perror ("mkdtemp"); return 1; }
+  setenv ("SPIFFS_ROOT", spiffsRoot, 1);
+  setup ();
+
+  httpServer *server = new httpServer (httpRequestHandler, NULL, 8192, (char *) "127.0.0.1", KEEPALIVE_HTTP_PORT, NULL);
+  if (!server->started ()) { fprintf (results, "could not start server on port %i\n", KEEPALIVE_HTTP_PORT); return 1; }
+  server->setRoutes (&httpRoutes);
+  server->setAdmissionControl (16, 0, 0, TcpAdmissionControl::REPLY);
+
+  server->setKeepAlive (5000, 100);
+  fprintf (results, "pipelined PUT with body and GET: %s\n", checkPipelinedBody ("value=7") && checkPipelinedBody ("GET /builtInLed HTTP/1.1\r\n\r\n") && checkPipelinedBody (std::string ("a\0b", 3)) ? "OK" : "FAILED");
+  fprintf (results, "%i clients, %i s\n", clients, seconds);
+  run ("close after reply", server, 0, 0, 1, clients, seconds);
+  run ("keep-alive, 100 requests per connection", server, 5000, 100, 1, clients, seconds);
+  run ("keep-alive, 10 requests per connection", server, 5000, 10, 1, clients, seconds);
+  run ("keep-alive, 100 requests per connection, 10 pipelined requests per round trip", server, 5000, 100, 10, clients, seconds);
+
+  if (system (("rm -rf " + std::string (spiffsRoot)).c_str ())) fprintf (stderr, "could not remove %s\n", spiffsRoot);
+  _exit (0); // servers' threads are still running, don't wait for them
+}
@@ -0,0 +1,404 @@
+/*
+ * loopback.cpp - load generator that drives the servers of the sketch on loopback and reports the results in JSON
+ *
+ *  The sketch is started the same way main.cpp starts it, but in a fresh temporary SPIFFS directory and with privileged
+ *  ports moved by HOST_PORT_OFFSET (19000 if not set). A threaded echo TcpServer and an httpServer with WebSocket echo
+ *  handler (and sketch's httpRequestHandler and httpRoutes) are added for the workloads that the sketch itself doesn't provide.
+ *  Each workload runs with the given number of concurrent clients:
+ *    - tcp_echo              - threaded TcpServer, a new connection for each 64 byte request,
+ *    - http_static_1k, _64k  - GET of a static file from /var/www/html, a new connection for each request (HTTP/1.0),
+ *    - http_route            - GET /builtInLed, answered by sketch's httpRoutes,
+ *    - websocket_echo        - 64 byte binary frame echoed back, one WebSocket per client,
+ *    - ftp_stor_1k, _64k, _1m - STOR through passive data connection, one control connection per client,
+ *    - ftp_retr_1k, _64k, _1m - RETR of the files stored by ftp_stor workloads,
+ *    - telnet_command        - command (pwd) round-trip, one telnet session per client.
+ *  Reported for each workload: requests / s, p50 / p99 / p999 / max latency, errors, peak number of live connections
+ *  (TcpConnectionRegistry) and peak memory per connection: the largest drop of simulated ESP32 free heap (which includes
+ *  task stacks, see host/include/Arduino.h) below the level before the workload started, divided by peak connections.
+ *  Workloads, request counts and file contents are fixed, so the results of different commits can be compared when
+ *  they are run on the same machine with the same options. Server messages go to stderr, JSON goes to stdout (or -o file).
+ *
+ *  usage: loopback [-c concurrency] [-n requests] [-w workload,workload,...] [-o file.json]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <thread>
+#include <atomic>
+
+#include "../../Esp32_web_ftp_telnet_server_template.ino"
+
+#define ECHO_PORT 18007
+#define BENCH_HTTP_PORT 18080
+
+
+// ----- servers that the sketch doesn't provide -----
+
+void echoConnectionHandler (TcpConnection *connection, void *parameter) {
+  char buffer [256];
+  int received;
+  while ((received = connection->recvData (buffer, sizeof (buffer))) > 0) if (connection->sendData (buffer, received) != received) return;
+}
+
+void echoWsRequestHandler (HttpRequest& wsRequest, WebSocket *webSocket) {
+  byte buffer [1024];
+  while (true) {
+    switch (webSocket->available ()) {
+      case WebSocket::NOT_AVAILABLE:  SPIFFSsafeDelay (1);
+                                      break;
+      case WebSocket::BINARY:       { size_t l = webSocket->readBinary (buffer, sizeof (buffer));
+                                      if (!webSocket->sendBinary (buffer, l)) return;
+                                      break;
+                                    }
+      case WebSocket::STRING:         webSocket->readString ();
+                                      break;
+      default:                        return;
+    }
+  }
+}
+
+
+// ----- blocking client helpers -----
+
+int connectTo (int port) { // connects to 127.0.0.1, privileged ports are moved by HOST_PORT_OFFSET (see host/include/lwip/sockets.h)
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct timeval timeOut = {10, 0};
+  setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+  setsockopt (s, SOL_SOCKET, SO_SNDTIMEO, &timeOut, sizeof (timeOut));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+bool sendAll (int s, const char *data, size_t length) {
+  while (length) {
+    ssize_t n = send (s, data, length, 0);
+    if (n <= 0) return false;
+    data += n; length -= n;
+  }
+  return true;
+}
+bool sendAll (int s, const std::string &data) { return sendAll (s, data.data (), data.length ()); }
+
+bool recvUntil (int s, std::string &buffer, const char *delimiter) { // receives until buffer contains delimiter, leaves the rest in buffer
+  while (buffer.find (delimiter) == std::string::npos) {
+    char b [4096];
+    ssize_t n = recv (s, b, sizeof (b), 0);
+    if (n <= 0) return false;
+    buffer.append (b, n);
+  }
+  return true;
+}
+
+size_t recvAll (int s) { // receives until the other side closes the connection
+  size_t total = 0;
+  char b [16384];
+  ssize_t n;
+  while ((n = recv (s, b, sizeof (b), 0)) > 0) total += n;
+  return n == 0 ? total : 0;
+}
+
+bool recvFtpReply (int s, std::string &buffer, const char *code) { // reads (the last line of) FTP reply and checks its code
+  while (true) {
+    size_t e;
+    while ((e = buffer.find ("\r\n")) == std::string::npos) if (!recvUntil (s, buffer, "\r\n")) return false;
+    std::string line = buffer.substr (0, e);
+    buffer.erase (0, e + 2);
+    if (line.length () >= 4 && isdigit (line [0]) && line [3] == ' ') return !strncmp (line.c_str (), code, 3);
+  }
+}
+
+std::string fileContent (size_t size) { // the same content every run
+  std::string s (size, 0);
+  for (size_t i = 0; i < size; i++) s [i] = 'a' + (i * 7 + i / 64) % 26;
+  return s;
+}
+
+
+// ----- clients -----
+
+struct client { // one client thread, requests are done through request () after open () and before closeSession ()
+  virtual bool open ()                          { return true; }  // opens a session that persists across requests (not measured)
+  virtual bool request () = 0;
+  virtual void closeSession ()                  {}
+  virtual ~client ()                            {}
+};
+
+struct tcpEchoClient: client {
+  bool request () {
+    int s = connectTo (ECHO_PORT); if (s == -1) return false;
+    char b [64]; memset (b, 'e', sizeof (b));
+    bool ok = sendAll (s, b, sizeof (b));
+    size_t received = 0;
+    while (ok && received < sizeof (b)) { ssize_t n = recv (s, b, sizeof (b) - received, 0); if (n <= 0) ok = false; else received += n; }
+    close (s);
+    return ok;
+  }
+};
+
+struct httpClient: client {
+  std::string path;
+  size_t expectedLength;
+  httpClient (std::string path, size_t expectedLength) { this->path = path; this->expectedLength = expectedLength; }
+  bool request () {
+    int s = connectTo (BENCH_HTTP_PORT); if (s == -1) return false;
+    bool ok = sendAll (s, "GET " + path + " HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n");
+    std::string reply;
+    ok = ok && recvUntil (s, reply, "\r\n\r\n") && !reply.compare (0, 12, "HTTP/1.0 200");
+    if (ok) {
+      size_t headerLength = reply.find ("\r\n\r\n") + 4;
+      size_t bodyLength = reply.length () - headerLength + recvAll (s);
+      ok = !expectedLength || bodyLength == expectedLength;
+    }
+    close (s);
+    return ok;
+  }
+};
+
+struct webSocketClient: client {
+  int s = -1;
+  bool open () {
+    if ((s = connectTo (BENCH_HTTP_PORT)) == -1) return false;
+    std::string reply;
+    return sendAll (s, "GET /echo HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n")
+           && recvUntil (s, reply, "\r\n\r\n") && reply.find (" 101 ") != std::string::npos;
+  }
+  bool request () {
+    unsigned char frame [2 + 4 + 64] = {0x82, 0x80 | 64, 1, 2, 3, 4};
+    for (int i = 0; i < 64; i++) frame [6 + i] = ('w' + i) ^ frame [2 + i % 4];
+    if (!sendAll (s, (char *) frame, sizeof (frame))) return false;
+    unsigned char reply [2 + 64];
+    size_t received = 0;
+    while (received < sizeof (reply)) { ssize_t n = recv (s, reply + received, sizeof (reply) - received, 0); if (n <= 0) return false; received += n; }
+    return reply [0] == 0x82 && reply [1] == 64 && reply [2] == 'w';
+  }
+  void closeSession () {
+    unsigned char closeFrame [6] = {0x88, 0x80, 0, 0, 0, 0};
+    sendAll (s, (char *) closeFrame, sizeof (closeFrame));
+    close (s);
+  }
+};
+
+struct ftpClient: client {
+  int s = -1;
+  std::string buffer;
+  bool store;
+  std::string fileName;
+  const std::string *content;
+  ftpClient (bool store, int clientNumber, const std::string *content) {
+    this->store = store;
+    this->content = content;
+    fileName = "/bench" + std::to_string (clientNumber) + "_" + std::to_string (content->size ());
+  }
+  bool open () {
+    return (s = connectTo (21)) != -1 && recvFtpReply (s, buffer, "220")
+           && sendAll (s, "USER root\r\n") && recvFtpReply (s, buffer, "331")
+           && sendAll (s, "PASS rootpassword\r\n") && recvFtpReply (s, buffer, "230")
+           && sendAll (s, "TYPE I\r\n") && recvFtpReply (s, buffer, "200");
+  }
+  bool request () {
+    if (!sendAll (s, "PASV\r\n") || !recvUntil (s, buffer, ")\r\n")) return false;
+    int ip1, ip2, ip3, ip4, p1, p2;
+    size_t b = buffer.find ('(');
+    if (b == std::string::npos || 6 != sscanf (buffer.c_str () + b, "(%i,%i,%i,%i,%i,%i)", &ip1, &ip2, &ip3, &ip4, &p1, &p2)) return false;
+    buffer.erase (0, buffer.find (")\r\n") + 3);
+    int d = connectTo (p1 * 256 + p2); if (d == -1) return false;
+    bool ok;
+    if (store) {
+      ok = sendAll (s, "STOR " + fileName + "\r\n") && recvFtpReply (s, buffer, "150") && sendAll (d, *content);
+      close (d);
+      ok = ok && recvFtpReply (s, buffer, "226");
+    } else {
+      ok = sendAll (s, "RETR " + fileName + "\r\n") && recvFtpReply (s, buffer, "150") && recvAll (d) == content->size ();
+      close (d);
+      ok = ok && recvFtpReply (s, buffer, "226");
+    }
+    return ok;
+  }
+  void closeSession () { sendAll (s, "QUIT\r\n"); close (s); }
+};
+
+struct telnetClient: client {
+  int s = -1;
+  std::string buffer;
+  bool open () {
+    return (s = connectTo (23)) != -1 && recvUntil (s, buffer, "user: ") && sendAll (s, "root\r\n")
+           && recvUntil (s, buffer, "password: ") && sendAll (s, "rootpassword\r\n") && recvUntil (s, buffer, "\r\n# ");
+  }
+  bool request () {
+    buffer.clear ();
+    return sendAll (s, "pwd\r\n") && recvUntil (s, buffer, "\r\n# ");
+  }
+  void closeSession () { sendAll (s, "quit\r\n"); close (s); }
+};
+
+
+// ----- output -----
+
+// server messages go to stderr, stdout is kept for JSON - this has to be done before the sketch's global objects get constructed since some of them already write to stdout
+int jsonFd;
+__attribute__ ((constructor (101))) void redirectServerMessages () { jsonFd = dup (1); dup2 (2, 1); }
+
+
+// ----- workloads -----
+
+struct workload {
+  const char *name;
+  int requestsDivisor;                                              // large transfers run fewer requests
+  std::function<client *(int clientNumber)> newClient;
+};
+
+struct result {
+  std::string name;
+  int requests;
+  int errors;
+  double seconds;
+  std::vector<unsigned long> latency;
+  unsigned int peakConnections;
+  long peakHeapBytes;
+};
+
+result run (const workload &w, int concurrency, int requests) {
+  result r = {w.name, 0, 0, 0, {}, 0, 0};
+  int requestsPerClient = std::max (1, requests / w.requestsDivisor / concurrency);
+  delay (200); // let the connections of previous workload finish
+  long freeHeapBefore = ESP.getFreeHeap ();
+  unsigned int connectionsBefore = TcpConnectionRegistry::count ();
+
+  // sample heap and live connections while the workload runs
+  std::atomic<bool> running (true);
+  long minFreeHeap = freeHeapBefore;
+  unsigned int peakConnections = 0;
+  std::thread sampler ([&] () {
+    while (running) {
+      long freeHeap = ESP.getFreeHeap ();
+      unsigned int connections = TcpConnectionRegistry::count ();
+      if (freeHeap < minFreeHeap) minFreeHeap = freeHeap;
+      if (connections > peakConnections) peakConnections = connections;
+      usleep (500);
+    }
+  });
+
+  std::vector<std::vector<unsigned long>> latency (concurrency);
+  {
+    __hostExcludeFromHeap__ clientMemory;
+    for (auto &l : latency) l.reserve (requestsPerClient);
+  }
+  std::atomic<int> errors (0);
+  std::vector<std::thread> clientThreads;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < concurrency; i++) clientThreads.push_back (std::thread ([&, i] () {
+    client *c = w.newClient (i);
+    if (!c->open ()) { errors += requestsPerClient; delete c; return; }
+    c->request (); // warm-up, not measured
+    for (int j = 0; j < requestsPerClient; j++) {
+      unsigned long requestMicros = micros ();
+      if (c->request ()) latency [i].push_back (micros () - requestMicros);
+      else errors ++;
+    }
+    c->closeSession ();
+    delete c;
+  }));
+  for (auto &t : clientThreads) t.join ();
+  r.seconds = (micros () - startMicros) / 1000000.0;
+  running = false;
+  sampler.join ();
+
+  for (auto &l : latency) r.latency.insert (r.latency.end (), l.begin (), l.end ());
+  std::sort (r.latency.begin (), r.latency.end ());
+  r.requests = r.latency.size ();
+  r.errors = errors;
+  r.peakConnections = peakConnections > connectionsBefore ? peakConnections - connectionsBefore : 0;
+  r.peakHeapBytes = freeHeapBefore - minFreeHeap;
+  return r;
+}
+
+unsigned long percentile (const std::vector<unsigned long> &sorted, int perMille) {
+  if (sorted.empty ()) return 0;
+  size_t i = sorted.size () * perMille / 1000;
+  return sorted [i < sorted.size () ? i : sorted.size () - 1];
+}
+
+int main (int argc, char *argv []) {
+  int concurrency = 4;
+  int requests = 2000;
+  std::string selected;
+  const char *outputFile = NULL;
+  int opt;
+  while ((opt = getopt (argc, argv, "c:n:w:o:")) != -1) {
+    switch (opt) {
+      case 'c': concurrency = std::max (1, atoi (optarg)); break;
+      case 'n': requests = std::max (1, atoi (optarg)); break;
+      case 'w': selected = "," + std::string (optarg) + ","; break;
+      case 'o': outputFile = optarg; break;
+      default:  fprintf (stderr, "usage: %s [-c concurrency] [-n requests] [-w workload,workload,...] [-o file.json]\n", argv [0]); return 1;
+    }
+  }
+
+  FILE *json = outputFile ? fopen (outputFile, "w") : fdopen (jsonFd, "w");
+  if (!json) { perror (outputFile); return 1; }
+
+  // start the sketch in a fresh SPIFFS directory
+  setenv ("HOST_PORT_OFFSET", "19000", 0);
+  char spiffsRoot [] = "/tmp/esp32_loopback_XXXXXX";
+  if (!mkdtemp (spiffsRoot)) { perror ("mkdtemp"); return 1; }
+  setenv ("SPIFFS_ROOT", spiffsRoot, 1);
+  if (system (("mkdir -p " + std::string (spiffsRoot) + "/var/www/html").c_str ())) { fprintf (stderr, "could not prepare %s\n", spiffsRoot); return 1; }
+  std::string content1k, content64k, content1m;
+  {
+    __hostExcludeFromHeap__ clientMemory; // file contents are client's memory, not ESP32 heap
+    content1k = fileContent (1024); content64k = fileContent (65536); content1m = fileContent (1048576);
+  }
+  FILE *f;
+  if ((f = fopen ((std::string (spiffsRoot) + "/var/www/html/bench1k.html").c_str (), "w"))) { fwrite (content1k.data (), 1, content1k.size (), f); fclose (f); }
+  if ((f = fopen ((std::string (spiffsRoot) + "/var/www/html/bench64k.html").c_str (), "w"))) { fwrite (content64k.data (), 1, content64k.size (), f); fclose (f); }
+  setup ();
+
+  TcpServer echoServer (echoConnectionHandler, NULL, 4096, 10000, (char *) "127.0.0.1", ECHO_PORT, NULL);
+  httpServer benchHttpServer (httpRequestHandler, echoWsRequestHandler, 8192, (char *) "127.0.0.1", BENCH_HTTP_PORT, NULL);
+  if (!echoServer.started () || !benchHttpServer.started () || !ftpSrv || !telnetSrv) { fprintf (stderr, "could not start the servers\n"); return 1; }
+  benchHttpServer.setRoutes (&httpRoutes);
+
+  workload workloads [] = {
+    {"tcp_echo",        1,   [] (int) { return (client *) new tcpEchoClient (); }},
+    {"http_static_1k",  1,   [] (int) { return (client *) new httpClient ("/bench1k.html", 1024); }},
+    {"http_static_64k", 10,  [] (int) { return (client *) new httpClient ("/bench64k.html", 65536); }},
+    {"http_route",      1,   [] (int) { return (client *) new httpClient ("/builtInLed", 0); }},
+    {"websocket_echo",  1,   [] (int) { return (client *) new webSocketClient (); }},
+    {"ftp_stor_1k",     10,  [&] (int i) { return (client *) new ftpClient (true, i, &content1k); }},
+    {"ftp_retr_1k",     10,  [&] (int i) { return (client *) new ftpClient (false, i, &content1k); }},
+    {"ftp_stor_64k",    20,  [&] (int i) { return (client *) new ftpClient (true, i, &content64k); }},
+    {"ftp_retr_64k",    20,  [&] (int i) { return (client *) new ftpClient (false, i, &content64k); }},
+    {"ftp_stor_1m",     200, [&] (int i) { return (client *) new ftpClient (true, i, &content1m); }},
+    {"ftp_retr_1m",     200, [&] (int i) { return (client *) new ftpClient (false, i, &content1m); }},
+    {"telnet_command",  1,   [] (int) { return (client *) new telnetClient (); }},
+  };
+
+  fprintf (json, "{\"benchmark\":\"loopback\",\"concurrency\":%i,\"requests\":%i,\"workloads\":[", concurrency, requests);
+  bool first = true;
+  for (auto &w : workloads) {
+    if (selected != "" && selected.find ("," + std::string (w.name) + ",") == std::string::npos) continue;
+    result r = run (w, concurrency, requests);
+    fprintf (json, "%s\n  {\"name\":\"%s\",\"requests\":%i,\"errors\":%i,\"seconds\":%.3f,\"requestsPerSecond\":%.1f,"
+                   "\"latencyMicros\":{\"p50\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu},"
+                   "\"peakConnections\":%u,\"peakHeapBytes\":%li,\"peakHeapBytesPerConnection\":%li}",
+                   first ? "" : ",", r.name.c_str (), r.requests, r.errors, r.seconds, r.seconds > 0 ? r.requests / r.seconds : 0,
+                   percentile (r.latency, 500), percentile (r.latency, 990), percentile (r.latency, 999), r.latency.empty () ? 0 : r.latency.back (),
+                   r.peakConnections, r.peakHeapBytes, r.peakConnections ? r.peakHeapBytes / (long) r.peakConnections : 0);
+    fflush (json);
+    first = false;
+  }
+  fprintf (json, "\n]}\n");
+  fclose (json);
+
+  if (system (("rm -rf " + std::string (spiffsRoot)).c_str ())) fprintf (stderr, "could not remove %s\n", spiffsRoot);
+  _exit (0); // servers' threads are still running, don't wait for them
+}
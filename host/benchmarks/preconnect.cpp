@@ -0,0 +1,88 @@
+/*
+ * preconnect.cpp - measures what idle pre-connects cost threaded TcpServer with and without accept filter
+ *
+ *  A browser opens a few speculative connections and sends nothing through most of them. The benchmark opens the given number of
+ *  such idle connections, measures the drop of simulated ESP32 free heap (which includes task stacks, see host/include/Arduino.h),
+ *  then runs short request connections next to them and finally waits until the accept filter closes the idle ones.
+ *
+ *  usage: preconnect [idle connections] [requests]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+
+#include "TcpServer.hpp"
+
+#define SILENT_MILLIS   500
+#define MAX_IDLE        64
+
+void echoConnectionHandler (TcpConnection *connection, void *parameter) {
+  char buffer [64];
+  if (connection->recvData (buffer, sizeof (buffer)) > 0) connection->sendData ((char *) "OK\r\n");
+}
+
+int connectTo (int port) {
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+void run (const char *title, int port, unsigned long silentMillis, int idle, int requests) {
+  TcpServer *server = new TcpServer (echoConnectionHandler, NULL, 4096, 30000, (char *) "127.0.0.1", port, NULL);
+  if (!server->started ()) { printf ("could not start server on port %i\n", port); exit (1); }
+  server->setAcceptFilter (silentMillis);
+  delay (100); // let the server settle
+
+  unsigned long heapBefore = ESP.getFreeHeap ();
+  int s [MAX_IDLE];
+  int opened = 0;
+  while (opened < idle && (s [opened] = connectTo (port)) != -1) opened ++;
+  delay (100); // let the listener do whatever it does with new connections
+  long idleHeap = (long) heapBefore - (long) ESP.getFreeHeap ();
+
+  int failed = 0;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < requests; i++) {
+    char buffer [64];
+    int r = connectTo (port);
+    if (r == -1 || send (r, "GET\r\n", 5, 0) != 5 || recv (r, buffer, sizeof (buffer), 0) <= 0) failed ++;
+    if (r != -1) close (r);
+  }
+  unsigned long averageMicros = requests ? (micros () - startMicros) / requests : 0;
+
+  delay (SILENT_MILLIS + 200); // accept filter closes idle connections in the meantime
+  int closedByServer = 0;
+  for (int i = 0; i < opened; i++) {
+    char c;
+    struct timeval timeOut = {0, 10000};
+    setsockopt (s [i], SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+    if (recv (s [i], &c, 1, 0) == 0) closedByServer ++;
+    close (s [i]);
+  }
+
+  printf ("%s\n", title);
+  printf ("  %i idle connections: %li bytes of heap, %i closed by server after %i ms\n", opened, idleHeap, closedByServer, SILENT_MILLIS);
+  printf ("  %i requests:         %lu us per connection, %i failed\n", requests, averageMicros, failed);
+  printf ("  accept filter:        %lu passed, %lu closed\n", server->getAcceptFilterPassed (), server->getAcceptFilterClosed ());
+  delete server;
+  delay (100); // let the threads finish
+}
+
+int main (int argc, char *argv []) {
+  int idle = argc > 1 ? atoi (argv [1]) : 6;
+  int requests = argc > 2 ? atoi (argv [2]) : 1000;
+  if (idle > MAX_IDLE) idle = MAX_IDLE;
+
+  run ("thread per connection", 19290, 0, idle, requests);
+  run ("accept filter", 19291, SILENT_MILLIS, idle, requests);
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * slowloris.cpp - shows how httpServer keeps serving normal clients while slow clients are connected
+ *
+ *  Slow clients send the first line of a request and then one header byte every 500 ms, which keeps refreshing the connection
+ *  time-out. When the server closes such a connection the slow client connects again, the way an attacker would. Normal clients
+ *  repeat GET /builtInLed (answered by sketch's httpRoutes) at the same time. The server admits 16 requests at most, like
+ *  the sketch does. The same load runs with and without header limits (setHeaderLimits) and, for comparison, without slow clients.
+ *  Reported are normal requests per second, failed normal requests (503 or error) and slow connections closed by the server.
+ *  Since httpServer takes admission slot only when the request is complete, slow clients don't take slots and normal clients
+ *  should get (about) as many requests through as without them, with no failed requests, in all three runs.
+ *
+ *  usage: slowloris [slow clients] [seconds]
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - slow clients no longer take admission slots
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+#include <thread>
+#include <atomic>
+
+#include "../../Esp32_web_ftp_telnet_server_template.ino"
+
+#define SLOW_HTTP_PORT      19380
+#define NORMAL_CLIENTS      2
+#define MAX_SLOW_CLIENTS    64
+
+
+// ----- output -----
+
+FILE *results;
+int resultsFd;
+__attribute__ ((constructor (101))) void redirectServerMessages () { resultsFd = dup (1); dup2 (2, 1); } // before static initialization of the sketch starts printing
+
+
+// ----- clients -----
+
+std::atomic<bool> running;
+std::atomic<unsigned long> normalRequests;
+std::atomic<unsigned long> failedRequests;
+std::atomic<unsigned long> slowConnectionsClosed;
+
+int connectTo (int port) {
+  int s = socket (PF_INET, SOCK_STREAM, 0);
+  if (s == -1) return -1;
+  struct timeval timeOut = {10, 0};
+  setsockopt (s, SOL_SOCKET, SO_RCVTIMEO, &timeOut, sizeof (timeOut));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons (port);
+  a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+  if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1) { close (s); return -1; }
+  return s;
+}
+
+void normalClient () {
+  const char *request = "GET /builtInLed HTTP/1.0\r\nHost: 127.0.0.1\r\n\r\n";
+  while (running) {
+    char buffer [512];
+    int length = 0, received;
+    int s = connectTo (SLOW_HTTP_PORT);
+    if (s != -1 && send (s, request, strlen (request), 0) == (int) strlen (request))
+      while (length < (int) sizeof (buffer) - 1 && (received = recv (s, buffer + length, sizeof (buffer) - 1 - length, 0)) > 0) length += received;
+    buffer [length] = 0;
+    if (strstr (buffer, "HTTP/1.0 200")) normalRequests ++; else failedRequests ++;
+    if (s != -1) close (s);
+  }
+}
+
+void slowClient () {
+  while (running) {
+    int s = connectTo (SLOW_HTTP_PORT);
+    if (s == -1) { delay (100); continue; }
+    bool open = send (s, "GET / HTTP/1.1\r\n", 16, MSG_NOSIGNAL) == 16;
+    while (running && open) {
+      delay (500);
+      char c;
+      if (recv (s, &c, 1, MSG_DONTWAIT) == 0 || send (s, "X", 1, MSG_NOSIGNAL) != 1) open = false; // the server has closed the connection
+    }
+    if (!open) slowConnectionsClosed ++;
+    close (s);
+  }
+}
+
+void run (const char *title, httpServer *server, int slowClients, int seconds) {
+  normalRequests = failedRequests = slowConnectionsClosed = 0;
+  running = true;
+  std::vector<std::thread> clients;
+  for (int i = 0; i < slowClients; i++) clients.push_back (std::thread (slowClient));
+  delay (200); // let slow clients occupy the server first
+  for (int i = 0; i < NORMAL_CLIENTS; i++) clients.push_back (std::thread (normalClient));
+  delay (seconds * 1000);
+  running = false;
+  for (auto &t : clients) t.join ();
+  fprintf (results, "%s\n", title);
+  fprintf (results, "  normal requests:        %lu / s, %lu failed\n", normalRequests.load () / seconds, failedRequests.load ());
+  fprintf (results, "  slow connections:       %lu closed by server (%lu counted by httpServer)\n", slowConnectionsClosed.load (), server->getSlowClients ());
+  delay (200); // let the server release connections
+}
+
+int main (int argc, char *argv []) {
+  results = fdopen (resultsFd, "w");
+  setvbuf (results, NULL, _IOLBF, 0);
+  int slowClients = argc > 1 ? atoi (argv [1]) : 32;
+  int seconds = argc > 2 ? atoi (argv [2]) : 5;
+  if (slowClients > MAX_SLOW_CLIENTS) slowClients = MAX_SLOW_CLIENTS;
+  if (seconds < 1) seconds = 1;
+
+  // start the sketch in a fresh SPIFFS directory so that httpServer finds webserver home directory
+  setenv ("HOST_PORT_OFFSET", "19000", 0);
+  char spiffsRoot [] = "/tmp/esp32_slowloris_XXXXXX";
+  if (!mkdtemp (spiffsRoot)) { perror ("mkdtemp"); return 1; }
+  setenv ("SPIFFS_ROOT", spiffsRoot, 1);
+  setup ();
+
+  httpServer *server = new httpServer (httpRequestHandler, NULL, 8192, (char *) "127.0.0.1", SLOW_HTTP_PORT, NULL);
+  if (!server->started ()) { fprintf (results, "could not start server on port %i\n", SLOW_HTTP_PORT); return 1; }
+  server->setRoutes (&httpRoutes);
+  server->setAdmissionControl (16, 0, 0, TcpAdmissionControl::REPLY);
+
+  fprintf (results, "%i normal clients, %i slow clients, %i s\n", NORMAL_CLIENTS, slowClients, seconds);
+  server->setHeaderLimits (0, 0);
+  run ("no slow clients", server, 0, seconds);
+  run ("slow clients, no header limits", server, slowClients, seconds);
+  server->setHeaderLimits (2000, 32);
+  run ("slow clients, header limits 2 s, 32 bytes / s", server, slowClients, seconds);
+
+  if (system (("rm -rf " + std::string (spiffsRoot)).c_str ())) fprintf (stderr, "could not remove %s\n", spiffsRoot);
+  _exit (0); // servers' threads are still running, don't wait for them
+}
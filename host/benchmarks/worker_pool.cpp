@@ -0,0 +1,74 @@
+/*
+ * worker_pool.cpp - compares thread-per-connection and pool mode of threaded TcpServer on host
+ *
+ *  Client threads open short connections in bursts, each sends a small request and waits for a small reply.
+ *  Reported are connections per second, request latency, and (in pool mode) queue wait and rejections.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+
+#include "TcpServer.hpp"
+
+void echoConnectionHandler (TcpConnection *connection, void *parameter) {
+  char buffer [64];
+  if (connection->recvData (buffer, sizeof (buffer)) > 0) connection->sendData ((char *) "OK\r\n");
+}
+
+std::atomic<unsigned long> failedConnections;
+
+void client (int port, int connections, std::vector<unsigned long> *latency) {
+  for (int i = 0; i < connections; i++) {
+    int s = socket (PF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons (port);
+    a.sin_addr.s_addr = inet_addr ("127.0.0.1");
+    unsigned long startMicros = micros ();
+    char buffer [64];
+    if (connect (s, (struct sockaddr *) &a, sizeof (a)) == -1 || send (s, "GET\r\n", 5, 0) != 5 || recv (s, buffer, sizeof (buffer), 0) <= 0) failedConnections ++;
+    else latency->push_back (micros () - startMicros);
+    close (s);
+  }
+}
+
+void run (const char *title, int port, unsigned int poolSize, unsigned int queueDepth, int clients, int connections) {
+  TcpServer *server = new TcpServer (echoConnectionHandler, NULL, 4096, 1000, (char *) "127.0.0.1", port, NULL, poolSize, queueDepth);
+  if (!server->started ()) { printf ("could not start server on port %i\n", port); exit (1); }
+  failedConnections = 0;
+
+  std::vector<std::vector<unsigned long>> latency (clients);
+  std::vector<std::thread> clientThreads;
+  unsigned long startMicros = micros ();
+  for (int i = 0; i < clients; i++) clientThreads.push_back (std::thread (client, port, connections / clients, &latency [i]));
+  for (auto &t : clientThreads) t.join ();
+  double seconds = (micros () - startMicros) / 1000000.0;
+
+  std::vector<unsigned long> all;
+  for (auto &l : latency) all.insert (all.end (), l.begin (), l.end ());
+  std::sort (all.begin (), all.end ());
+  printf ("%s\n", title);
+  printf ("  connections:      %lu / s (%lu failed)\n", (unsigned long) (all.size () / seconds), failedConnections.load ());
+  if (all.size ()) printf ("  latency:          p50 %lu us, p99 %lu us\n", all [all.size () / 2], all [all.size () * 99 / 100]);
+  if (server->getWorkerPoolSize ()) {
+    printf ("  worker threads:   %u, queue depth %u\n", server->getWorkerPoolSize (), queueDepth);
+    printf ("  queue wait:       average %lu us, max %lu us\n", server->getAverageQueueWaitMicros (), server->getMaxQueueWaitMicros ());
+    printf ("  rejected:         %lu\n", server->getRejectedConnections ());
+  }
+  delete server;
+  delay (100); // let the threads finish
+}
+
+int main (int argc, char *argv []) {
+  int connections = argc > 1 ? atoi (argv [1]) : 4000;
+  int clients = 8;
+
+  run ("thread per connection", 19090, 0, 0, clients, connections);
+  run ("pool mode", 19091, 4, 16, clients, connections);
+  run ("pool mode, short queue", 19092, 2, 2, clients, connections);
+  return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * Arduino.h - host (Linux) replacement for ESP32 Arduino core
+ *
+ *  Together with the other headers in host/include this lets Esp32_web_ftp_telnet_server_template.ino
+ *  and servers/*.h* be compiled unmodified into a Linux executable that serves on loopback. Only the
+ *  part of Arduino / ESP-IDF API that servers actually use is implemented.
+ *
+ *  ESP.getFreeHeap () reports a simulated ESP32 heap: HOST_HEAP_SIZE minus memory malloc-ed since
+ *  start-up minus stacks of running tasks.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_ARDUINO__
+  #define __HOST_ARDUINO__
+
+  // all standard headers are included before lwip-like socket macros (connect, bind) get defined
+  #include <stdint.h>
+  #include <stdlib.h>
+  #include <stdio.h>
+  #include <stdarg.h>
+  #include <string.h>
+  #include <strings.h>
+  #include <ctype.h>
+  #include <math.h>
+  #include <time.h>
+  #include <sys/time.h>
+  #include <signal.h>
+  #include <malloc.h>
+  #include <unistd.h>
+  #include <algorithm>
+  #include <functional>
+  #include <string>
+  #include <vector>
+  #include <map>
+  #include <memory>
+  #include <chrono>
+  #include <thread>
+  #include <atomic>
+
+  #include "freertos/FreeRTOS.h"
+  #include "WString.h"
+
+  #ifndef HOST_HEAP_SIZE
+    #define HOST_HEAP_SIZE (300 * 1024) // free heap of ESP32 after WiFi is started is typically somewhere around 200 - 300 KB
+  #endif
+
+  typedef uint8_t byte;
+  typedef bool boolean;
+  typedef unsigned int word;
+
+  #define HIGH            0x1
+  #define LOW             0x0
+  #define INPUT           0x01
+  #define OUTPUT          0x02
+  #define PULLUP          0x04
+  #define INPUT_PULLUP    0x05
+  #define PULLDOWN        0x08
+  #define INPUT_PULLDOWN  0x09
+  #define LED_BUILTIN     2
+  #define RTC_DATA_ATTR
+  #define IRAM_ATTR
+  #define PROGMEM
+  #define F(s)            (s)
+
+  // ----- process initialization -----
+
+  inline long &__hostMallocBaseline__ ();
+
+  struct __hostInitialization__ {
+    __hostInitialization__ () {
+      mallopt (M_ARENA_MAX, 1);           // keep all threads in the main arena so mallinfo2 sees all the memory
+      signal (SIGPIPE, SIG_IGN);          // lwip reports broken connections with errors, not with signals
+      setvbuf (stdout, NULL, _IONBF, 0);  // Serial is not buffered
+      __hostMallocBaseline__ ();
+    }
+  };
+  inline __hostInitialization__ __hostInitializationInstance__;
+
+  // ----- time -----
+
+  inline std::chrono::steady_clock::time_point __hostStartTime__ () { static std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now (); return t; }
+  inline unsigned long millis () { return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - __hostStartTime__ ()).count (); }
+  inline unsigned long micros () { return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - __hostStartTime__ ()).count (); }
+  inline void delay (uint32_t ms) { vTaskDelay (ms); }
+  inline void delayMicroseconds (uint32_t us) { unsigned long start = micros (); while (micros () - start < us); }
+  inline void yield () { sched_yield (); }
+
+  // ----- heap -----
+
+  inline long __hostMallocedBytes__ () { struct mallinfo2 mi = mallinfo2 (); return (long) (mi.uordblks + mi.hblkhd); }
+  inline long &__hostMallocBaseline__ () { static long baseline = __hostMallocedBytes__ (); return baseline; }
+
+  struct __hostExcludeFromHeap__ { // memory that host libraries malloc while this object exists is not counted as ESP32 heap
+    long before = __hostMallocedBytes__ ();
+    ~__hostExcludeFromHeap__ () { __hostMallocBaseline__ () += __hostMallocedBytes__ () - before; }
+  };
+
+  inline uint32_t __hostFreeHeap__ () {
+    long used = __hostMallocedBytes__ () - __hostMallocBaseline__ () + __hostChargedStackBytes__ ();
+    if (used < 0) used = 0;
+    return used >= HOST_HEAP_SIZE ? 0 : (uint32_t) (HOST_HEAP_SIZE - used);
+  }
+
+  class EspClass {
+    public:
+      uint32_t getFreeHeap ()       { return __hostFreeHeap__ (); }
+      uint32_t getHeapSize ()       { return HOST_HEAP_SIZE; }
+      uint32_t getMaxAllocHeap ()   { return __hostFreeHeap__ (); }
+      const char *getSdkVersion ()  { return "host"; }
+      uint32_t getCpuFreqMHz ()     { return 240; }
+      void restart ()               { printf ("\n[host] restart requested, exiting\n"); fflush (stdout); _exit (0); }
+  };
+  inline EspClass ESP;
+
+  // ----- Serial -----
+
+  class HardwareSerial {
+    public:
+      void begin (unsigned long baud)             { (void) baud; }
+      void end ()                                 {}
+      void flush ()                               { fflush (stdout); }
+      int available ()                            { return 0; }
+      int read ()                                 { return -1; }
+      size_t printf (const char *format, ...) __attribute__ ((format (printf, 2, 3))) {
+        va_list args; va_start (args, format); int n = vprintf (format, args); va_end (args);
+        return n < 0 ? 0 : n;
+      }
+      size_t print (const String &s)              { return fwrite (s.c_str (), 1, s.length (), stdout); }
+      size_t print (const char *s)                { return fputs (s, stdout) < 0 ? 0 : strlen (s); }
+      size_t print (char c)                       { return putchar (c) == EOF ? 0 : 1; }
+      size_t print (long n)                       { return printf ("%li", n); }
+      size_t print (unsigned long n)              { return printf ("%lu", n); }
+      size_t print (int n)                        { return printf ("%i", n); }
+      size_t print (unsigned int n)               { return printf ("%u", n); }
+      size_t print (double d, int digits = 2)     { return printf ("%.*f", digits, d); }
+      size_t println ()                           { return print ("\r\n"); }
+      template<typename T> size_t println (const T &t) { size_t n = print (t); return n + println (); }
+      size_t write (uint8_t c)                    { return putchar (c) == EOF ? 0 : 1; }
+      size_t write (const uint8_t *buf, size_t len) { return fwrite (buf, 1, len, stdout); }
+      operator bool ()                            { return true; }
+  };
+  inline HardwareSerial Serial;
+
+  // ----- GPIO (there are no pins on host, just remember what was written) -----
+
+  inline int *__hostGpio__ () { static int gpio [40] = {}; return gpio; }
+  inline void pinMode (uint8_t pin, uint8_t mode)     { if (pin < 40 && (mode & PULLUP)) __hostGpio__ () [pin] = HIGH; }
+  inline void digitalWrite (uint8_t pin, uint8_t val) { if (pin < 40) __hostGpio__ () [pin] = val ? HIGH : LOW; }
+  inline int digitalRead (uint8_t pin)                { return pin < 40 ? __hostGpio__ () [pin] : LOW; }
+  inline uint16_t analogRead (uint8_t pin)            { return pin < 40 && __hostGpio__ () [pin] ? 4095 : 0; }
+  inline void analogWrite (uint8_t pin, int val)      { digitalWrite (pin, val); }
+
+  // ----- misc -----
+
+  inline long random (long howBig)                    { return howBig <= 0 ? 0 : ::random () % howBig; }
+  inline long random (long howSmall, long howBig)     { return howSmall >= howBig ? howSmall : howSmall + random (howBig - howSmall); }
+  inline void randomSeed (unsigned long seed)         { srandom ((unsigned) seed); }
+  inline unsigned int makeWord (uint8_t h, uint8_t l) { return ((unsigned int) h << 8) | l; }
+  #define word(...)                                   makeWord (__VA_ARGS__)
+  #define lowByte(w)                                  ((uint8_t) ((w) & 0xff))
+  #define highByte(w)                                 ((uint8_t) ((w) >> 8))
+  #define constrain(amt, low, high)                   ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+  // ----- sleep -----
+
+  typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_TOUCHPAD,
+    ESP_SLEEP_WAKEUP_ULP,
+    ESP_SLEEP_WAKEUP_GPIO,
+    ESP_SLEEP_WAKEUP_UART
+  } esp_sleep_wakeup_cause_t;
+  inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause () { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+  inline void esp_deep_sleep_start () { printf ("\n[host] deep sleep requested, exiting\n"); _exit (0); }
+  inline int esp_sleep_enable_timer_wakeup (uint64_t us) { (void) us; return 0; }
+
+  typedef int esp_err_t;
+  #define ESP_OK    0
+  #define ESP_FAIL  -1
+
+  // ----- Arduino entry points -----
+
+  void setup ();
+  void loop ();
+
+#endif
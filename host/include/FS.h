@@ -0,0 +1,7 @@
+// host build: File class is defined in SPIFFS.h replacement
+#ifndef __HOST_FS__
+  #define __HOST_FS__
+
+  #include "SPIFFS.h"
+
+#endif
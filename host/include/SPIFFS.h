@@ -0,0 +1,191 @@
+/*
+ * SPIFFS.h - host (Linux) replacement for ESP32 SPIFFS file system
+ *
+ *  SPIFFS is kept in a host directory: ./spiffs by default or the one specified by environment
+ *  variable SPIFFS_ROOT. SPIFFS has a flat name space where "/" is just a part of file name, so:
+ *
+ *  - directories are created automatically when a file is opened for writing,
+ *  - opening a directory lists all the files beneath it (recursively) with their full SPIFFS names.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_SPIFFS__
+  #define __HOST_SPIFFS__
+
+  #include "Arduino.h"
+  #include <sys/stat.h>
+  #include <sys/types.h>
+  #include <dirent.h>
+  #include <ftw.h>
+
+  #define FILE_READ   "r"
+  #define FILE_WRITE  "w"
+  #define FILE_APPEND "a"
+
+  inline std::string __hostSpiffsRoot__ () {
+    static std::string root = getenv ("SPIFFS_ROOT") ? getenv ("SPIFFS_ROOT") : "spiffs";
+    return root;
+  }
+
+  inline std::string __hostSpiffsPath__ (const char *path) { // SPIFFS path -> host path
+    std::string p = path ? path : "";
+    if (p.empty () || p [0] != '/') p = "/" + p;
+    return __hostSpiffsRoot__ () + p;
+  }
+
+  inline void __hostSpiffsListFiles__ (const std::string &hostDir, const std::string &spiffsDir, std::vector<std::string> &list) {
+    DIR *d = opendir (hostDir.c_str ());
+    if (!d) return;
+    struct dirent *e;
+    while ((e = readdir (d))) {
+      if (!strcmp (e->d_name, ".") || !strcmp (e->d_name, "..")) continue;
+      std::string h = hostDir + "/" + e->d_name;
+      std::string s = (spiffsDir == "/" ? "" : spiffsDir) + "/" + e->d_name;
+      struct stat st;
+      if (stat (h.c_str (), &st)) continue;
+      if (S_ISDIR (st.st_mode)) __hostSpiffsListFiles__ (h, s, list);
+      else if (S_ISREG (st.st_mode)) list.push_back (s);
+    }
+    closedir (d);
+  }
+
+  class File {
+    public:
+      File () {}
+
+      operator bool () const                      { return __impl__ && (__impl__->f || __impl__->isDir); }
+      bool isDirectory ()                         { return __impl__ && __impl__->isDir; }
+      const char *name ()                         { return __impl__ ? __impl__->name.c_str () : ""; }
+      size_t size ()                              { return __impl__ ? __impl__->size : 0; }
+      size_t position ()                          { return __impl__ ? __impl__->position : 0; }
+      int available ()                            { return __impl__ && __impl__->f ? (int) (__impl__->size - __impl__->position) : 0; }
+
+      int read () {
+        if (!__impl__ || !__impl__->f) return -1;
+        int c = fgetc (__impl__->f);
+        if (c != EOF) __impl__->position ++;
+        return c == EOF ? -1 : c;
+      }
+      size_t read (uint8_t *buf, size_t size) {
+        if (!__impl__ || !__impl__->f) return 0;
+        size_t n = fread (buf, 1, size, __impl__->f);
+        __impl__->position += n;
+        return n;
+      }
+      int peek () {
+        if (!__impl__ || !__impl__->f) return -1;
+        int c = fgetc (__impl__->f);
+        if (c != EOF) ungetc (c, __impl__->f);
+        return c == EOF ? -1 : c;
+      }
+      bool seek (uint32_t pos) {
+        if (!__impl__ || !__impl__->f || fseek (__impl__->f, pos, SEEK_SET)) return false;
+        __impl__->position = pos;
+        return true;
+      }
+
+      size_t write (uint8_t c)                    { return write (&c, 1); }
+      size_t write (const uint8_t *buf, size_t size) {
+        if (!__impl__ || !__impl__->f) return 0;
+        size_t n = fwrite (buf, 1, size, __impl__->f);
+        __impl__->position += n;
+        if (__impl__->position > __impl__->size) __impl__->size = __impl__->position;
+        return n;
+      }
+      size_t print (const char *s)                { return write ((const uint8_t *) s, strlen (s)); }
+      size_t print (const String &s)              { return write ((const uint8_t *) s.c_str (), s.length ()); }
+      size_t printf (const char *format, ...) __attribute__ ((format (printf, 2, 3))) {
+        va_list args;
+        va_start (args, format); int n = vsnprintf (NULL, 0, format, args); va_end (args);
+        if (n <= 0) return 0;
+        std::vector<char> buf (n + 1);
+        va_start (args, format); vsnprintf (buf.data (), n + 1, format, args); va_end (args);
+        return write ((const uint8_t *) buf.data (), n);
+      }
+      void flush ()                               { if (__impl__ && __impl__->f) fflush (__impl__->f); }
+
+      File openNextFile () {
+        File file;
+        if (!__impl__ || !__impl__->isDir || __impl__->nextEntry >= __impl__->entries.size ()) return file;
+        file.__open__ (__impl__->entries [__impl__->nextEntry ++].c_str (), "r");
+        return file;
+      }
+      void rewindDirectory ()                     { if (__impl__) __impl__->nextEntry = 0; }
+
+      void close ()                               { __impl__.reset (); }
+
+      bool __open__ (const char *path, const char *mode) {
+        __impl__.reset (new __fileImpl__);
+        __impl__->name = path;
+        std::string hostPath = __hostSpiffsPath__ (path);
+        struct stat st;
+        if (!stat (hostPath.c_str (), &st) && S_ISDIR (st.st_mode)) {
+          if (*mode != 'r') { __impl__.reset (); return false; }
+          __impl__->isDir = true;
+          __hostSpiffsListFiles__ (hostPath, __impl__->name, __impl__->entries);
+          return true;
+        }
+        if (*mode != 'r') __mkdirs__ (hostPath);
+        char m [4] = {mode [0], 'b', 0, 0};
+        if (!(__impl__->f = fopen (hostPath.c_str (), m))) { __impl__.reset (); return false; }
+        if (!fstat (fileno (__impl__->f), &st)) __impl__->size = st.st_size;
+        if (*mode == 'a') __impl__->position = __impl__->size;
+        return true;
+      }
+
+    private:
+
+      struct __fileImpl__ {
+        FILE *f = NULL;
+        std::string name;
+        size_t size = 0;
+        size_t position = 0;
+        bool isDir = false;
+        std::vector<std::string> entries;
+        size_t nextEntry = 0;
+        ~__fileImpl__ () { if (f) fclose (f); }
+      };
+      std::shared_ptr<__fileImpl__> __impl__;
+
+      static void __mkdirs__ (const std::string &hostPath) {
+        for (size_t p = __hostSpiffsRoot__ ().length () + 1; (p = hostPath.find ('/', p)) != std::string::npos; p ++)
+          mkdir (hostPath.substr (0, p).c_str (), 0755);
+      }
+  };
+
+  class SPIFFSFS {
+    public:
+      bool begin (bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10) {
+        (void) formatOnFail; (void) basePath; (void) maxOpenFiles;
+        mkdir (__hostSpiffsRoot__ ().c_str (), 0755);
+        struct stat st;
+        return !stat (__hostSpiffsRoot__ ().c_str (), &st) && S_ISDIR (st.st_mode);
+      }
+      void end () {}
+      bool format () {
+        nftw (__hostSpiffsRoot__ ().c_str (), [] (const char *path, const struct stat *st, int flag, struct FTW *ftw) -> int { (void) st; (void) flag; if (ftw->level) ::remove (path); return 0; }, 16, FTW_DEPTH | FTW_PHYS);
+        return true;
+      }
+      File open (const char *path, const char *mode = FILE_READ) { File f; f.__open__ (path, mode); return f; }
+      File open (const String &path, const char *mode = FILE_READ) { return open (path.c_str (), mode); }
+      bool exists (const char *path)              { struct stat st; return !stat (__hostSpiffsPath__ (path).c_str (), &st); }
+      bool exists (const String &path)            { return exists (path.c_str ()); }
+      bool remove (const char *path)              { struct stat st; std::string p = __hostSpiffsPath__ (path); return !stat (p.c_str (), &st) && S_ISREG (st.st_mode) && !::remove (p.c_str ()); }
+      bool remove (const String &path)            { return remove (path.c_str ()); }
+      bool rename (const char *pathFrom, const char *pathTo) { return !::rename (__hostSpiffsPath__ (pathFrom).c_str (), __hostSpiffsPath__ (pathTo).c_str ()); }
+      size_t totalBytes ()                        { return 1374476; } // default ESP32 SPIFFS partition
+      size_t usedBytes () {
+        std::vector<std::string> list;
+        __hostSpiffsListFiles__ (__hostSpiffsRoot__ (), "/", list);
+        size_t used = 0; struct stat st;
+        for (auto &f : list) if (!stat (__hostSpiffsPath__ (f.c_str ()).c_str (), &st)) used += st.st_size;
+        return used;
+      }
+  };
+  inline SPIFFSFS SPIFFS;
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * WString.h - host (Linux) replacement for Arduino String class
+ *
+ *  Implements the subset of Arduino String interface (with Arduino semantics) that servers use,
+ *  backed by std::string.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_WSTRING__
+  #define __HOST_WSTRING__
+
+  #include <stdlib.h>
+  #include <stdio.h>
+  #include <string.h>
+  #include <ctype.h>
+  #include <string>
+
+  class String {
+
+    public:
+
+      String ()                                       {}
+      String (const char *s)                          { if (s) __s__ = s; }
+      String (const std::string &s) : __s__ (s)       {}
+      String (char c)                                 { __s__ = std::string (1, c); }
+      String (unsigned char value, unsigned char base = 10)  { __fromUnsigned__ (value, base); }
+      String (int value, unsigned char base = 10)            { if (base == 10) __s__ = std::to_string (value); else __fromUnsigned__ ((unsigned int) value, base); }
+      String (unsigned int value, unsigned char base = 10)   { __fromUnsigned__ (value, base); }
+      String (long value, unsigned char base = 10)           { if (base == 10) __s__ = std::to_string (value); else __fromUnsigned__ ((unsigned long) value, base); }
+      String (unsigned long value, unsigned char base = 10)  { __fromUnsigned__ (value, base); }
+      String (long long value, unsigned char base = 10)      { if (base == 10) __s__ = std::to_string (value); else __fromUnsigned__ ((unsigned long long) value, base); }
+      String (unsigned long long value, unsigned char base = 10) { __fromUnsigned__ (value, base); }
+      String (float value, unsigned char decimalPlaces = 2)  { __fromDouble__ (value, decimalPlaces); }
+      String (double value, unsigned char decimalPlaces = 2) { __fromDouble__ (value, decimalPlaces); }
+
+      const char *c_str () const                      { return __s__.c_str (); }
+      unsigned int length () const                    { return (unsigned int) __s__.length (); }
+      bool reserve (unsigned int size)                { __s__.reserve (size); return true; }
+
+      char charAt (unsigned int i) const              { return i < __s__.length () ? __s__ [i] : 0; }
+      char operator [] (unsigned int i) const         { return charAt (i); }
+      char &operator [] (unsigned int i)              { static char dummy; if (i >= __s__.length ()) { dummy = 0; return dummy; } return __s__ [i]; }
+      void setCharAt (unsigned int i, char c)         { if (i < __s__.length ()) __s__ [i] = c; }
+
+      String &operator = (const char *s)              { __s__ = s ? s : ""; return *this; }
+
+      bool concat (const String &s)                   { __s__ += s.__s__; return true; }
+      bool concat (const char *s)                     { if (s) __s__ += s; return true; }
+      bool concat (const char *s, unsigned int length) { if (s) __s__.append (s, length); return true; }
+      bool concat (char c)                            { __s__ += c; return true; }
+      String &operator += (const String &s)           { __s__ += s.__s__; return *this; }
+      String &operator += (const char *s)             { if (s) __s__ += s; return *this; }
+      String &operator += (char c)                    { __s__ += c; return *this; }
+      String &operator += (int i)                     { __s__ += std::to_string (i); return *this; }
+      String &operator += (unsigned int i)            { __s__ += std::to_string (i); return *this; }
+      String &operator += (long i)                    { __s__ += std::to_string (i); return *this; }
+      String &operator += (unsigned long i)           { __s__ += std::to_string (i); return *this; }
+
+      int compareTo (const String &s) const           { return strcmp (c_str (), s.c_str ()); }
+      bool equals (const String &s) const             { return __s__ == s.__s__; }
+      bool equals (const char *s) const               { return !strcmp (c_str (), s ? s : ""); }
+      bool equalsIgnoreCase (const String &s) const   { return __s__.length () == s.__s__.length () && !strcasecmp (c_str (), s.c_str ()); }
+      bool startsWith (const String &s) const         { return __s__.compare (0, s.__s__.length (), s.__s__) == 0 && s.__s__.length () <= __s__.length (); }
+      bool startsWith (const String &s, unsigned int offset) const { return offset <= __s__.length () && __s__.compare (offset, s.__s__.length (), s.__s__) == 0 && offset + s.__s__.length () <= __s__.length (); }
+      bool endsWith (const String &s) const           { return s.__s__.length () <= __s__.length () && __s__.compare (__s__.length () - s.__s__.length (), s.__s__.length (), s.__s__) == 0; }
+
+      int indexOf (char c, unsigned int from = 0) const              { size_t p = __s__.find (c, from); return p == std::string::npos ? -1 : (int) p; }
+      int indexOf (const String &s, unsigned int from = 0) const     { size_t p = __s__.find (s.__s__, from); return p == std::string::npos ? -1 : (int) p; }
+      int indexOf (const char *s, unsigned int from = 0) const       { size_t p = __s__.find (s, from); return p == std::string::npos ? -1 : (int) p; }
+      int lastIndexOf (char c) const                                 { size_t p = __s__.rfind (c); return p == std::string::npos ? -1 : (int) p; }
+      int lastIndexOf (char c, unsigned int from) const              { size_t p = __s__.rfind (c, from); return p == std::string::npos ? -1 : (int) p; }
+      int lastIndexOf (const String &s) const                        { size_t p = __s__.rfind (s.__s__); return p == std::string::npos ? -1 : (int) p; }
+
+      String substring (unsigned int from) const      { return substring (from, length ()); }
+      String substring (unsigned int from, unsigned int to) const {
+        if (from > to) { unsigned int t = from; from = to; to = t; }
+        if (from >= __s__.length ()) return String ();
+        if (to > __s__.length ()) to = (unsigned int) __s__.length ();
+        return String (__s__.substr (from, to - from));
+      }
+
+      void replace (char find, char replace)          { for (auto &c : __s__) if (c == find) c = replace; }
+      void replace (const String &find, const String &replace) {
+        if (!find.length ()) return;
+        size_t p = 0;
+        while ((p = __s__.find (find.__s__, p)) != std::string::npos) { __s__.replace (p, find.__s__.length (), replace.__s__); p += replace.__s__.length (); }
+      }
+      void remove (unsigned int index)                { if (index < __s__.length ()) __s__.erase (index); }
+      void remove (unsigned int index, unsigned int count) { if (index < __s__.length ()) __s__.erase (index, count); }
+      void toLowerCase ()                             { for (auto &c : __s__) c = tolower (c); }
+      void toUpperCase ()                             { for (auto &c : __s__) c = toupper (c); }
+      void trim () {
+        size_t b = 0, e = __s__.length ();
+        while (b < e && isspace ((unsigned char) __s__ [b])) b ++;
+        while (e > b && isspace ((unsigned char) __s__ [e - 1])) e --;
+        __s__ = __s__.substr (b, e - b);
+      }
+
+      long toInt () const                             { return atol (c_str ()); }
+      float toFloat () const                          { return (float) atof (c_str ()); }
+      double toDouble () const                        { return atof (c_str ()); }
+
+      void getBytes (unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const { toCharArray ((char *) buf, bufsize, index); }
+      void toCharArray (char *buf, unsigned int bufsize, unsigned int index = 0) const {
+        if (!bufsize || !buf) return;
+        if (index >= __s__.length ()) { *buf = 0; return; }
+        size_t n = __s__.length () - index; if (n > bufsize - 1) n = bufsize - 1;
+        memcpy (buf, c_str () + index, n); buf [n] = 0;
+      }
+
+      friend String operator + (const String &a, const String &b)   { return String (a.__s__ + b.__s__); }
+      friend String operator + (const String &a, const char *b)     { String r (a); r += b; return r; }
+      friend String operator + (const char *a, const String &b)     { String r (a); r += b; return r; }
+
+      friend bool operator == (const String &a, const String &b)    { return a.__s__ == b.__s__; }
+      friend bool operator == (const String &a, const char *b)      { return a.equals (b); }
+      friend bool operator == (const char *a, const String &b)      { return b.equals (a); }
+      friend bool operator != (const String &a, const String &b)    { return !(a == b); }
+      friend bool operator != (const String &a, const char *b)      { return !(a == b); }
+      friend bool operator != (const char *a, const String &b)      { return !(a == b); }
+      friend bool operator <  (const String &a, const String &b)    { return a.compareTo (b) < 0; }
+      friend bool operator >  (const String &a, const String &b)    { return a.compareTo (b) > 0; }
+      friend bool operator <= (const String &a, const String &b)    { return a.compareTo (b) <= 0; }
+      friend bool operator >= (const String &a, const String &b)    { return a.compareTo (b) >= 0; }
+
+    private:
+
+      std::string __s__;
+
+      void __fromUnsigned__ (unsigned long long value, unsigned char base) {
+        if (base < 2 || base > 36) base = 10;
+        char buf [8 * sizeof (value) + 1]; char *p = buf + sizeof (buf); *--p = 0;
+        do { unsigned d = (unsigned) (value % base); *--p = (char) (d < 10 ? '0' + d : 'a' + d - 10); value /= base; } while (value);
+        __s__ = p;
+      }
+
+      void __fromDouble__ (double value, unsigned char decimalPlaces) {
+        char buf [64];
+        snprintf (buf, sizeof (buf), "%.*f", (int) decimalPlaces, value);
+        __s__ = buf;
+      }
+
+  };
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * WiFi.h - host (Linux) replacement for Arduino ESP32 WiFi library
+ *
+ *  There is no WiFi on host. WiFi object pretends to be connected as soon as it is started and
+ *  reports loopback address. WiFiClient and WiFiUDP are implemented with Linux sockets.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_WIFI__
+  #define __HOST_WIFI__
+
+  #include "Arduino.h"
+  #include "lwip/sockets.h"
+  #include "esp_wifi.h"
+
+  // ----- IPAddress -----
+
+  class IPAddress {
+    public:
+      IPAddress ()                                                { __address__.dword = 0; }
+      IPAddress (uint8_t a, uint8_t b, uint8_t c, uint8_t d)     { __address__.bytes [0] = a; __address__.bytes [1] = b; __address__.bytes [2] = c; __address__.bytes [3] = d; }
+      IPAddress (uint32_t address)                                { __address__.dword = address; }
+      operator uint32_t () const                                  { return __address__.dword; }
+      uint8_t operator [] (int index) const                       { return __address__.bytes [index]; }
+      uint8_t &operator [] (int index)                            { return __address__.bytes [index]; }
+      bool operator == (const IPAddress &a) const                 { return __address__.dword == a.__address__.dword; }
+      bool fromString (const char *s)                             { struct in_addr a; if (!inet_aton (s, &a)) return false; __address__.dword = a.s_addr; return true; }
+      String toString () const                                    { char s [16]; sprintf (s, "%u.%u.%u.%u", __address__.bytes [0], __address__.bytes [1], __address__.bytes [2], __address__.bytes [3]); return String (s); }
+    private:
+      union {
+        uint8_t bytes [4];
+        uint32_t dword;
+      } __address__;
+  };
+
+  // ----- WiFi events -----
+
+  typedef enum {
+    SYSTEM_EVENT_WIFI_READY = 0,
+    SYSTEM_EVENT_SCAN_DONE,
+    SYSTEM_EVENT_STA_START,
+    SYSTEM_EVENT_STA_STOP,
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+    SYSTEM_EVENT_STA_GOT_IP,
+    SYSTEM_EVENT_STA_LOST_IP,
+    SYSTEM_EVENT_STA_WPS_ER_SUCCESS,
+    SYSTEM_EVENT_STA_WPS_ER_FAILED,
+    SYSTEM_EVENT_STA_WPS_ER_TIMEOUT,
+    SYSTEM_EVENT_STA_WPS_ER_PIN,
+    SYSTEM_EVENT_AP_START,
+    SYSTEM_EVENT_AP_STOP,
+    SYSTEM_EVENT_AP_STACONNECTED,
+    SYSTEM_EVENT_AP_STADISCONNECTED,
+    SYSTEM_EVENT_AP_STAIPASSIGNED,
+    SYSTEM_EVENT_AP_PROBEREQRECVED,
+    SYSTEM_EVENT_GOT_IP6,
+    SYSTEM_EVENT_ETH_START,
+    SYSTEM_EVENT_ETH_STOP,
+    SYSTEM_EVENT_ETH_CONNECTED,
+    SYSTEM_EVENT_ETH_DISCONNECTED,
+    SYSTEM_EVENT_ETH_GOT_IP,
+    SYSTEM_EVENT_MAX
+  } system_event_id_t;
+  typedef system_event_id_t WiFiEvent_t;
+  typedef union {
+    uint32_t dummy;
+  } WiFiEventInfo_t;
+  typedef void (*WiFiEventFullCb) (WiFiEvent_t event, WiFiEventInfo_t info);
+
+  typedef enum {
+    WL_IDLE_STATUS      = 0,
+    WL_NO_SSID_AVAIL    = 1,
+    WL_SCAN_COMPLETED   = 2,
+    WL_CONNECTED        = 3,
+    WL_CONNECT_FAILED   = 4,
+    WL_CONNECTION_LOST  = 5,
+    WL_DISCONNECTED     = 6,
+    WL_NO_SHIELD        = 255
+  } wl_status_t;
+
+  #define WIFI_OFF    WIFI_MODE_NULL
+  #define WIFI_STA    WIFI_MODE_STA
+  #define WIFI_AP     WIFI_MODE_AP
+  #define WIFI_AP_STA WIFI_MODE_APSTA
+
+  // ----- WiFi -----
+
+  class WiFiClass {
+    public:
+      bool mode (wifi_mode_t m)                                   { __hostWiFiMode__ () = m; return true; }
+      wifi_mode_t getMode ()                                      { return __hostWiFiMode__ (); }
+      bool config (IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t) 0, IPAddress dns2 = (uint32_t) 0) { (void) localIP; (void) gateway; (void) subnet; (void) dns1; (void) dns2; return true; }
+      wl_status_t begin (const char *ssid = NULL, const char *password = NULL) {
+        (void) password;
+        if (ssid) __ssid__ = ssid;
+        __status__ = WL_CONNECTED;
+        __event__ (SYSTEM_EVENT_STA_START); __event__ (SYSTEM_EVENT_STA_CONNECTED); __event__ (SYSTEM_EVENT_STA_GOT_IP);
+        return __status__;
+      }
+      bool disconnect (bool wifiOff = false)                      { if (__status__ == WL_CONNECTED) __event__ (SYSTEM_EVENT_STA_DISCONNECTED); __status__ = WL_DISCONNECTED; if (wifiOff) mode (WIFI_OFF); return true; }
+      bool reconnect ()                                           { begin (); return true; }
+      bool softAP (const char *ssid, const char *password = NULL) { (void) ssid; (void) password; __event__ (SYSTEM_EVENT_AP_START); return true; }
+      bool softAPConfig (IPAddress localIP, IPAddress gateway, IPAddress subnet) { (void) localIP; (void) gateway; (void) subnet; return true; }
+      IPAddress softAPIP ()                                       { return IPAddress (127, 0, 0, 1); }
+      wl_status_t status ()                                       { return __status__; }
+      IPAddress localIP ()                                        { return IPAddress (127, 0, 0, 1); }
+      IPAddress gatewayIP ()                                      { return IPAddress (127, 0, 0, 1); }
+      IPAddress subnetMask ()                                     { return IPAddress (255, 0, 0, 0); }
+      int8_t RSSI ()                                              { return __status__ == WL_CONNECTED ? -50 : 0; }
+      String SSID ()                                              { return __ssid__; }
+      String macAddress ()                                        { return "00:00:00:00:00:00"; }
+      bool setHostname (const char *hostname)                     { __hostname__ = hostname; return true; }
+      const char *getHostname ()                                  { return __hostname__.c_str (); }
+      void onEvent (WiFiEventFullCb callback)                     { __callback__ = callback; }
+      int hostByName (const char *hostName, IPAddress &result) {
+        struct addrinfo hints = {}, *res;
+        hints.ai_family = AF_INET;
+        if (getaddrinfo (hostName, NULL, &hints, &res) || !res) {
+          delay (1000); // lwip DNS client gives up only after its retries time-out, Linux resolver may fail immediately
+          return 0;
+        }
+        result = IPAddress ((uint32_t) ((struct sockaddr_in *) res->ai_addr)->sin_addr.s_addr);
+        freeaddrinfo (res);
+        return 1;
+      }
+    private:
+      wl_status_t __status__ = WL_IDLE_STATUS;
+      String __ssid__ = "";
+      String __hostname__ = "localhost";
+      WiFiEventFullCb __callback__ = NULL;
+      void __event__ (WiFiEvent_t event) { if (__callback__) { WiFiEventInfo_t info = {}; __callback__ (event, info); } }
+  };
+  inline WiFiClass WiFi;
+
+  // ----- WiFiClient -----
+
+  class WiFiClient {
+    public:
+      ~WiFiClient ()                                              { stop (); }
+      int connect (IPAddress ip, uint16_t port) {
+        stop ();
+        if ((__socket__ = socket (AF_INET, SOCK_STREAM, 0)) == -1) return 0;
+        struct sockaddr_in a = {};
+        a.sin_family = AF_INET;
+        a.sin_port = htons (port);
+        a.sin_addr.s_addr = (uint32_t) ip;
+        if (::connect (__socket__, (struct sockaddr *) &a, sizeof (a)) == -1) { stop (); return 0; }
+        return 1;
+      }
+      size_t print (const String &s)                              { return write ((const uint8_t *) s.c_str (), s.length ()); }
+      size_t write (const uint8_t *buf, size_t size)              { if (__socket__ == -1) return 0; ssize_t n = send (__socket__, buf, size, MSG_NOSIGNAL); return n < 0 ? 0 : n; }
+      int available () {
+        int n = 0;
+        if (__socket__ == -1 || ioctl (__socket__, FIONREAD, &n) == -1) return 0;
+        return n;
+      }
+      uint8_t connected () {
+        if (__socket__ == -1) return 0;
+        char c;
+        ssize_t n = recv (__socket__, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n > 0 || (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+      }
+      int read ()                                                 { unsigned char c; return __socket__ != -1 && recv (__socket__, &c, 1, MSG_DONTWAIT) == 1 ? c : -1; }
+      void stop ()                                                { if (__socket__ != -1) { close (__socket__); __socket__ = -1; } }
+    private:
+      int __socket__ = -1;
+  };
+
+  // ----- WiFiUDP -----
+
+  class WiFiUDP {
+    public:
+      ~WiFiUDP ()                                                 { stop (); }
+      uint8_t begin (uint16_t port) {
+        stop ();
+        if ((__socket__ = socket (AF_INET, SOCK_DGRAM, 0)) == -1) return 0;
+        int yes = 1; setsockopt (__socket__, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof (yes));
+        struct sockaddr_in a = {};
+        a.sin_family = AF_INET;
+        a.sin_port = htons (port);
+        a.sin_addr.s_addr = htonl (INADDR_ANY);
+        if (::bind (__socket__, (struct sockaddr *) &a, sizeof (a)) == -1) { stop (); return 0; }
+        fcntl (__socket__, F_SETFL, O_NONBLOCK);
+        return 1;
+      }
+      int beginPacket (IPAddress ip, uint16_t port) {
+        if (__socket__ == -1) return 0;
+        __remote__ = {};
+        __remote__.sin_family = AF_INET;
+        __remote__.sin_port = htons (port);
+        __remote__.sin_addr.s_addr = (uint32_t) ip;
+        __packet__.clear ();
+        return 1;
+      }
+      size_t write (const uint8_t *buf, size_t size)              { __packet__.insert (__packet__.end (), buf, buf + size); return size; }
+      int endPacket ()                                            { return __socket__ != -1 && sendto (__socket__, __packet__.data (), __packet__.size (), 0, (struct sockaddr *) &__remote__, sizeof (__remote__)) == (ssize_t) __packet__.size (); }
+      int parsePacket () {
+        if (__socket__ == -1) return 0;
+        uint8_t buf [1500];
+        ssize_t n = recv (__socket__, buf, sizeof (buf), MSG_DONTWAIT);
+        if (n <= 0) return 0;
+        __packet__.assign (buf, buf + n);
+        __readPosition__ = 0;
+        return (int) n;
+      }
+      int read (uint8_t *buf, size_t len) {
+        size_t n = std::min (len, __packet__.size () - __readPosition__);
+        memcpy (buf, __packet__.data () + __readPosition__, n);
+        __readPosition__ += n;
+        return (int) n;
+      }
+      int read (char *buf, size_t len)                            { return read ((uint8_t *) buf, len); }
+      void stop ()                                                { if (__socket__ != -1) { close (__socket__); __socket__ = -1; } }
+    private:
+      int __socket__ = -1;
+      struct sockaddr_in __remote__ = {};
+      std::vector<uint8_t> __packet__;
+      size_t __readPosition__ = 0;
+  };
+
+#endif
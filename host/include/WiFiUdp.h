@@ -0,0 +1,2 @@
+// host build: WiFiUDP is declared in WiFi.h
+#include "WiFi.h"
@@ -0,0 +1,7 @@
+// host build: there is no interrupt watchdog on host
+#ifndef __HOST_ESP_INT_WDT__
+  #define __HOST_ESP_INT_WDT__
+
+  inline void esp_int_wdt_init () {}
+
+#endif
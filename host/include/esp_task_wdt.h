@@ -0,0 +1,13 @@
+// host build: task watchdog - telnet reset command relies on watchdog resetting the chip, exit instead
+#ifndef __HOST_ESP_TASK_WDT__
+  #define __HOST_ESP_TASK_WDT__
+
+  #include <stdio.h>
+  #include <unistd.h>
+  #include "Arduino.h"
+
+  inline esp_err_t esp_task_wdt_init (uint32_t timeout, bool panic) { (void) timeout; (void) panic; return ESP_OK; }
+  inline esp_err_t esp_task_wdt_add (TaskHandle_t handle) { (void) handle; printf ("\n[host] task watchdog reset requested, exiting\n"); _exit (0); return ESP_OK; }
+  inline esp_err_t esp_task_wdt_reset () { return ESP_OK; }
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * esp_wifi.h - host (Linux) replacement for ESP-IDF WiFi driver API
+ *
+ *  There is no WiFi on host, the driver only remembers its mode and reports no connected stations.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_ESP_WIFI__
+  #define __HOST_ESP_WIFI__
+
+  #include <stdint.h>
+  #include <stdbool.h>
+  #include "Arduino.h"
+  #include "lwip/ip_addr.h"
+
+  typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+    WIFI_MODE_MAX
+  } wifi_mode_t;
+
+  typedef enum {
+    WIFI_IF_STA = 0,
+    WIFI_IF_AP
+  } wifi_interface_t;
+
+  typedef enum {
+    TCPIP_ADAPTER_IF_STA = 0,
+    TCPIP_ADAPTER_IF_AP,
+    TCPIP_ADAPTER_IF_ETH,
+    TCPIP_ADAPTER_IF_MAX
+  } tcpip_adapter_if_t;
+
+  #define ESP_WIFI_MAX_CONN_NUM 10
+
+  typedef struct {
+    uint8_t mac [6];
+    int8_t rssi;
+  } wifi_sta_info_t;
+
+  typedef struct {
+    wifi_sta_info_t sta [ESP_WIFI_MAX_CONN_NUM];
+    int num;
+  } wifi_sta_list_t;
+
+  typedef struct {
+    uint8_t mac [6];
+    ip4_addr_t ip;
+  } tcpip_adapter_sta_info_t;
+
+  typedef struct {
+    tcpip_adapter_sta_info_t sta [ESP_WIFI_MAX_CONN_NUM];
+    int num;
+  } tcpip_adapter_sta_list_t;
+
+  typedef enum {
+    WIFI_PKT_MGMT,
+    WIFI_PKT_CTRL,
+    WIFI_PKT_DATA,
+    WIFI_PKT_MISC
+  } wifi_promiscuous_pkt_type_t;
+
+  #define WIFI_PROMIS_FILTER_MASK_ALL   0xFFFFFFFF
+  #define WIFI_PROMIS_FILTER_MASK_MGMT  (1)
+  #define WIFI_PROMIS_FILTER_MASK_CTRL  (1 << 1)
+  #define WIFI_PROMIS_FILTER_MASK_DATA  (1 << 2)
+
+  typedef struct {
+    uint32_t filter_mask;
+  } wifi_promiscuous_filter_t;
+
+  typedef struct {
+    signed rssi:8;
+    unsigned rate:5;
+    unsigned channel:4;
+    unsigned sig_len:12;
+  } wifi_pkt_rx_ctrl_t;
+
+  typedef struct {
+    wifi_pkt_rx_ctrl_t rx_ctrl;
+    uint8_t payload [0];
+  } wifi_promiscuous_pkt_t;
+
+  typedef void (*wifi_promiscuous_cb_t) (void *buf, wifi_promiscuous_pkt_type_t type);
+
+  inline wifi_mode_t &__hostWiFiMode__ () { static wifi_mode_t mode = WIFI_MODE_NULL; return mode; }
+
+  inline esp_err_t esp_wifi_get_mode (wifi_mode_t *mode)                                                { *mode = __hostWiFiMode__ (); return ESP_OK; }
+  inline esp_err_t esp_wifi_set_mode (wifi_mode_t mode)                                                 { __hostWiFiMode__ () = mode; return ESP_OK; }
+  inline esp_err_t esp_wifi_ap_get_sta_list (wifi_sta_list_t *sta)                                      { sta->num = 0; return ESP_OK; }
+  inline esp_err_t tcpip_adapter_get_sta_list (const wifi_sta_list_t *wifi_sta_list, tcpip_adapter_sta_list_t *tcpip_sta_list) { (void) wifi_sta_list; tcpip_sta_list->num = 0; return ESP_OK; }
+  inline esp_err_t tcpip_adapter_set_hostname (tcpip_adapter_if_t tcpip_if, const char *hostname)       { (void) tcpip_if; (void) hostname; return ESP_OK; }
+  inline esp_err_t esp_wifi_set_promiscuous (bool en)                                                   { (void) en; return ESP_OK; }
+  inline esp_err_t esp_wifi_set_promiscuous_filter (const wifi_promiscuous_filter_t *filter)            { (void) filter; return ESP_OK; }
+  inline esp_err_t esp_wifi_set_promiscuous_rx_cb (wifi_promiscuous_cb_t cb)                            { (void) cb; return ESP_OK; }
+
+#endif
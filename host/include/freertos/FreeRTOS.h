@@ -0,0 +1,256 @@
+/*
+ * FreeRTOS.h - host (Linux) replacement for the part of ESP-IDF FreeRTOS that servers use
+ *
+ *  Tasks are mapped to detached pthreads, semaphores and queues to mutex + condition variable pairs and
+ *  portMUX critical sections to recursive spin locks. Task stacks are charged against the simulated
+ *  ESP32 heap (see ESP.getFreeHeap () in Arduino.h) so that heap-based decisions behave as on ESP32.
+ *  A task pinned to a core gets pthread CPU affinity: ESP32 core n is host CPU n modulo the number of online CPUs.
+ *  Priorities are ignored, all the threads run with the default Linux scheduling policy.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added queues,
+ *            October 16, 2026
+ *          - xTaskCreatePinnedToCore sets pthread CPU affinity
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_FREERTOS__
+  #define __HOST_FREERTOS__
+
+  #include <stdint.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <limits.h>
+  #include <unistd.h>
+  #include <mutex>
+  #include <condition_variable>
+  #include <chrono>
+  #include <atomic>
+  #include <deque>
+  #include <vector>
+  #include <string.h>
+
+  typedef int           BaseType_t;
+  typedef unsigned int  UBaseType_t;
+  typedef uint32_t      TickType_t;
+  typedef void          (*TaskFunction_t) (void *);
+  typedef void          *TaskHandle_t;
+
+  #define pdFALSE                             0
+  #define pdTRUE                              1
+  #define pdFAIL                              pdFALSE
+  #define pdPASS                              pdTRUE
+  #define errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY (-1)
+  #define portMAX_DELAY                       ((TickType_t) 0xffffffffUL)
+  #define configTICK_RATE_HZ                  1000
+  #define portTICK_PERIOD_MS                  ((TickType_t) 1000 / configTICK_RATE_HZ)
+  #define portTICK_RATE_MS                    portTICK_PERIOD_MS
+  #define pdMS_TO_TICKS(ms)                   ((TickType_t) (ms))
+  #define configMAX_PRIORITIES                25
+  #define portNUM_PROCESSORS                  2
+  #define tskNO_AFFINITY                      0x7FFFFFFF
+
+  // ----- simulated heap accounting (task stacks are charged here, malloc-ed memory is measured in Arduino.h) -----
+
+  inline std::atomic<long> &__hostChargedStackBytes__ () { static std::atomic<long> b (0); return b; }
+  uint32_t __hostFreeHeap__ (); // defined in Arduino.h
+
+  // ----- tasks -----
+
+  struct __hostTaskStart__ {
+    TaskFunction_t function;
+    void *parameter;
+    long stackBytes;
+  };
+
+  struct __hostStackCharge__ { // uncharges task stack when thread ends, even if it ends with pthread_exit
+    long bytes = 0;
+    ~__hostStackCharge__ () { __hostChargedStackBytes__ () -= bytes; }
+  };
+
+  inline void *__hostTaskTrampoline__ (void *p) {
+    __hostTaskStart__ start = *(__hostTaskStart__ *) p;
+    delete (__hostTaskStart__ *) p;
+    static thread_local __hostStackCharge__ charge;
+    charge.bytes = start.stackBytes;
+    start.function (start.parameter);
+    // FreeRTOS tasks must never return, they have to call vTaskDelete (NULL), but be tolerant here
+    return NULL;
+  }
+
+  inline BaseType_t xTaskCreatePinnedToCore (TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t coreId) {
+    (void) name; (void) priority;
+    // ESP32 stack depth is in bytes, it comes from the heap - fail the same way ESP32 fails when there is not enough heap
+    if (stackDepth > __hostFreeHeap__ ()) return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    __hostChargedStackBytes__ () += stackDepth;
+
+    pthread_attr_t attr;
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    // x86_64 code needs considerably more stack than Xtensa code, give each task at least 256 KB of (lazily committed) virtual memory
+    size_t hostStackSize = (size_t) stackDepth * 16;
+    if (hostStackSize < 256 * 1024) hostStackSize = 256 * 1024;
+    if (hostStackSize < (size_t) PTHREAD_STACK_MIN) hostStackSize = PTHREAD_STACK_MIN;
+    pthread_attr_setstacksize (&attr, hostStackSize);
+    if (coreId != tskNO_AFFINITY) {
+      cpu_set_t cpus;
+      CPU_ZERO (&cpus);
+      long onlineCpus = sysconf (_SC_NPROCESSORS_ONLN);
+      CPU_SET ((int) (coreId % (onlineCpus > 0 ? onlineCpus : 1)), &cpus);
+      pthread_attr_setaffinity_np (&attr, sizeof (cpus), &cpus);
+    }
+
+    __hostTaskStart__ *start = new __hostTaskStart__ {function, parameter, (long) stackDepth};
+    pthread_t thread;
+    int e = pthread_create (&thread, &attr, __hostTaskTrampoline__, start);
+    pthread_attr_destroy (&attr);
+    if (e) {
+      delete start;
+      __hostChargedStackBytes__ () -= stackDepth;
+      return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    if (handle) *handle = (TaskHandle_t) thread;
+    return pdPASS;
+  }
+
+  inline BaseType_t xTaskCreate (TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter, UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore (function, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+  }
+
+  inline void vTaskDelete (TaskHandle_t handle) {
+    if (handle == NULL || (pthread_t) handle == pthread_self ()) pthread_exit (NULL);
+    pthread_cancel ((pthread_t) handle);
+  }
+
+  inline void vTaskDelay (TickType_t ticks) {
+    if (ticks) usleep ((useconds_t) ticks * 1000 * portTICK_PERIOD_MS);
+    else sched_yield ();
+  }
+
+  inline TaskHandle_t xTaskGetCurrentTaskHandle () { return (TaskHandle_t) pthread_self (); }
+
+  inline BaseType_t xPortGetCoreID () { int c = sched_getcpu (); return c < 0 ? 0 : c % portNUM_PROCESSORS; }
+
+  inline TickType_t xTaskGetTickCount () {
+    return (TickType_t) std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+  }
+
+  // ----- semaphores -----
+
+  struct __hostSemaphore__ {
+    std::mutex mutex;
+    std::condition_variable condition;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+    __hostSemaphore__ (UBaseType_t max, UBaseType_t initial) : count (initial), maxCount (max) {}
+  };
+  typedef __hostSemaphore__ *SemaphoreHandle_t;
+  typedef SemaphoreHandle_t xSemaphoreHandle;
+
+  inline SemaphoreHandle_t xSemaphoreCreateMutex ()                                   { return new __hostSemaphore__ (1, 1); }
+  inline SemaphoreHandle_t xSemaphoreCreateBinary ()                                  { return new __hostSemaphore__ (1, 0); }
+  inline SemaphoreHandle_t xSemaphoreCreateCounting (UBaseType_t max, UBaseType_t initial) { return new __hostSemaphore__ (max, initial); }
+  #define vSemaphoreCreateBinary(s)           ((s) = new __hostSemaphore__ (1, 1))
+  inline void vSemaphoreDelete (SemaphoreHandle_t s)                                  { delete s; }
+
+  inline BaseType_t xSemaphoreTake (SemaphoreHandle_t s, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock (s->mutex);
+    if (ticks == portMAX_DELAY) {
+      s->condition.wait (lock, [s] { return s->count > 0; });
+    } else if (!s->condition.wait_for (lock, std::chrono::milliseconds (ticks * portTICK_PERIOD_MS), [s] { return s->count > 0; })) {
+      return pdFALSE;
+    }
+    s->count --;
+    return pdTRUE;
+  }
+
+  inline BaseType_t xSemaphoreGive (SemaphoreHandle_t s) {
+    std::lock_guard<std::mutex> lock (s->mutex);
+    if (s->count >= s->maxCount) return pdFALSE;
+    s->count ++;
+    s->condition.notify_one ();
+    return pdTRUE;
+  }
+
+  // ----- queues -----
+
+  struct __hostQueue__ {
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<std::vector<unsigned char>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    __hostQueue__ (UBaseType_t l, UBaseType_t s) : length (l), itemSize (s) {}
+  };
+  typedef __hostQueue__ *QueueHandle_t;
+  typedef QueueHandle_t xQueueHandle;
+
+  inline QueueHandle_t xQueueCreate (UBaseType_t length, UBaseType_t itemSize)       { return new __hostQueue__ (length, itemSize); }
+  inline void vQueueDelete (QueueHandle_t q)                                          { delete q; }
+  inline UBaseType_t uxQueueMessagesWaiting (QueueHandle_t q)                         { std::lock_guard<std::mutex> lock (q->mutex); return (UBaseType_t) q->items.size (); }
+  inline UBaseType_t uxQueueSpacesAvailable (QueueHandle_t q)                         { std::lock_guard<std::mutex> lock (q->mutex); return q->length - (UBaseType_t) q->items.size (); }
+
+  inline BaseType_t xQueueSend (QueueHandle_t q, const void *item, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock (q->mutex);
+    auto notFull = [q] { return q->items.size () < q->length; };
+    if (ticks == portMAX_DELAY) q->notFull.wait (lock, notFull);
+    else if (!q->notFull.wait_for (lock, std::chrono::milliseconds (ticks * portTICK_PERIOD_MS), notFull)) return pdFALSE;
+    q->items.emplace_back ((const unsigned char *) item, (const unsigned char *) item + q->itemSize);
+    q->notEmpty.notify_one ();
+    return pdTRUE;
+  }
+  #define xQueueSendToBack(q, item, ticks) xQueueSend (q, item, ticks)
+
+  inline BaseType_t xQueueReceive (QueueHandle_t q, void *buffer, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock (q->mutex);
+    auto notEmpty = [q] { return !q->items.empty (); };
+    if (ticks == portMAX_DELAY) q->notEmpty.wait (lock, notEmpty);
+    else if (!q->notEmpty.wait_for (lock, std::chrono::milliseconds (ticks * portTICK_PERIOD_MS), notEmpty)) return pdFALSE;
+    memcpy (buffer, q->items.front ().data (), q->itemSize);
+    q->items.pop_front ();
+    q->notFull.notify_one ();
+    return pdTRUE;
+  }
+
+  // ----- critical sections: recursive spin locks, like ESP32 portMUX -----
+
+  typedef struct {
+    volatile uint32_t owner;
+    volatile uint32_t count;
+  } portMUX_TYPE;
+  #define portMUX_FREE_VAL                    0
+  #define portMUX_INITIALIZER_UNLOCKED        {portMUX_FREE_VAL, 0}
+
+  inline uint32_t __hostThreadId__ () {
+    static std::atomic<uint32_t> lastId (0);
+    static thread_local uint32_t id = ++ lastId;
+    return id;
+  }
+
+  inline void vPortCPUAcquireMutex (portMUX_TYPE *mux) {
+    uint32_t me = __hostThreadId__ ();
+    if (__atomic_load_n (&mux->owner, __ATOMIC_ACQUIRE) == me) { mux->count ++; return; }
+    for (int spins = 0; ; spins ++) {
+      uint32_t expected = portMUX_FREE_VAL;
+      if (__atomic_compare_exchange_n (&mux->owner, &expected, me, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) break;
+      if (spins > 100) sched_yield (); // host threads can be preempted while holding the lock, do not burn the CPU
+    }
+    mux->count = 1;
+  }
+
+  inline void vPortCPUReleaseMutex (portMUX_TYPE *mux) {
+    if (-- mux->count == 0) __atomic_store_n (&mux->owner, portMUX_FREE_VAL, __ATOMIC_RELEASE);
+  }
+
+  #define portENTER_CRITICAL(mux)             vPortCPUAcquireMutex (mux)
+  #define portEXIT_CRITICAL(mux)              vPortCPUReleaseMutex (mux)
+  #define portENTER_CRITICAL_ISR(mux)         vPortCPUAcquireMutex (mux)
+  #define portEXIT_CRITICAL_ISR(mux)          vPortCPUReleaseMutex (mux)
+  #define taskENTER_CRITICAL(mux)             vPortCPUAcquireMutex (mux)
+  #define taskEXIT_CRITICAL(mux)              vPortCPUReleaseMutex (mux)
+
+#endif
@@ -0,0 +1,2 @@
+// host build: everything is declared in FreeRTOS.h
+#include "FreeRTOS.h"
@@ -0,0 +1,32 @@
+// host build: ESP32 hardware SHA is replaced by OpenSSL libcrypto
+#ifndef __HOST_HWCRYPTO_SHA__
+  #define __HOST_HWCRYPTO_SHA__
+
+  #include <stddef.h>
+  #include <openssl/evp.h>
+  #include "Arduino.h"
+
+  typedef enum {
+    SHA1 = 0,
+    SHA2_256,
+    SHA2_384,
+    SHA2_512,
+    SHA_TYPE_MAX
+  } esp_sha_type;
+
+  inline void esp_sha (esp_sha_type type, const unsigned char *input, size_t ilen, unsigned char *output) {
+    const EVP_MD *md = type == SHA1 ? EVP_sha1 () : type == SHA2_256 ? EVP_sha256 () : type == SHA2_384 ? EVP_sha384 () : EVP_sha512 ();
+    EVP_Digest (input, ilen, output, NULL, md, NULL);
+  }
+
+  struct __hostOpenSslInitialization__ { // OpenSSL allocates its context at first use, do it now and exclude it from ESP32 heap
+    __hostOpenSslInitialization__ () {
+      __hostExcludeFromHeap__ exclude;
+      unsigned char digest [EVP_MAX_MD_SIZE];
+      EVP_Digest ("", 0, digest, NULL, EVP_sha1 (), NULL);
+      EVP_Digest ("", 0, digest, NULL, EVP_sha256 (), NULL);
+    }
+  };
+  inline __hostOpenSslInitialization__ __hostOpenSslInitializationInstance__;
+
+#endif
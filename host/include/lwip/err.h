@@ -0,0 +1,13 @@
+// host build: lwip error codes
+#ifndef __HOST_LWIP_ERR__
+  #define __HOST_LWIP_ERR__
+
+  typedef signed char err_t;
+
+  #define ERR_OK    0
+  #define ERR_MEM  -1
+  #define ERR_BUF  -2
+  #define ERR_TIMEOUT -3
+  #define ERR_VAL  -6
+
+#endif
@@ -0,0 +1,17 @@
+// host build: lwip Internet checksum
+#ifndef __HOST_LWIP_INET_CHKSUM__
+  #define __HOST_LWIP_INET_CHKSUM__
+
+  #include <arpa/inet.h>
+  #include "lwip/ip_addr.h"
+
+  inline u16_t inet_chksum (const void *dataptr, u16_t len) {
+    const u8_t *p = (const u8_t *) dataptr;
+    u32_t sum = 0;
+    for (; len > 1; len -= 2, p += 2) sum += (u32_t) ((p [0] << 8) | p [1]);
+    if (len) sum += (u32_t) (p [0] << 8);
+    while (sum >> 16) sum = (sum & 0xffff) + (sum >> 16);
+    return htons ((u16_t) ~sum);
+  }
+
+#endif
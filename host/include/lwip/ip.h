@@ -0,0 +1,27 @@
+// host build: lwip IP header definitions
+#ifndef __HOST_LWIP_IP__
+  #define __HOST_LWIP_IP__
+
+  #include "lwip/ip_addr.h"
+
+  #define IP_PROTO_ICMP 1
+  #define IP_PROTO_UDP  17
+  #define IP_PROTO_TCP  6
+
+  struct ip_hdr {
+    u8_t _v_hl;
+    u8_t _tos;
+    u16_t _len;
+    u16_t _id;
+    u16_t _offset;
+    u8_t _ttl;
+    u8_t _proto;
+    u16_t _chksum;
+    ip4_addr_t src;
+    ip4_addr_t dest;
+  };
+
+  #define IPH_V(hdr)  ((hdr)->_v_hl >> 4)
+  #define IPH_HL(hdr) ((hdr)->_v_hl & 0x0f)
+
+#endif
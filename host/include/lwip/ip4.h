@@ -0,0 +1,2 @@
+// host build: everything is declared in lwip/ip.h
+#include "lwip/ip.h"
@@ -0,0 +1,27 @@
+// host build: lwip address types
+#ifndef __HOST_LWIP_IP_ADDR__
+  #define __HOST_LWIP_IP_ADDR__
+
+  #include <stdint.h>
+
+  typedef uint8_t   u8_t;
+  typedef int8_t    s8_t;
+  typedef uint16_t  u16_t;
+  typedef int16_t   s16_t;
+  typedef uint32_t  u32_t;
+  typedef int32_t   s32_t;
+
+  typedef struct ip4_addr {
+    u32_t addr;
+  } ip4_addr_t;
+
+  typedef struct ip_addr {
+    union {
+      ip4_addr_t ip4;
+    } u_addr;
+    u8_t type;
+  } ip_addr_t;
+
+  #define IPADDR_TYPE_V4  0U
+
+#endif
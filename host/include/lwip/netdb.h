@@ -0,0 +1,3 @@
+// host build: lwip name resolution is Linux resolver
+#include <netdb.h>
+#include "lwip/sockets.h"
@@ -0,0 +1,32 @@
+// host build: lwip network interface list - only loopback interface is reported
+#ifndef __HOST_LWIP_NETIF__
+  #define __HOST_LWIP_NETIF__
+
+  #include <arpa/inet.h>
+  #include "lwip/ip_addr.h"
+
+  #define NETIF_MAX_HWADDR_LEN  6U
+  #define NETIF_FLAG_UP         0x01U
+
+  struct netif {
+    struct netif *next;
+    ip_addr_t ip_addr;
+    ip_addr_t netmask;
+    ip_addr_t gw;
+    const char *hostname;
+    u16_t mtu;
+    u8_t hwaddr [NETIF_MAX_HWADDR_LEN];
+    u8_t hwaddr_len;
+    u8_t flags;
+    char name [2];
+    u8_t num;
+  };
+
+  inline struct netif *__hostLoopbackNetif__ () {
+    static struct netif lo = {NULL, {{{htonl (INADDR_LOOPBACK)}}, 0}, {{{htonl (0xff000000)}}, 0}, {{{0}}, 0}, "localhost", 65535, {0}, 6, NETIF_FLAG_UP, {'l', 'o'}, 0};
+    return &lo;
+  }
+  #define netif_list            (__hostLoopbackNetif__ ())
+  #define netif_is_up(netif)    (((netif)->flags & NETIF_FLAG_UP) ? (u8_t) 1 : (u8_t) 0)
+
+#endif
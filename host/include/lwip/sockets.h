@@ -0,0 +1,86 @@
+/*
+ * lwip/sockets.h - host (Linux) replacement for lwip socket API
+ *
+ *  lwip socket API is BSD socket API so Linux sockets are used directly. Like lwip compatibility
+ *  macros connect and bind are redirected to lwip_connect and lwip_bind which adapt Linux behaviour:
+ *
+ *  - servers are bound to loopback interface (127.0.0.1) instead of all interfaces,
+ *  - environment variable HOST_PORT_OFFSET (if set) is added to privileged ports (< 1024), so
+ *    HOST_PORT_OFFSET=8000 moves HTTP to 8080, FTP to 8021 and Telnet to 8023 (outgoing connections
+ *    to loopback are moved the same way),
+ *  - Linux EINPROGRESS (115) is reported as lwip EINPROGRESS (119) as TcpClient expects, Linux EINPROGRESS macro is undefined
+ *    afterwards so that TcpClient can define lwip's value without a warning.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HOST_LWIP_SOCKETS__
+  #define __HOST_LWIP_SOCKETS__
+
+  #include <sys/types.h>
+  #include <sys/socket.h>
+  #include <sys/uio.h>
+  #include <sys/ioctl.h>
+  #include <netinet/in.h>
+  #include <netinet/tcp.h>
+  #include <arpa/inet.h>
+  #include <netdb.h>
+  #include <fcntl.h>
+  #include <errno.h>
+  #include <unistd.h>
+  #include <stdlib.h>
+
+  #include "lwip/ip_addr.h"
+
+  #define LWIP_EINPROGRESS  119
+  #define closesocket(s)    close (s)
+  #define sin_len           sin_zero [0] // Linux struct sockaddr_in doesn't have sin_len member, use padding instead
+
+  inline int __hostPortOffset__ () {
+    static int offset = getenv ("HOST_PORT_OFFSET") ? atoi (getenv ("HOST_PORT_OFFSET")) : 0;
+    return offset;
+  }
+
+  inline void __hostAdjustAddress__ (struct sockaddr_in *a, bool binding) {
+    if (a->sin_family != AF_INET) return;
+    if (binding && a->sin_addr.s_addr == htonl (INADDR_ANY)) a->sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+    if ((binding || (ntohl (a->sin_addr.s_addr) >> 24) == 127) && ntohs (a->sin_port) && ntohs (a->sin_port) < 1024)
+      a->sin_port = htons (ntohs (a->sin_port) + __hostPortOffset__ ());
+  }
+
+  inline int lwip_bind (int s, const struct sockaddr *name, socklen_t namelen) {
+    if (name && name->sa_family == AF_INET && namelen >= (socklen_t) sizeof (struct sockaddr_in)) {
+      struct sockaddr_in a = *(const struct sockaddr_in *) name;
+      __hostAdjustAddress__ (&a, true);
+      return ::bind (s, (struct sockaddr *) &a, sizeof (a));
+    }
+    return ::bind (s, name, namelen);
+  }
+
+  inline int lwip_connect (int s, const struct sockaddr *name, socklen_t namelen) {
+    int r;
+    if (name && name->sa_family == AF_INET && namelen >= (socklen_t) sizeof (struct sockaddr_in)) {
+      struct sockaddr_in a = *(const struct sockaddr_in *) name;
+      __hostAdjustAddress__ (&a, false);
+      r = ::connect (s, (struct sockaddr *) &a, sizeof (a));
+    } else {
+      r = ::connect (s, name, namelen);
+    }
+    if (r == -1 && errno == EINPROGRESS) errno = LWIP_EINPROGRESS;
+    return r;
+  }
+
+  #undef EINPROGRESS // from now on it is lwip's value, TcpServer.hpp defines it as 119 like lwip does
+
+  inline ssize_t lwip_writev (int s, const struct iovec *iov, int iovcnt) { return ::writev (s, iov, iovcnt); }
+
+  inline char *inet_ntoa_r (struct in_addr addr, char *buf, int buflen) { return (char *) inet_ntop (AF_INET, &addr, buf, buflen); } // lwip's reentrant inet_ntoa
+
+  // lwip compatibility macros (function-like variadic macros so that member functions like WiFiClient::connect (ip, port) stay intact)
+  #define bind(...)         lwip_bind (__VA_ARGS__)
+  #define connect(...)      lwip_connect (__VA_ARGS__)
+
+#endif
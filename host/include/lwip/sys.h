@@ -0,0 +1,11 @@
+// host build: lwip memory functions
+#ifndef __HOST_LWIP_SYS__
+  #define __HOST_LWIP_SYS__
+
+  #include <stdlib.h>
+
+  typedef size_t mem_size_t;
+  #define mem_malloc(size)  malloc (size)
+  #define mem_free(p)       free (p)
+
+#endif
@@ -0,0 +1,18 @@
+// host build: mbedtls base64 is replaced by OpenSSL libcrypto
+#ifndef __HOST_MBEDTLS_BASE64__
+  #define __HOST_MBEDTLS_BASE64__
+
+  #include <stddef.h>
+  #include <openssl/evp.h>
+  #include "hwcrypto/sha.h" // initializes OpenSSL
+
+  #define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+  inline int mbedtls_base64_encode (unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+    size_t n = 4 * ((slen + 2) / 3);
+    if (dlen < n + 1) { *olen = n + 1; return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL; }
+    *olen = EVP_EncodeBlock (dst, src, (int) slen);
+    return 0;
+  }
+
+#endif
@@ -0,0 +1,45 @@
+// host build: mbedtls message digest is replaced by OpenSSL libcrypto
+#ifndef __HOST_MBEDTLS_MD__
+  #define __HOST_MBEDTLS_MD__
+
+  #include <stddef.h>
+  #include <openssl/evp.h>
+  #include "hwcrypto/sha.h" // initializes OpenSSL
+
+  typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_MD5,
+    MBEDTLS_MD_SHA1,
+    MBEDTLS_MD_SHA224,
+    MBEDTLS_MD_SHA256,
+    MBEDTLS_MD_SHA384,
+    MBEDTLS_MD_SHA512
+  } mbedtls_md_type_t;
+
+  typedef EVP_MD mbedtls_md_info_t;
+
+  typedef struct {
+    const mbedtls_md_info_t *md_info;
+    EVP_MD_CTX *md_ctx;
+  } mbedtls_md_context_t;
+
+  inline const mbedtls_md_info_t *mbedtls_md_info_from_type (mbedtls_md_type_t md_type) {
+    switch (md_type) {
+      case MBEDTLS_MD_MD5:    return EVP_md5 ();
+      case MBEDTLS_MD_SHA1:   return EVP_sha1 ();
+      case MBEDTLS_MD_SHA224: return EVP_sha224 ();
+      case MBEDTLS_MD_SHA256: return EVP_sha256 ();
+      case MBEDTLS_MD_SHA384: return EVP_sha384 ();
+      case MBEDTLS_MD_SHA512: return EVP_sha512 ();
+      default:                return NULL;
+    }
+  }
+
+  inline void mbedtls_md_init (mbedtls_md_context_t *ctx)                                     { ctx->md_info = NULL; ctx->md_ctx = NULL; }
+  inline int mbedtls_md_setup (mbedtls_md_context_t *ctx, const mbedtls_md_info_t *info, int hmac) { (void) hmac; ctx->md_info = info; return (ctx->md_ctx = EVP_MD_CTX_new ()) ? 0 : -1; }
+  inline int mbedtls_md_starts (mbedtls_md_context_t *ctx)                                    { return EVP_DigestInit_ex (ctx->md_ctx, ctx->md_info, NULL) == 1 ? 0 : -1; }
+  inline int mbedtls_md_update (mbedtls_md_context_t *ctx, const unsigned char *input, size_t ilen) { return EVP_DigestUpdate (ctx->md_ctx, input, ilen) == 1 ? 0 : -1; }
+  inline int mbedtls_md_finish (mbedtls_md_context_t *ctx, unsigned char *output)             { return EVP_DigestFinal_ex (ctx->md_ctx, output, NULL) == 1 ? 0 : -1; }
+  inline void mbedtls_md_free (mbedtls_md_context_t *ctx)                                     { if (ctx->md_ctx) EVP_MD_CTX_free (ctx->md_ctx); ctx->md_ctx = NULL; }
+
+#endif
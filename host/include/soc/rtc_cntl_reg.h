@@ -0,0 +1,7 @@
+// host build: there are no peripheral registers on host
+#ifndef __HOST_RTC_CNTL_REG__
+  #define __HOST_RTC_CNTL_REG__
+
+  #define RTC_CNTL_BROWN_OUT_REG 0
+
+#endif
@@ -0,0 +1,8 @@
+// host build: there are no peripheral registers on host
+#ifndef __HOST_SOC__
+  #define __HOST_SOC__
+
+  #define WRITE_PERI_REG(addr, val) ((void) (addr), (void) (val))
+  #define READ_PERI_REG(addr)       ((void) (addr), 0)
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * main.cpp - runs Esp32_web_ftp_telnet_server_template on Linux
+ *
+ *  The sketch and all the servers are compiled unmodified against host (POSIX) replacements of
+ *  Arduino, FreeRTOS, lwip, SPIFFS and WiFi found in host/include.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#include <Arduino.h>
+
+#include "../Esp32_web_ftp_telnet_server_template.ino"
+
+int main () {
+  setup ();
+  while (true) loop ();
+}
@@ -0,0 +1,563 @@
+/*
+ * AsyncTcpServer.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  AsyncTcpServer.hpp contains a single-threaded TCP server for ESP32 / Arduino environment. Instead of running a
+ *  connection handler in its own thread for each connection (like threaded TcpServer does) one event loop thread
+ *  drives all the connections of the server through non-blocking sockets and select (). The calling program provides
+ *  an event callback function that gets called for each of the following events:
+ *    - CONNECTED - a new connection has been accepted,
+ *    - DATA      - data has arrived,
+ *    - SENT      - all the data queued with sendData has been sent,
+ *    - TIMER     - timer set with setTimer () has expired,
+ *    - TIME_OUT  - connection has been inactive for longer than its time-out, the connection will be closed afterwards,
+ *    - CLOSED    - connection is about to be released, this is the place to free whatever has been stored in userData.
+ *  All the events are called from event loop thread, so event callback function must never block. When blocking processing
+ *  is needed the connection can be taken out of the event loop with detach () and handed over to a (threaded) TcpConnection.
+ *  When that is done the connection can be given back to the event loop with adopt () (from any thread), it gets CONNECTED
+ *  event again and continues with its admission slot and statistics. Adopting threads wake up the event loop with a datagram
+ *  sent to its loopback UDP socket.
+ *
+ *  An idle connection costs only the memory of AsyncTcpConnection instance and whatever the calling program keeps in userData,
+ *  there is no stack per connection.
+ *
+ *  Admission control (see TcpAdmissionControl in TcpServer.hpp) is applied when connections are accepted, a detached connection
+ *  keeps its admission slot if it is passed to TcpConnection. With setDeferredAdmission (true) connections are accepted without
+ *  a slot (only free heap is checked) and the calling program takes the slot with AsyncTcpConnection::admit () just before it
+ *  detaches the connection to a thread, so connections that are only waiting for data in the event loop don't count against
+ *  maxConnections. Adopted connections give their slot back when they return to the event loop then.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added admission control
+ *            October 16, 2026
+ *          - added optional TcpFirewall
+ *            October 16, 2026
+ *          - connections are listed in TcpConnectionRegistry, a detached connection hands its statistics over to TcpConnection
+ *            October 16, 2026
+ *          - added setReceiving () and sending (), needed by CoroutineTcpServer
+ *            October 16, 2026
+ *          - added optional per client IP connection rate limit
+ *            October 16, 2026
+ *          - event loop runs on the core and with the priority given by TcpTaskPolicy (listenerCore)
+ *            October 16, 2026
+ *          - added getConnectedMillis () and getBytesReceived ()
+ *            October 16, 2026
+ *          - added adopt () that gives a detached connection back to the event loop
+ *            October 16, 2026
+ *          - added deferred admission (setDeferredAdmission, AsyncTcpConnection::admit)
+ *            October 16, 2026
+ *          - QUEUE overflow leaves the rest of connections in listen backlog instead of rejecting them
+ *            October 16, 2026
+ */
+
+
+#ifndef __ASYNC_TCP_SERVER__
+  #define __ASYNC_TCP_SERVER__
+
+  #include "TcpServer.hpp"        // AsyncTcpServer uses the same includes, SPIFFSsafeDelay, __inet_ntos__ and TcpConnection::INFINITE
+
+
+  class AsyncTcpConnection {
+
+    public:
+
+      // sends as much data as possible immediately, the rest is kept and sent when the socket becomes writable, returns bufferSize or 0 indicating error or closed connection
+      int sendData (char *buffer, int bufferSize)
+                                                {
+                                                  if (__socket__ == -1 || __closing__) return 0;
+                                                  int written = 0;
+                                                  if (!__outputLength__) { // nothing is waiting to be sent, try sending right away
+                                                    written = send (__socket__, buffer, bufferSize, 0);
+                                                    if (written == -1) {
+                                                      if (errno != EAGAIN && errno != ENAVAIL) { __close__ (); return 0; }
+                                                      written = 0;
+                                                    }
+                                                    if (written) { __lastActiveMillis__ = millis (); __statistics__.bytesSent += written; }
+                                                  }
+                                                  if (written < bufferSize) { // keep the rest
+                                                    char *p = (char *) realloc (__output__, __outputLength__ + bufferSize - written);
+                                                    if (!p) { __close__ (); return 0; }
+                                                    memcpy (p + __outputLength__, buffer + written, bufferSize - written);
+                                                    __output__ = p;
+                                                    __outputLength__ += bufferSize - written;
+                                                  }
+                                                  return bufferSize;
+                                                }
+
+      int sendData (char string [])             { return sendData (string, strlen (string)); }
+
+      int sendData (String string)              { return sendData ((char *) string.c_str (), string.length ()); }
+
+      void closeConnection ()                   { __closing__ = true; } // connection will be closed as soon as everything queued with sendData has been sent
+
+      // deferred admission (see AsyncTcpServer::setDeferredAdmission): takes admission slot for the connection, returns false if limits are exceeded
+      bool admit ()                             {
+                                                  if (__admitted__ || !__admission__) return true;
+                                                  return __admitted__ = __admission__->admit (__otherSideIP__);
+                                                }
+
+      int detach (TcpAdmissionControl **admission = NULL, tcpConnectionStatistics *statistics = NULL) { // takes the connection out of the event loop without closing it, the caller becomes the owner of the returned socket
+                                                  if (statistics) { *statistics = __statistics__; __statisticsHandedOver__ = true; } // the caller should pass statistics to TcpConnection so they continue there
+                                                  if (admission) { // the caller should pass admission slot to TcpConnection, otherwise it is released now
+                                                    *admission = __admitted__ ? __admission__ : NULL;
+                                                    if (__admitted__) { __admission__ = NULL; __admitted__ = false; }
+                                                  }
+                                                  int connectionSocket = __socket__;
+                                                  __socket__ = -1; // event loop will release this instance (and call CLOSED event) when the callback returns
+                                                  return connectionSocket;
+                                                }
+
+      char *getOtherSideIP ()                   { return __otherSideIP__; }
+
+      unsigned long getTimeOut ()               { return __timeOutMillis__; }
+
+      unsigned long getConnectedMillis ()       { return __connectedMillis__; } // millis () when connection has been accepted or adopted
+
+      unsigned long getBytesReceived ()         { return __statistics__.bytesReceived; } // since the connection has been accepted, including the time it was detached
+
+      void setTimeOut (unsigned long timeOutMillis) { __timeOutMillis__ = timeOutMillis; __lastActiveMillis__ = millis (); }
+
+      void setTimer (unsigned long timerMillis) { __timerMillis__ = timerMillis; __timerStartMillis__ = millis (); } // TIMER event will occur after timerMillis, 0 cancels the timer
+
+      void setReceiving (bool receiving)        { __receiving__ = receiving; } // false pauses DATA events, incoming data waits in the socket until receiving is set again
+
+      bool sending ()                           { return __outputLength__ > 0; } // true while some data queued with sendData is still waiting to be sent (SENT event will follow)
+
+      void *userData = NULL;                                            // calling program can keep its per-connection state here
+
+    private:
+
+      friend class AsyncTcpServer;
+
+      AsyncTcpConnection (int socket, char *otherSideIP, unsigned long timeOutMillis, TcpAdmissionControl *admission, tcpConnectionStatistics *statistics = NULL, bool admitted = true) {
+                                                  __socket__ = socket;
+                                                  strcpy (__otherSideIP__, otherSideIP);
+                                                  __timeOutMillis__ = timeOutMillis;
+                                                  __admission__ = admission;
+                                                  __admitted__ = admitted && admission;
+                                                  __registerConnection__ (&__statistics__, socket, __otherSideIP__, "event loop", statistics); // adopted connection continues its statistics
+                                                }
+
+      ~AsyncTcpConnection ()                    {
+                                                  __close__ ();
+                                                  if (__output__) free (__output__);
+                                                  TcpConnectionRegistry::remove (&__statistics__);
+                                                  if (__admission__) {
+                                                    if (!__statisticsHandedOver__) __admission__->record (&__statistics__);
+                                                    if (__admitted__) __admission__->release (__otherSideIP__);
+                                                  }
+                                                }
+
+      int __socket__ = -1;
+      char __otherSideIP__ [16];
+      unsigned long __timeOutMillis__;
+      TcpAdmissionControl *__admission__;
+      bool __admitted__;                                                // the connection holds admission slot, otherwise __admission__ is only used for statistics (deferred admission)
+      unsigned long __lastActiveMillis__ = millis ();                   // needed for time-out detection
+      unsigned long __connectedMillis__ = millis ();
+      unsigned long __timerMillis__ = 0;                                // 0 - timer is not set
+      unsigned long __timerStartMillis__ = 0;
+      char *__output__ = NULL;                                          // data waiting to be sent when the socket becomes writable
+      int __outputLength__ = 0;
+      bool __closing__ = false;                                         // close when __output__ has been sent
+      bool __receiving__ = true;                                        // false - don't read from the socket, see setReceiving ()
+      AsyncTcpConnection *__next__ = NULL;                              // connections of the server are kept in a linked list
+      tcpConnectionStatistics __statistics__;                           // traffic and latency of this connection, linked into TcpConnectionRegistry
+      bool __statisticsHandedOver__ = false;                            // statistics continue in TcpConnection that took the connection over
+
+      void __close__ ()                         { if (__socket__ != -1) { close (__socket__); __socket__ = -1; } }
+
+      void __flush__ ()                         { // sends what has been kept in __output__
+                                                  int written = send (__socket__, __output__, __outputLength__, 0);
+                                                  if (written == -1) {
+                                                    if (errno != EAGAIN && errno != ENAVAIL) __close__ ();
+                                                    return;
+                                                  }
+                                                  __lastActiveMillis__ = millis ();
+                                                  __statistics__.bytesSent += written;
+                                                  memmove (__output__, __output__ + written, __outputLength__ - written);
+                                                  if (!(__outputLength__ -= written)) { free (__output__); __output__ = NULL; }
+                                                }
+
+      unsigned long __millisToNextEvent__ (unsigned long now) { // returns how long the event loop may sleep before TIMER or TIME_OUT event of this connection
+                                                  unsigned long waitMillis = (unsigned long) -1;
+                                                  if (__timeOutMillis__ != TcpConnection::INFINITE) waitMillis = now - __lastActiveMillis__ >= __timeOutMillis__ ? 0 : __timeOutMillis__ - (now - __lastActiveMillis__);
+                                                  if (__timerMillis__) {
+                                                    unsigned long timerWaitMillis = now - __timerStartMillis__ >= __timerMillis__ ? 0 : __timerMillis__ - (now - __timerStartMillis__);
+                                                    if (timerWaitMillis < waitMillis) waitMillis = timerWaitMillis;
+                                                  }
+                                                  return waitMillis;
+                                                }
+
+  };
+
+
+  class AsyncTcpServer {
+
+    public:
+
+      enum EVENT_TYPE {
+        CONNECTED = 1,                                                  // a new connection has been accepted
+        DATA = 2,                                                       // data has arrived, it is passed to event callback function (and terminated with 0 for convenience)
+        SENT = 3,                                                       // everything queued with sendData has been sent
+        TIMER = 4,                                                      // timer set with setTimer () has expired
+        TIME_OUT = 5,                                                   // connection has been inactive for too long, it will be closed after event callback function returns
+        CLOSED = 6                                                      // connection is about to be released
+      };
+
+      AsyncTcpServer (void (* eventCallback) (AsyncTcpConnection *, AsyncTcpServer::EVENT_TYPE, char *, int, void *), // a reference to callback function that will handle the events: (connection, event, data, dataLength, eventCallbackParameter)
+                      void *eventCallbackParameter,                 // a reference to parameter that will be passed to eventCallback
+                      unsigned long timeOutMillis,                  // connection time-out in milli seconds, TcpConnection::INFINITE for no time-out
+                      char *serverIP,                               // server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
+                      int serverPort,                               // server port
+                      bool (* firewallCallback) (char *),           // a reference to callback function that will be celled when new connection arrives
+                      TcpFirewall *firewall = NULL,                 // if not NULL firewall rules are checked before firewallCallback is called
+                      const TcpTaskPolicy &taskPolicy = TcpTaskPolicy () // event loop runs on listenerCore, connectionCore is left to subclasses that start their own threads
+                     )                          {
+                                                  // copy constructor parameters to local structure
+                                                  __eventCallback__ = eventCallback;
+                                                  __eventCallbackParameter__ = eventCallbackParameter;
+                                                  __timeOutMillis__ = timeOutMillis;
+                                                  strcpy (__serverIP__, serverIP);
+                                                  __serverPort__ = serverPort;
+                                                  __firewallCallback__ = firewallCallback;
+                                                  __firewall__ = firewall;
+                                                  __taskPolicy__ = taskPolicy;
+                                                  __admission__ = new TcpAdmissionControl (serverPort); // no limits until setAdmissionControl () is called, but connections are counted
+                                                  // start event loop thread
+                                                  __eventLoopState__ = AsyncTcpServer::NOT_RUNNING;
+                                                  if (pdPASS != xTaskCreatePinnedToCore (__eventLoop__,
+                                                                             "AsyncTcpServer",
+                                                                             4096, // 4 KB stack is enough for event loop, its receive buffer and event callback function
+                                                                             this, // pass "this" pointer to static member function
+                                                                             __taskPolicy__.priority,
+                                                                             NULL,
+                                                                             __taskPolicy__.core (__taskPolicy__.listenerCore))) {
+                                                    __eventLoopState__ = AsyncTcpServer::FINISHED;
+                                                  }
+                                                  while (__eventLoopState__ == AsyncTcpServer::NOT_RUNNING) SPIFFSsafeDelay (1); // event loop thread has started successfully and will change its state soon
+                                                }
+
+      virtual ~AsyncTcpServer ()                {
+                                                  __instanceUnloading__ = true; // signal __eventLoop__ to stop
+                                                  __wakeUpEventLoop__ (); // __eventLoop__ is probably blocked in select () - wake it up
+                                                  while (__eventLoopState__ < AsyncTcpServer::FINISHED) SPIFFSsafeDelay (1); // wait for __eventLoop__ to close all connections and finish
+                                                  if (__admission__) __admission__->serverFinished (); // detached connections that are still running will release admission control
+                                                }
+
+      char *getServerIP ()                      { return __serverIP__; } // information from constructor
+
+      int getServerPort ()                      { return __serverPort__; } // information from constructor
+
+      unsigned int getConnectionCount ()        { return __connectionCount__; } // the number of connections currently driven by event loop
+
+      // admission control, see TcpAdmissionControl, overflowReply NULL keeps the reply that the server has already set
+      void setAdmissionControl (unsigned int maxConnections, unsigned int maxConnectionsPerIP, unsigned long minFreeHeap, TcpAdmissionControl::OVERFLOW_TYPE overflow = TcpAdmissionControl::RESET, const char *overflowReply = NULL) {
+                                                  if (__admission__) __admission__->setLimits (maxConnections, maxConnectionsPerIP, minFreeHeap, overflow, overflowReply);
+                                                }
+
+      TcpAdmissionControl *getAdmissionControl () { return __admission__; } // counters of accepted, rejected and queued connections
+
+      // true: connections are admitted by AsyncTcpConnection::admit () when they are about to be detached, not when they are accepted
+      void setDeferredAdmission (bool deferred) { __deferredAdmission__ = deferred; }
+
+      // per client IP connection rate limit: at most burst connections at once, then connectionsPerSecond, 0 turns it off
+      void setRateLimit (unsigned int connectionsPerSecond, unsigned int burst) { if (__admission__) __admission__->setRateLimit (connectionsPerSecond, burst); }
+
+      TcpTaskPolicy &getTaskPolicy ()           { return __taskPolicy__; } // information from constructor, subclasses use it for the threads they start
+
+      // takes over a connection that has been detached from this (or another) event loop, it can be called from any thread, event loop calls
+      // CONNECTED event for it with the given userData, returns false (and the caller still owns the socket) if event loop is not running
+      bool adopt (int connectionSocket, char *otherSideIP, TcpAdmissionControl *admission = NULL, tcpConnectionStatistics *statistics = NULL, void *userData = NULL) {
+                                                  if (__eventLoopState__ != AsyncTcpServer::ACCEPTING_CONNECTIONS || __wakeUpSocket__ == -1 || connectionSocket < 0 || connectionSocket >= FD_SETSIZE) return false;
+                                                  AsyncTcpConnection *connection = new AsyncTcpConnection (connectionSocket, otherSideIP, __timeOutMillis__, admission, statistics);
+                                                  if (!connection) return false;
+                                                  connection->userData = userData;
+                                                  bool wakeUp;
+                                                  portENTER_CRITICAL (&__csAdopted__);
+                                                    if (__instanceUnloading__) {
+                                                      portEXIT_CRITICAL (&__csAdopted__);
+                                                      connection->__socket__ = -1; // caller still owns the socket
+                                                      connection->__admission__ = NULL; // and admission slot
+                                                      connection->__statisticsHandedOver__ = true;
+                                                      delete (connection);
+                                                      return false;
+                                                    }
+                                                    wakeUp = !__adopted__; // event loop will take all the adopted connections at once, one datagram is enough
+                                                    connection->__next__ = __adopted__;
+                                                    __adopted__ = connection;
+                                                  portEXIT_CRITICAL (&__csAdopted__);
+                                                  if (wakeUp) {
+                                                    int s = socket (PF_INET, SOCK_DGRAM, 0);
+                                                    if (s != -1) {
+                                                      sendto (s, "", 1, 0, (struct sockaddr *) &__wakeUpAddress__, sizeof (__wakeUpAddress__));
+                                                      close (s);
+                                                    } // else event loop will find the connection after ASYNC_SELECT_TIME_OUT anyway
+                                                  }
+                                                  return true;
+                                                }
+
+      virtual bool started (void)               { // returns true if event loop has started accepting connections - this flag is set before the constructor returns
+                                                  while (__eventLoopState__ < AsyncTcpServer::ACCEPTING_CONNECTIONS) SPIFFSsafeDelay (10); // wait if event loop is getting ready
+                                                  return (__eventLoopState__ == AsyncTcpServer::ACCEPTING_CONNECTIONS);
+                                                }
+
+    private:
+
+      void (* __eventCallback__) (AsyncTcpConnection *, AsyncTcpServer::EVENT_TYPE, char *, int, void *); // local copy of constructor parameters
+      void *__eventCallbackParameter__;
+      unsigned long __timeOutMillis__;
+      char __serverIP__ [16];
+      int __serverPort__;
+      bool (* __firewallCallback__) (char *IP);
+      TcpFirewall *__firewall__ = NULL;
+      TcpAdmissionControl *__admission__ = NULL;
+      TcpTaskPolicy __taskPolicy__;
+      bool __backlogWaiting__ = false;                                // connections may have been waiting in listen backlog while the server was full
+      bool __deferredAdmission__ = false;                             // see setDeferredAdmission ()
+
+      AsyncTcpConnection *__connections__ = NULL;                     // linked list of connections driven by event loop
+      unsigned int __connectionCount__ = 0;
+
+      AsyncTcpConnection *__adopted__ = NULL;                         // connections given to the event loop by adopt (), waiting to be taken into __connections__
+      portMUX_TYPE __csAdopted__ = portMUX_INITIALIZER_UNLOCKED;
+      int __wakeUpSocket__ = -1;                                      // loopback UDP socket, a datagram wakes up event loop when a connection is adopted
+      struct sockaddr_in __wakeUpAddress__ = {};
+
+      enum EVENT_LOOP_STATE_TYPE {
+        NOT_RUNNING = 9,                                              // initial state
+        RUNNING = 1,                                                  // preparing listening socket to start accepting connections
+        ACCEPTING_CONNECTIONS = 2,                                    // listening socket is ready to accept connections
+        STOPPED = 3,                                                  // stopped accepting connections, closing connections
+        FINISHED = 4                                                  // event loop thread has finished, instance can unload
+      };
+      EVENT_LOOP_STATE_TYPE __eventLoopState__ = AsyncTcpServer::NOT_RUNNING;
+      bool __instanceUnloading__ = false;                             // instance "unloading" flag
+
+      bool __callFirewallCallback__ (char *IP)  { return __firewallCallback__ ? __firewallCallback__ (IP) : true; } // calls firewall function
+
+      void __callEventCallback__ (AsyncTcpConnection *connection, AsyncTcpServer::EVENT_TYPE event, char *data = NULL, int dataLength = 0) { __eventCallback__ (connection, event, data, dataLength, __eventCallbackParameter__); }
+
+      void __wakeUpEventLoop__ ()               { // connects to listening socket so that __eventLoop__ wakes up from select ()
+                                                  if (__eventLoopState__ != AsyncTcpServer::ACCEPTING_CONNECTIONS) return; // __eventLoop__ is not waiting in select ()
+                                                  int wakeUpSocket = socket (PF_INET, SOCK_STREAM, 0);
+                                                  if (wakeUpSocket == -1) return; // __eventLoop__ will notice __instanceUnloading__ flag after ASYNC_SELECT_TIME_OUT anyway
+                                                  struct sockaddr_in listenerAddress;
+                                                  memset (&listenerAddress, 0, sizeof (struct sockaddr_in));
+                                                  listenerAddress.sin_family = AF_INET;
+                                                  listenerAddress.sin_addr.s_addr = strcmp (__serverIP__, "0.0.0.0") ? inet_addr (__serverIP__) : inet_addr ("127.0.0.1");
+                                                  listenerAddress.sin_port = htons (__serverPort__);
+                                                  connect (wakeUpSocket, (struct sockaddr *) &listenerAddress, sizeof (listenerAddress)); // blocking connect, __eventLoop__ has to see established connection to wake up
+                                                  close (wakeUpSocket);
+                                                }
+
+      void __acceptConnections__ (int listenerSocket) { // accepts all pending connections
+                                                  while (true) {
+                                                    if (__admission__ && !__deferredAdmission__ && __admission__->full ()) { // QUEUE overflow - leave the rest of connections in listen backlog
+                                                      __backlogWaiting__ = true;
+                                                      return;
+                                                    }
+                                                    struct sockaddr_in connectingAddress;
+                                                    socklen_t connectingAddressSize = sizeof (connectingAddress);
+                                                    int connectionSocket = accept (listenerSocket, (struct sockaddr *) &connectingAddress, &connectingAddressSize);
+                                                    if (connectionSocket == -1) return; // no more pending connections
+                                                    if (__firewall__ && !__firewall__->allows (connectingAddress.sin_addr.s_addr)) { // check raw address first, rejecting the connection costs no heap
+                                                      close (connectionSocket);
+                                                      continue;
+                                                    }
+                                                    if (__admission__ && !__admission__->withinRateLimit (connectingAddress.sin_addr.s_addr)) { // the client is connecting too fast
+                                                      __admission__->throttle (connectionSocket);
+                                                      continue;
+                                                    }
+                                                    char clientIP [16];
+                                                    inet_ntoa_r (connectingAddress.sin_addr, clientIP, sizeof (clientIP));
+                                                    if (!__callFirewallCallback__ (clientIP) || connectionSocket >= FD_SETSIZE || fcntl (connectionSocket, F_SETFL, O_NONBLOCK) == -1) {
+                                                      close (connectionSocket);
+                                                      continue;
+                                                    }
+                                                    if (__backlogWaiting__ && __admission__) __admission__->countQueued ();
+                                                    if (__admission__ && !(__deferredAdmission__ ? __admission__->enoughHeap () : __admission__->admit (clientIP))) { // limits exceeded
+                                                      __admission__->reject (connectionSocket);
+                                                      continue;
+                                                    }
+                                                    AsyncTcpConnection *newConnection = new AsyncTcpConnection (connectionSocket, clientIP, __timeOutMillis__, __admission__, NULL, !__deferredAdmission__);
+                                                    if (!newConnection) {
+                                                      if (__admission__) { if (!__deferredAdmission__) __admission__->release (clientIP); __admission__->reject (connectionSocket); }
+                                                      else close (connectionSocket);
+                                                      continue;
+                                                    }
+                                                    newConnection->__next__ = __connections__;
+                                                    __connections__ = newConnection;
+                                                    __connectionCount__ ++;
+                                                    __callEventCallback__ (newConnection, AsyncTcpServer::CONNECTED);
+                                                  }
+                                                }
+
+      void __takeAdoptedConnections__ ()        { // moves adopted connections into the event loop
+                                                  portENTER_CRITICAL (&__csAdopted__);
+                                                    AsyncTcpConnection *adopted = __adopted__;
+                                                    __adopted__ = NULL;
+                                                  portEXIT_CRITICAL (&__csAdopted__);
+                                                  while (adopted) {
+                                                    AsyncTcpConnection *connection = adopted;
+                                                    adopted = adopted->__next__;
+                                                    if (__deferredAdmission__ && connection->__admitted__ && connection->__admission__ == __admission__) { // waiting for data doesn't need a slot, keep __admission__ for statistics
+                                                      connection->__admitted__ = false;
+                                                      __admission__->release (connection->__otherSideIP__);
+                                                    }
+                                                    connection->__next__ = __connections__;
+                                                    __connections__ = connection;
+                                                    __connectionCount__ ++;
+                                                    __callEventCallback__ (connection, AsyncTcpServer::CONNECTED);
+                                                  }
+                                                }
+
+      int __openWakeUpSocket__ ()               { // binds loopback UDP socket to any free port, returns -1 if it can't be done (adopt () won't work then)
+                                                  int s = socket (PF_INET, SOCK_DGRAM, 0);
+                                                  if (s == -1) return -1;
+                                                  __wakeUpAddress__.sin_family = AF_INET;
+                                                  __wakeUpAddress__.sin_addr.s_addr = inet_addr ("127.0.0.1");
+                                                  __wakeUpAddress__.sin_port = 0;
+                                                  socklen_t len = sizeof (__wakeUpAddress__);
+                                                  if (bind (s, (struct sockaddr *) &__wakeUpAddress__, sizeof (__wakeUpAddress__)) == -1 || getsockname (s, (struct sockaddr *) &__wakeUpAddress__, &len) == -1 || fcntl (s, F_SETFL, O_NONBLOCK) == -1) {
+                                                    close (s);
+                                                    return -1;
+                                                  }
+                                                  return s;
+                                                }
+
+      void __serveConnection__ (AsyncTcpConnection *connection, fd_set *readSet, fd_set *writeSet) { // handles whatever happened to the connection
+                                                  if (connection->__socket__ == -1) return;
+                                                  if (FD_ISSET (connection->__socket__, writeSet)) {
+                                                    connection->__flush__ ();
+                                                    if (connection->__socket__ != -1 && !connection->__outputLength__ && !connection->__closing__) __callEventCallback__ (connection, AsyncTcpServer::SENT);
+                                                  }
+                                                  if (connection->__socket__ != -1 && !connection->__closing__ && FD_ISSET (connection->__socket__, readSet)) {
+                                                    #define ASYNC_RECV_BUFFER_SIZE 1460 // one TCP segment, buffer is shared among all connections and lives on event loop stack
+                                                    char buffer [ASYNC_RECV_BUFFER_SIZE + 1];
+                                                    int received = recv (connection->__socket__, buffer, ASYNC_RECV_BUFFER_SIZE, 0);
+                                                    if (received > 0) {
+                                                      connection->__lastActiveMillis__ = millis ();
+                                                      __countReceived__ (&connection->__statistics__, received);
+                                                      buffer [received] = 0;
+                                                      __callEventCallback__ (connection, AsyncTcpServer::DATA, buffer, received);
+                                                    } else if (received == 0 || (errno != EAGAIN && errno != ENAVAIL)) { // connection closed by the other side or error
+                                                      connection->__close__ ();
+                                                      return;
+                                                    }
+                                                  }
+                                                  if (connection->__socket__ == -1) return;
+                                                  unsigned long now = millis ();
+                                                  if (connection->__timerMillis__ && now - connection->__timerStartMillis__ >= connection->__timerMillis__) {
+                                                    connection->__timerMillis__ = 0;
+                                                    __callEventCallback__ (connection, AsyncTcpServer::TIMER);
+                                                  }
+                                                  if (connection->__socket__ != -1 && connection->__timeOutMillis__ != TcpConnection::INFINITE && millis () - connection->__lastActiveMillis__ >= connection->__timeOutMillis__) {
+                                                    __callEventCallback__ (connection, AsyncTcpServer::TIME_OUT);
+                                                    connection->__close__ ();
+                                                  }
+                                                }
+
+      void __releaseClosedConnections__ (bool all) { // releases closed (and detached) connections or all of them when event loop is stopping
+                                                  AsyncTcpConnection **p = &__connections__;
+                                                  while (*p) {
+                                                    AsyncTcpConnection *connection = *p;
+                                                    if (connection->__closing__ && !connection->__outputLength__) connection->__close__ ();
+                                                    if (all || connection->__socket__ == -1) {
+                                                      *p = connection->__next__;
+                                                      __connectionCount__ --;
+                                                      __callEventCallback__ (connection, AsyncTcpServer::CLOSED);
+                                                      delete (connection); // also closes the socket if it is still opened
+                                                    } else {
+                                                      p = &connection->__next__;
+                                                    }
+                                                  }
+                                                }
+
+      static void __eventLoop__ (void *taskParameters) {                                          // event loop running in its own thread imlemented as static memeber function
+                                                AsyncTcpServer *ths = (AsyncTcpServer *) taskParameters; // this is how you pass "this" pointer to static memeber function
+                                                ths->__eventLoopState__ = AsyncTcpServer::RUNNING;
+                                                // make listener TCP socket (SOCK_STREAM) for Internet Protocol Family (PF_INET)
+                                                int listenerSocket = socket (PF_INET, SOCK_STREAM, 0);
+                                                if (listenerSocket == -1) goto terminateEventLoop;
+                                                {
+                                                  // make address reusable - so we won't have to wait a few minutes in case server will be restarted
+                                                  int flag = 1;
+                                                  setsockopt (listenerSocket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+                                                  // bind listener socket to IP address and port
+                                                  struct sockaddr_in serverAddress;
+                                                  memset (&serverAddress, 0, sizeof (struct sockaddr_in));
+                                                  serverAddress.sin_family = AF_INET;
+                                                  serverAddress.sin_addr.s_addr = inet_addr (ths->getServerIP ());
+                                                  serverAddress.sin_port = htons (ths->getServerPort ());
+                                                  if (bind (listenerSocket, (struct sockaddr *) &serverAddress, sizeof (serverAddress)) == -1) goto terminateEventLoop;
+                                                  if (listen (listenerSocket, BACKLOG) == -1) goto terminateEventLoop;
+                                                  if (fcntl (listenerSocket, F_SETFL, O_NONBLOCK) == -1) goto terminateEventLoop;
+                                                }
+                                                ths->__wakeUpSocket__ = ths->__openWakeUpSocket__ ();
+
+                                                ths->__eventLoopState__ = AsyncTcpServer::ACCEPTING_CONNECTIONS;
+                                                while (!ths->__instanceUnloading__) {
+                                                  // wait in select () for the listening socket, any of the connections or the nearest TIMER / TIME_OUT event
+                                                  #define ASYNC_SELECT_TIME_OUT 1000 // ms, just a safety net in case __wakeUpEventLoop__ () couldn't connect
+                                                  unsigned long waitMillis = ASYNC_SELECT_TIME_OUT;
+                                                  unsigned long now = millis ();
+                                                  fd_set readSet, writeSet;
+                                                  FD_ZERO (&readSet);
+                                                  FD_ZERO (&writeSet);
+                                                  if (ths->__admission__ && !ths->__deferredAdmission__ && ths->__admission__->full ()) { // QUEUE overflow - leave new connections in listen backlog and check again a little later
+                                                    #define ASYNC_ADMISSION_RETRY_TIME 100 // ms, connections detached from event loop finish in other threads which can't wake up select ()
+                                                    waitMillis = ASYNC_ADMISSION_RETRY_TIME;
+                                                    ths->__backlogWaiting__ = true;
+                                                  } else {
+                                                    FD_SET (listenerSocket, &readSet);
+                                                    if (ths->__backlogWaiting__) waitMillis = 0; // just check what is already waiting in the backlog first
+                                                  }
+                                                  int maxSocket = listenerSocket;
+                                                  if (ths->__wakeUpSocket__ != -1) {
+                                                    FD_SET (ths->__wakeUpSocket__, &readSet);
+                                                    if (ths->__wakeUpSocket__ > maxSocket) maxSocket = ths->__wakeUpSocket__;
+                                                  }
+                                                  for (AsyncTcpConnection *connection = ths->__connections__; connection; connection = connection->__next__) {
+                                                    if (connection->__receiving__) FD_SET (connection->__socket__, &readSet);
+                                                    if (connection->__outputLength__) FD_SET (connection->__socket__, &writeSet);
+                                                    if (connection->__socket__ > maxSocket) maxSocket = connection->__socket__;
+                                                    unsigned long connectionWaitMillis = connection->__millisToNextEvent__ (now);
+                                                    if (connectionWaitMillis < waitMillis) waitMillis = connectionWaitMillis;
+                                                  }
+                                                  struct timeval selectTimeOut = {(time_t) (waitMillis / 1000), (suseconds_t) ((waitMillis % 1000) * 1000)};
+                                                  if (select (maxSocket + 1, &readSet, &writeSet, NULL, &selectTimeOut) == -1) {
+                                                    FD_ZERO (&readSet); // just check timers this time
+                                                    FD_ZERO (&writeSet);
+                                                  }
+                                                  if (ths->__instanceUnloading__) break; // it was probably __wakeUpEventLoop__ () who connected, not a client
+                                                  if (ths->__wakeUpSocket__ != -1 && FD_ISSET (ths->__wakeUpSocket__, &readSet)) {
+                                                    char datagram [16];
+                                                    while (recv (ths->__wakeUpSocket__, datagram, sizeof (datagram), 0) > 0); // empty the socket
+                                                  }
+                                                  if (ths->__adopted__) ths->__takeAdoptedConnections__ ();
+                                                  if (FD_ISSET (listenerSocket, &readSet)) ths->__acceptConnections__ (listenerSocket);
+                                                  if (!ths->__admission__ || ths->__deferredAdmission__ || !ths->__admission__->full ()) ths->__backlogWaiting__ = false; // backlog has been emptied or there was nothing waiting
+                                                  for (AsyncTcpConnection *connection = ths->__connections__; connection; connection = connection->__next__) ths->__serveConnection__ (connection, &readSet, &writeSet);
+                                                  ths->__releaseClosedConnections__ (false);
+                                                }
+
+terminateEventLoop:
+                                                ths->__eventLoopState__ = AsyncTcpServer::STOPPED;
+                                                if (listenerSocket != -1) close (listenerSocket);
+                                                portENTER_CRITICAL (&ths->__csAdopted__);
+                                                  ths->__instanceUnloading__ = true; // adopt () won't add any more connections
+                                                portEXIT_CRITICAL (&ths->__csAdopted__);
+                                                ths->__takeAdoptedConnections__ (); // so that they get closed together with the others
+                                                ths->__releaseClosedConnections__ (true); // close all the connections that are still opened
+                                                if (ths->__wakeUpSocket__ != -1) close (ths->__wakeUpSocket__);
+                                                ths->__eventLoopState__ = AsyncTcpServer::FINISHED;
+                                                vTaskDelete (NULL); // terminate this thread
+                                              }
+
+  };
+
+#endif
@@ -0,0 +1,274 @@
+/*
+ * CoroutineTcpServer.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  CoroutineTcpServer.hpp lets connection handlers be written as sequential code, just like connection handlers of threaded
+ *  TcpServer, but without a thread and its stack for each connection. A connection handler is a C++20 coroutine that returns
+ *  coTask and co_awaits the operations of CoroutineTcpConnection:
+ *    - recvData (buffer, bufferSize) - waits until some data arrives, returns the number of bytes received or 0 if the connection has ended,
+ *    - recvAll (buffer, bufferSize)  - waits until bufferSize bytes arrive, returns bufferSize or less if the connection has ended,
+ *    - sendData (buffer, bufferSize) - waits until all the data has been sent, returns bufferSize or 0 if the connection has ended,
+ *    - sleep (millis)                - waits for millis milli seconds, returns false if the connection has ended in the meantime.
+ *  The coroutines are scheduled by AsyncTcpServer event loop: a coroutine is suspended while it waits and resumed from DATA, SENT,
+ *  TIMER, TIME_OUT or CLOSED event. The scheduler also does accepting: it starts a new handler coroutine for each accepted connection
+ *  and closes the connection when the coroutine returns. All the connections of a server share the event loop thread, a connection
+ *  costs only its coroutine frame (the local variables of connection handler that live across co_await) and CoroutineTcpConnection
+ *  and AsyncTcpConnection instances instead of a (4 KB or so) stack.
+ *
+ *  Like AsyncTcpServer event callback functions coroutines must never block between co_awaits - use sleep instead of delay.
+ *
+ *  Coroutines need a C++20 compiler, with older compilers (__cpp_impl_coroutine is not defined) this file doesn't define anything.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __COROUTINE_TCP_SERVER__
+  #define __COROUTINE_TCP_SERVER__
+
+  #include "AsyncTcpServer.hpp"   // CoroutineTcpServer is built upon AsyncTcpServer, its event loop is the scheduler of coroutines
+
+  #ifdef __cpp_impl_coroutine
+
+  #include <coroutine>
+
+
+  struct coTask {                                                         // the type that connection handler coroutines return
+
+    struct promise_type {
+      coTask get_return_object ()               { return coTask {std::coroutine_handle<promise_type>::from_promise (*this)}; }
+      static coTask get_return_object_on_allocation_failure () { return coTask {}; } // not enough memory for coroutine frame
+      std::suspend_always initial_suspend () noexcept { return {}; }  // scheduler starts the coroutine when everything is ready
+      std::suspend_always final_suspend () noexcept { return {}; }    // scheduler destroys the coroutine frame when it finishes
+      void return_void ()                       {}
+      void unhandled_exception ()               { abort (); }         // exceptions are not used
+      void *operator new (size_t size) noexcept { return malloc (size); } // coroutine frame is allocated on heap, NULL if there is not enough memory
+      void operator delete (void *frame)        { free (frame); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+  };
+
+
+  class CoroutineTcpConnection {
+
+    public:
+
+      class recvAwaitable {                                               // co_await connection->recvData (...) or co_await connection->recvAll (...)
+        public:
+          recvAwaitable (CoroutineTcpConnection *connection, char *buffer, int bufferSize, bool all) { __connection__ = connection; __buffer__ = buffer; __bufferSize__ = bufferSize; __all__ = all; }
+          bool await_ready ()                     { return __connection__->__startReceiving__ (__buffer__, __bufferSize__, __all__); }
+          void await_suspend (std::coroutine_handle<>) { __connection__->__waitFor__ (CoroutineTcpConnection::RECV); }
+          int await_resume ()                     { return __connection__->__received__; }
+        private:
+          CoroutineTcpConnection *__connection__;
+          char *__buffer__;
+          int __bufferSize__;
+          bool __all__;
+      };
+
+      class sendAwaitable {                                               // co_await connection->sendData (...), the data has already been passed to AsyncTcpConnection
+        public:
+          sendAwaitable (CoroutineTcpConnection *connection, int sent) { __connection__ = connection; __sent__ = sent; }
+          bool await_ready ()                     { return !__sent__ || !__connection__->__connection__->sending (); }
+          void await_suspend (std::coroutine_handle<>) { __connection__->__waitFor__ (CoroutineTcpConnection::SEND); }
+          int await_resume ()                     { return __connection__->__closed__ && __connection__->__connection__->sending () ? 0 : __sent__; }
+        private:
+          CoroutineTcpConnection *__connection__;
+          int __sent__;
+      };
+
+      class sleepAwaitable {                                              // co_await connection->sleep (...)
+        public:
+          sleepAwaitable (CoroutineTcpConnection *connection, unsigned long sleepMillis) { __connection__ = connection; __sleepMillis__ = sleepMillis; }
+          bool await_ready ()                     { return __connection__->__closed__ || !__sleepMillis__; }
+          void await_suspend (std::coroutine_handle<>) { __connection__->__connection__->setTimer (__sleepMillis__); __connection__->__waitFor__ (CoroutineTcpConnection::SLEEP); }
+          bool await_resume ()                    { return !__connection__->__closed__; }
+        private:
+          CoroutineTcpConnection *__connection__;
+          unsigned long __sleepMillis__;
+      };
+
+      recvAwaitable recvData (char *buffer, int bufferSize) { return recvAwaitable (this, buffer, bufferSize, false); } // resumes as soon as some data arrives
+
+      recvAwaitable recvAll (char *buffer, int bufferSize) { return recvAwaitable (this, buffer, bufferSize, true); } // resumes when buffer is full
+
+      // sendData sends (or queues) the data immediately so the buffer doesn't have to live until co_await resumes
+      sendAwaitable sendData (char *buffer, int bufferSize) { return sendAwaitable (this, __closed__ ? 0 : __connection__->sendData (buffer, bufferSize)); }
+
+      sendAwaitable sendData (char string [])   { return sendData (string, strlen (string)); }
+
+      sendAwaitable sendData (String string)    { return sendData ((char *) string.c_str (), string.length ()); }
+
+      sleepAwaitable sleep (unsigned long sleepMillis) { return sleepAwaitable (this, sleepMillis); }
+
+      void closeConnection ()                   { __connection__->closeConnection (); } // connection will be closed as soon as all the data has been sent
+
+      char *getOtherSideIP ()                   { return __connection__->getOtherSideIP (); }
+
+      unsigned long getTimeOut ()               { return __connection__->getTimeOut (); }
+
+      void setTimeOut (unsigned long timeOutMillis) { __connection__->setTimeOut (timeOutMillis); }
+
+    private:
+
+      friend class CoroutineTcpServer;
+
+      CoroutineTcpConnection (AsyncTcpConnection *connection) {
+                                                  __connection__ = connection;
+                                                  __connection__->setReceiving (false); // data is read from the socket only while the coroutine waits for it
+                                                }
+
+      ~CoroutineTcpConnection ()                {
+                                                  if (__task__) __task__.destroy ();
+                                                  if (__input__) free (__input__);
+                                                }
+
+      enum WAIT_TYPE {
+        NOTHING = 0,
+        RECV = 1,                                                         // waiting in recvData or recvAll
+        SEND = 2,                                                         // waiting in sendData
+        SLEEP = 3                                                         // waiting in sleep
+      };
+
+      AsyncTcpConnection *__connection__;
+      std::coroutine_handle<coTask::promise_type> __task__ = NULL;       // connection handler coroutine
+      WAIT_TYPE __waitingFor__ = NOTHING;
+      bool __closed__ = false;                                            // TIME_OUT or CLOSED event has occured, all the operations return immediately
+      char *__recvBuffer__ = NULL;                                        // buffer of recvData or recvAll
+      int __recvBufferSize__ = 0;
+      bool __recvAll__ = false;
+      int __received__ = 0;                                               // bytes already copied into __recvBuffer__
+      char *__input__ = NULL;                                             // data that arrived but didn't fit into __recvBuffer__
+      int __inputLength__ = 0;
+
+      bool __startReceiving__ (char *buffer, int bufferSize, bool all) { // copies what has already arrived, returns true if there is no need to wait
+                                                  __recvBuffer__ = buffer;
+                                                  __recvBufferSize__ = bufferSize;
+                                                  __recvAll__ = all;
+                                                  __received__ = __inputLength__ < bufferSize ? __inputLength__ : bufferSize;
+                                                  if (__received__) {
+                                                    memcpy (buffer, __input__, __received__);
+                                                    memmove (__input__, __input__ + __received__, __inputLength__ - __received__);
+                                                    if (!(__inputLength__ -= __received__)) { free (__input__); __input__ = NULL; }
+                                                  }
+                                                  return __closed__ || __received__ == bufferSize || (__received__ && !all);
+                                                }
+
+      void __waitFor__ (WAIT_TYPE waitingFor)   {
+                                                  __waitingFor__ = waitingFor;
+                                                  if (waitingFor == RECV) __connection__->setReceiving (true);
+                                                }
+
+      void __resume__ ()                        { // resumes connection handler coroutine and closes the connection when it finishes
+                                                  __waitingFor__ = NOTHING;
+                                                  __connection__->setReceiving (false);
+                                                  __task__.resume ();
+                                                  if (__task__.done ()) {
+                                                    __task__.destroy ();
+                                                    __task__ = NULL;
+                                                    __connection__->closeConnection ();
+                                                  }
+                                                }
+
+      void __dataArrived__ (char *data, int dataLength) { // DATA event
+                                                  if (__waitingFor__ == RECV) {
+                                                    int copy = __recvBufferSize__ - __received__ < dataLength ? __recvBufferSize__ - __received__ : dataLength;
+                                                    memcpy (__recvBuffer__ + __received__, data, copy);
+                                                    __received__ += copy;
+                                                    data += copy;
+                                                    dataLength -= copy;
+                                                  }
+                                                  if (dataLength) { // keep the rest for the next recvData or recvAll, there is at most one TCP segment kept since receiving is paused when coroutine is not waiting for data
+                                                    char *p = (char *) realloc (__input__, __inputLength__ + dataLength);
+                                                    if (!p) { __connectionEnded__ (); return; } // log_e ("[CoroutineTcpServer] out of memory\n");
+                                                    memcpy (p + __inputLength__, data, dataLength);
+                                                    __input__ = p;
+                                                    __inputLength__ += dataLength;
+                                                  }
+                                                  if (__waitingFor__ == RECV && (!__recvAll__ || __received__ == __recvBufferSize__)) __resume__ ();
+                                                }
+
+      void __connectionEnded__ ()               { // TIME_OUT or CLOSED event or out of memory, let the coroutine finish
+                                                  __closed__ = true;
+                                                  __connection__->closeConnection ();
+                                                  if (__waitingFor__ != NOTHING) __resume__ ();
+                                                }
+
+  };
+
+
+  class CoroutineTcpServer {
+
+    public:
+
+      CoroutineTcpServer (coTask (* connectionHandler) (CoroutineTcpConnection *, void *), // a reference to connection handler coroutine: (connection, connectionHandlerParameter)
+                          void *connectionHandlerParameter,             // a reference to parameter that will be passed to connectionHandler
+                          unsigned long timeOutMillis,                  // connection time-out in milli seconds, TcpConnection::INFINITE for no time-out
+                          char *serverIP,                               // server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
+                          int serverPort,                               // server port
+                          bool (* firewallCallback) (char *),           // a reference to callback function that will be celled when new connection arrives
+                          TcpFirewall *firewall = NULL                  // if not NULL firewall rules are checked before firewallCallback is called
+                         )                      {
+                                                  // copy constructor parameters to local structure
+                                                  __connectionHandler__ = connectionHandler;
+                                                  __connectionHandlerParameter__ = connectionHandlerParameter;
+                                                  // start AsyncTcpServer event loop that will drive connection handler coroutines
+                                                  __server__ = new AsyncTcpServer (__eventCallback__, this, timeOutMillis, serverIP, serverPort, firewallCallback, firewall);
+                                                }
+
+      ~CoroutineTcpServer ()                    { if (__server__) delete (__server__); } // closes all the connections and destroys their coroutines
+
+      char *getServerIP ()                      { return __server__ ? __server__->getServerIP () : (char *) ""; } // information from constructor
+
+      int getServerPort ()                      { return __server__ ? __server__->getServerPort () : 0; } // information from constructor
+
+      unsigned int getConnectionCount ()        { return __server__ ? __server__->getConnectionCount () : 0; } // the number of connections (coroutines) currently running
+
+      AsyncTcpServer *getAsyncTcpServer ()      { return __server__; } // admission control and other settings of underlying AsyncTcpServer
+
+      bool started ()                           { return __server__ && __server__->started (); }
+
+    private:
+
+      coTask (* __connectionHandler__) (CoroutineTcpConnection *, void *); // local copy of constructor parameters
+      void *__connectionHandlerParameter__;
+      AsyncTcpServer *__server__ = NULL;
+
+      static void __eventCallback__ (AsyncTcpConnection *connection, AsyncTcpServer::EVENT_TYPE event, char *data, int dataLength, void *thisServer) { // called from event loop
+        CoroutineTcpServer *ths = (CoroutineTcpServer *) thisServer; // this is how you pass "this" pointer to static memeber function
+        CoroutineTcpConnection *coConnection = (CoroutineTcpConnection *) connection->userData;
+        if (event == AsyncTcpServer::CONNECTED) { // start a new connection handler coroutine
+          connection->userData = coConnection = new CoroutineTcpConnection (connection);
+          if (!coConnection) { connection->closeConnection (); return; } // log_e ("[CoroutineTcpServer] out of memory\n");
+          coConnection->__task__ = ths->__connectionHandler__ (coConnection, ths->__connectionHandlerParameter__).handle;
+          if (!coConnection->__task__) { connection->closeConnection (); return; } // log_e ("[CoroutineTcpServer] not enough memory for coroutine frame\n");
+          coConnection->__resume__ (); // run the coroutine until it waits for the first time
+          return;
+        }
+        if (!coConnection) return;
+        switch (event) {
+          case AsyncTcpServer::DATA:      coConnection->__dataArrived__ (data, dataLength);
+                                          break;
+          case AsyncTcpServer::SENT:      if (coConnection->__waitingFor__ == CoroutineTcpConnection::SEND) coConnection->__resume__ ();
+                                          break;
+          case AsyncTcpServer::TIMER:     if (coConnection->__waitingFor__ == CoroutineTcpConnection::SLEEP) coConnection->__resume__ ();
+                                          break;
+          case AsyncTcpServer::TIME_OUT:  coConnection->__connectionEnded__ ();
+                                          break;
+          case AsyncTcpServer::CLOSED:    if (coConnection->__task__) coConnection->__connectionEnded__ ();
+                                          delete (coConnection); // also destroys coroutine frame if the coroutine hasn't finished yet
+                                          connection->userData = NULL;
+                                          break;
+          default:                        break;
+        }
+      }
+
+  };
+
+  #endif
+
+#endif
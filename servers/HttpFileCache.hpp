@@ -0,0 +1,222 @@
+/*
+ * HttpFileCache.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  HttpFileCache keeps contents of recently served static files (together with their HTTP reply headers, already built)
+ *  in RAM, so that httpServer can send them without taking SPIFFSsemaphore and reading flash again. Without cache the
+ *  semaphore is held for the whole transfer, blocking FTP, telnet and user management in the meantime.
+ *
+ *  The cache holds at most capacity bytes and only files up to maxFileSize bytes, the least recently used files are
+ *  evicted to make room for new ones. A file is not cached if that would leave less than HTTP_FILE_CACHE_MIN_FREE_HEAP
+ *  of free heap. Files are loaded while SPIFFSsemaphore is taken and file_system.h calls fileSystemChanged (with the
+ *  semaphore still taken) whenever a file is written or deleted, so a cached file can never be older than the one on
+ *  flash. Each cached file is a single memory block with a reference count: a file that is evicted or invalidated while
+ *  it is still being sent is freed when the last sender releases it.
+ *
+ *  Files are looked up by linear search through LRU list (comparing hashes first), there are only as many of them as
+ *  fit into capacity.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HTTP_FILE_CACHE__
+  #define __HTTP_FILE_CACHE__
+
+  #include "file_system.h"
+
+  #ifndef HTTP_FILE_CACHE_SIZE
+    #define HTTP_FILE_CACHE_SIZE 65536                                        // 64 KB of files (and their headers) at most
+  #endif
+  #ifndef HTTP_FILE_CACHE_MAX_FILE_SIZE
+    #define HTTP_FILE_CACHE_MAX_FILE_SIZE 40960                               // larger files are read from flash each time
+  #endif
+  #ifndef HTTP_FILE_CACHE_MIN_FREE_HEAP
+    #define HTTP_FILE_CACHE_MIN_FREE_HEAP 49152                               // don't cache a file if less than 48 KB of heap would be left
+  #endif
+
+
+  struct HttpCachedFile {                                                     // cached file, one memory block: this structure, file name, headers and content
+    HttpCachedFile *__previous__;                                             // LRU list, the most recently used first
+    HttpCachedFile *__next__;
+    uint32_t __hash__;
+    int __references__;                                                       // the cache itself holds one reference while the file is in LRU list
+
+    const char *fileName;
+    const char *keepAliveHeader;                                              // HTTP reply headers with Connection:keep-alive ...
+    const char *closeHeader;                                                  // ... and Connection:close
+    const char *content;
+    unsigned long contentLength;
+    unsigned long blockSize;                                                  // memory that the cache counts for this file
+
+    const char *header (bool keepAlive) { return keepAlive ? keepAliveHeader : closeHeader; }
+  };
+
+
+  class HttpFileCache {
+
+    public:
+
+      HttpFileCache (unsigned long capacity = HTTP_FILE_CACHE_SIZE, unsigned long maxFileSize = HTTP_FILE_CACHE_MAX_FILE_SIZE) { __capacity__ = capacity; __maxFileSize__ = maxFileSize; }
+
+      ~HttpFileCache ()                         { invalidate (NULL); }
+
+      // sets new limits and evicts files that don't fit into them, (0, 0) turns caching off
+      void setCapacity (unsigned long capacity, unsigned long maxFileSize) {
+                                                  HttpCachedFile *evicted = NULL;
+                                                  portENTER_CRITICAL (&__csFileCache__);
+                                                    __capacity__ = capacity; __maxFileSize__ = maxFileSize;
+                                                    for (HttpCachedFile *f = __first__; f; ) {
+                                                      HttpCachedFile *next = f->__next__;
+                                                      if (f->contentLength > __maxFileSize__) { evicted = __evict__ (f, evicted); __evictions__ ++; }
+                                                      f = next;
+                                                    }
+                                                    evicted = __makeRoom__ (0, evicted);
+                                                  portEXIT_CRITICAL (&__csFileCache__);
+                                                  __free__ (evicted);
+                                                }
+
+      unsigned long getCapacity ()              { return __capacity__; }
+
+      unsigned long getMaxFileSize ()           { return __maxFileSize__; }
+
+      // returns cached file (that has to be released when it is not needed any more) or NULL if it is not cached (miss)
+      HttpCachedFile *get (const char *fileName) {
+                                                  uint32_t hash = __hashOf__ (fileName);
+                                                  portENTER_CRITICAL (&__csFileCache__);
+                                                    HttpCachedFile *f = __find__ (fileName, hash);
+                                                    if (f) {
+                                                      f->__references__ ++;
+                                                      __unlink__ (f); __linkFirst__ (f);
+                                                      __hits__ ++;
+                                                    } else {
+                                                      __misses__ ++;
+                                                    }
+                                                  portEXIT_CRITICAL (&__csFileCache__);
+                                                  return f;
+                                                }
+
+      // reads opened file and caches it together with its headers, returns cached file (that has to be released) or NULL if it can't be cached - SPIFFSsemaphore has to be taken by the calling function
+      HttpCachedFile *load (File& file, const char *fileName, const char *keepAliveHeader, const char *closeHeader) {
+                                                  unsigned long contentLength = file.size ();
+                                                  if (contentLength > __maxFileSize__) return NULL;
+                                                  unsigned long fileNameLength = strlen (fileName) + 1, keepAliveHeaderLength = strlen (keepAliveHeader) + 1, closeHeaderLength = strlen (closeHeader) + 1;
+                                                  unsigned long blockSize = sizeof (HttpCachedFile) + fileNameLength + keepAliveHeaderLength + closeHeaderLength + contentLength;
+                                                  if (blockSize > __capacity__ || ESP.getFreeHeap () < blockSize + HTTP_FILE_CACHE_MIN_FREE_HEAP) return NULL;
+                                                  HttpCachedFile *f = (HttpCachedFile *) malloc (blockSize);
+                                                  if (!f) return NULL;
+                                                  char *p = (char *) (f + 1);
+                                                  f->fileName = (const char *) memcpy (p, fileName, fileNameLength); p += fileNameLength;
+                                                  f->keepAliveHeader = (const char *) memcpy (p, keepAliveHeader, keepAliveHeaderLength); p += keepAliveHeaderLength;
+                                                  f->closeHeader = (const char *) memcpy (p, closeHeader, closeHeaderLength); p += closeHeaderLength;
+                                                  f->content = p;
+                                                  f->contentLength = contentLength;
+                                                  f->blockSize = blockSize;
+                                                  f->__hash__ = __hashOf__ (fileName);
+                                                  f->__references__ = 2; // the cache and the calling function
+                                                  if (file.read ((uint8_t *) p, contentLength) != contentLength) { free (f); file.seek (0); return NULL; }
+
+                                                  HttpCachedFile *evicted = NULL;
+                                                  portENTER_CRITICAL (&__csFileCache__);
+                                                    HttpCachedFile *old = __find__ (fileName, f->__hash__); // another thread may have loaded the same file in the meantime (SPIFFSsemaphore assures it is the same content)
+                                                    if (old) evicted = __evict__ (old, evicted);
+                                                    evicted = __makeRoom__ (blockSize, evicted);
+                                                    __linkFirst__ (f);
+                                                    __size__ += blockSize;
+                                                    __count__ ++;
+                                                  portEXIT_CRITICAL (&__csFileCache__);
+                                                  __free__ (evicted);
+                                                  return f;
+                                                }
+
+      void release (HttpCachedFile *f)          { // releases cached file returned by get or load
+                                                  portENTER_CRITICAL (&__csFileCache__);
+                                                    bool last = !-- f->__references__;
+                                                  portEXIT_CRITICAL (&__csFileCache__);
+                                                  if (last) free (f);
+                                                }
+
+      void invalidate (const char *fileName)    { // removes changed (written or deleted) file from cache, NULL removes all files
+                                                  uint32_t hash = fileName ? __hashOf__ (fileName) : 0;
+                                                  HttpCachedFile *evicted = NULL;
+                                                  portENTER_CRITICAL (&__csFileCache__);
+                                                    for (HttpCachedFile *f = __first__; f; ) {
+                                                      HttpCachedFile *next = f->__next__;
+                                                      if (!fileName || (f->__hash__ == hash && !strcmp (f->fileName, fileName))) { evicted = __evict__ (f, evicted); __invalidations__ ++; }
+                                                      f = next;
+                                                    }
+                                                  portEXIT_CRITICAL (&__csFileCache__);
+                                                  __free__ (evicted);
+                                                }
+
+      unsigned long getHits ()                  { return __hits__; }               // requests served from cache
+
+      unsigned long getMisses ()                { return __misses__; }             // requests for files that were not cached
+
+      unsigned long getEvictions ()             { return __evictions__; }          // files evicted to make room for others
+
+      unsigned long getInvalidations ()         { return __invalidations__; }      // files removed since they have changed
+
+      unsigned long getSize ()                  { return __size__; }               // memory taken by cached files
+
+      unsigned int getCount ()                  { return __count__; }              // number of cached files
+
+      String json ()                            {
+                                                  return "{\"files\":" + String (__count__) + ",\"size\":" + String (__size__) + ",\"capacity\":" + String (__capacity__) +
+                                                         ",\"hits\":" + String (__hits__) + ",\"misses\":" + String (__misses__) + ",\"evictions\":" + String (__evictions__) + ",\"invalidations\":" + String (__invalidations__) + "}";
+                                                }
+
+    private:
+
+      HttpCachedFile *__first__ = NULL;
+      HttpCachedFile *__last__ = NULL;
+      unsigned long __capacity__;
+      unsigned long __maxFileSize__;
+      unsigned long __size__ = 0;
+      unsigned int __count__ = 0;
+      unsigned long __hits__ = 0;
+      unsigned long __misses__ = 0;
+      unsigned long __evictions__ = 0;
+      unsigned long __invalidations__ = 0;
+      portMUX_TYPE __csFileCache__ = portMUX_INITIALIZER_UNLOCKED;
+
+      static uint32_t __hashOf__ (const char *s) { uint32_t h = 2166136261u; while (*s) h = (h ^ (uint8_t) *s ++) * 16777619u; return h; } // FNV-1a
+
+      HttpCachedFile *__find__ (const char *fileName, uint32_t hash) { // call within critical section
+                                                  for (HttpCachedFile *f = __first__; f; f = f->__next__) if (f->__hash__ == hash && !strcmp (f->fileName, fileName)) return f;
+                                                  return NULL;
+                                                }
+
+      void __linkFirst__ (HttpCachedFile *f)    { f->__previous__ = NULL; f->__next__ = __first__; if (__first__) __first__->__previous__ = f; else __last__ = f; __first__ = f; }
+
+      void __unlink__ (HttpCachedFile *f)       {
+                                                  if (f->__previous__) f->__previous__->__next__ = f->__next__; else __first__ = f->__next__;
+                                                  if (f->__next__) f->__next__->__previous__ = f->__previous__; else __last__ = f->__previous__;
+                                                }
+
+      // removes file from LRU list, drops cache's reference and adds the file to the list of files to be freed outside critical section if nobody is sending it
+      HttpCachedFile *__evict__ (HttpCachedFile *f, HttpCachedFile *evicted) {
+                                                  __unlink__ (f);
+                                                  __size__ -= f->blockSize;
+                                                  __count__ --;
+                                                  if (-- f->__references__) return evicted; // the last sender will free it
+                                                  f->__next__ = evicted;
+                                                  return f;
+                                                }
+
+      HttpCachedFile *__makeRoom__ (unsigned long blockSize, HttpCachedFile *evicted) { // evicts least recently used files until blockSize fits into capacity
+                                                  while (__last__ && __size__ + blockSize > __capacity__) { evicted = __evict__ (__last__, evicted); __evictions__ ++; }
+                                                  return evicted;
+                                                }
+
+      static void __free__ (HttpCachedFile *evicted) { while (evicted) { HttpCachedFile *next = evicted->__next__; free (evicted); evicted = next; } }
+  };
+
+  HttpFileCache httpFileCache;                                                // shared by all httpServers, they all serve files from webserver home directory
+
+  void __httpFileCacheInvalidate__ (const char *fileName) { httpFileCache.invalidate (fileName); } // set as fileSystemChanged by httpServer
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * HttpRequest.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  HttpRequest.hpp contains an incremental HTTP/1.x request parser. It doesn't copy or allocate anything: it parses the
+ *  request where it has been received and remembers where method, path, query, version and headers are. The calling
+ *  program gets them as HttpStringView (pointer and length) and doesn't have to search the request text again.
+ *
+ *  parse () can be called every time more data arrives, it only scans the bytes it hasn't seen yet. The buffer may
+ *  move (when String that collects data grows, for example) since only offsets are kept inside HttpRequest.
+ *
+ *  Header names are hashed (case insensitive) while they are being parsed so getHeader () compares only the headers
+ *  with the same hash and length instead of comparing the whole request with stristr.
+ *
+ *  A request with Content-Length is complete when its body has arrived as well, getBody () is the view of it. Requests
+ *  with both Content-Length and Transfer-Encoding, with Content-Length values that differ or are not a number are
+ *  malformed (they could be framed differently by different parsers). Chunked (Transfer-Encoding) bodies and bodies
+ *  longer than HTTP_MAX_BODY_LENGTH are not read, parse () reports them as UNSUPPORTED so that the connection can be
+ *  closed, since where the next request starts is not known.
+ *
+ *  When the request is dispatched through HttpRoutes (HttpRoutes.hpp) the parts of the path that match {name} segments
+ *  of the route's path pattern are available with getPathParameter ().
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added path parameters, set by HttpRoutes
+ *            October 16, 2026
+ *          - request body (Content-Length), requests with ambiguous framing are rejected
+ *            October 16, 2026
+ */
+
+
+#ifndef __HTTP_REQUEST__
+  #define __HTTP_REQUEST__
+
+  #define HTTP_MAX_HEADERS 32           // requests with more headers are rejected (browsers send less than 20)
+  #define HTTP_MAX_REQUEST_LENGTH 4095  // requests with longer header are rejected, offsets fit into 16 bits
+  #define HTTP_MAX_PATH_PARAMETERS 4    // {name} segments in one route's path pattern
+  #ifndef HTTP_MAX_BODY_LENGTH
+    #define HTTP_MAX_BODY_LENGTH 8192   // longer bodies are not read (header and body offsets have to fit into 16 bits)
+  #endif
+  #if HTTP_MAX_REQUEST_LENGTH + HTTP_MAX_BODY_LENGTH > 65535
+    #error HTTP_MAX_BODY_LENGTH is too large, request offsets are 16 bit
+  #endif
+  #define HTTP_HASH_SEED 5381
+
+
+  struct HttpStringView {                                           // a part of the request, not 0 terminated
+    const char *data;                                               // NULL if the part is missing (getHeader () of a header that is not there)
+    unsigned int length;
+
+    HttpStringView ()                                               { data = NULL; length = 0; }
+    HttpStringView (const char *d, unsigned int l)                  { data = d; length = l; }
+
+    bool operator == (const char *s) const                          { return data && strlen (s) == length && !memcmp (data, s, length); }
+    bool operator != (const char *s) const                          { return !(*this == s); }
+    bool equalsIgnoreCase (const char *s) const                     { return data && strlen (s) == length && !strncasecmp (data, s, length); }
+    bool startsWith (const char *s) const                           { unsigned int l = strlen (s); return data && l <= length && !memcmp (data, s, l); }
+
+    bool hasToken (const char *token) const                         { // checks comma separated list of tokens, like Connection: keep-alive, Upgrade, case insensitive
+                                                                      unsigned int l = strlen (token);
+                                                                      const char *p = data, *end = data + length;
+                                                                      if (!p) return false;
+                                                                      while (p < end) {
+                                                                        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p ++;
+                                                                        const char *q = p;
+                                                                        while (q < end && *q != ',') q ++;
+                                                                        const char *e = q; while (e > p && (e [-1] == ' ' || e [-1] == '\t')) e --;
+                                                                        if ((unsigned int) (e - p) == l && !strncasecmp (p, token, l)) return true;
+                                                                        p = q;
+                                                                      }
+                                                                      return false;
+                                                                    }
+
+    HttpStringView substring (unsigned int from) const              { return from < length ? HttpStringView (data + from, length - from) : HttpStringView (data ? data + length : NULL, 0); }
+
+    int toInt () const                                              { int i = 0; unsigned int j = 0; bool minus = length && *data == '-'; if (minus) j ++; for (; j < length && data [j] >= '0' && data [j] <= '9'; j++) i = i * 10 + data [j] - '0'; return minus ? -i : i; }
+
+    String toString () const                                        { String s; if (data && length && s.reserve (length)) for (unsigned int i = 0; i < length; i++) s += data [i]; return s; } // allocates, only when really needed
+
+    char *copyTo (char *buffer, unsigned int bufferSize) const      { // copies the part into buffer and 0 terminates it, returns NULL if it doesn't fit
+                                                                      if (length >= bufferSize) return NULL;
+                                                                      if (length) memcpy (buffer, data, length);
+                                                                      buffer [length] = 0;
+                                                                      return buffer;
+                                                                    }
+  };
+
+
+  class HttpRoutes;
+
+
+  class HttpRequest {
+
+    public:
+
+      enum PARSE_RESULT {
+        INCOMPLETE = 0,                                             // the end of request header hasn't arrived yet
+        COMPLETE = 1,                                               // getLength () bytes of request header and getContentLength () bytes of body have arrived, whatever follows belongs to the next request
+        MALFORMED = 2,                                              // the request can't be parsed, exceeds HTTP_MAX_HEADERS or HTTP_MAX_REQUEST_LENGTH or its Content-Length is ambiguous
+        UNSUPPORTED = 3                                             // the header is complete but its body can't be read: Transfer-Encoding or Content-Length over HTTP_MAX_BODY_LENGTH
+      };
+
+      // parses what hasn't been parsed yet, buffer holds the whole request received so far (from its first byte on), length is its length
+      PARSE_RESULT parse (const char *buffer, unsigned int length) {
+                                                  __buffer__ = buffer;
+                                                  while (__state__ < __COMPLETE__ && __parsed__ < length) {
+                                                    if (__state__ == __BODY__) { // the body is not parsed, just wait until all of it arrives
+                                                      unsigned int end = __headerLength__ + __contentLength__;
+                                                      __parsed__ = length < end ? length : end;
+                                                      if (__parsed__ == end) __state__ = __COMPLETE__;
+                                                      break;
+                                                    }
+                                                    if (__parsed__ >= HTTP_MAX_REQUEST_LENGTH) { __state__ = __MALFORMED__; break; }
+                                                    char c = buffer [__parsed__];
+                                                    switch (__state__) {
+                                                      case __METHOD__:        if (!__method__.length && (c == '\r' || c == '\n')) __method__.offset = __parsed__ + 1; // empty lines before request line are ignored
+                                                                              else if (c == ' ') { if (!__method__.length) __state__ = __MALFORMED__; else { __state__ = __PATH__; __path__.offset = __parsed__ + 1; } }
+                                                                              else if (c < 'A' || c > 'Z') __state__ = __MALFORMED__;
+                                                                              else __method__.length ++;
+                                                                              break;
+                                                      case __PATH__:          if (c == ' ') { __state__ = __HTTP_VERSION__; __version__.offset = __parsed__ + 1; }
+                                                                              else if (c == '?') { __state__ = __QUERY__; __query__.offset = __parsed__ + 1; }
+                                                                              else if (c == '\r' || c == '\n') __endOfLine__ (c);
+                                                                              else __path__.length ++;
+                                                                              break;
+                                                      case __QUERY__:         if (c == ' ') { __state__ = __HTTP_VERSION__; __version__.offset = __parsed__ + 1; }
+                                                                              else if (c == '\r' || c == '\n') __endOfLine__ (c);
+                                                                              else __query__.length ++;
+                                                                              break;
+                                                      case __HTTP_VERSION__:       if (c == '\r' || c == '\n') __endOfLine__ (c);
+                                                                              else __version__.length ++; // request line of webClient ("GET /upTime \r\n") has no version
+                                                                              break;
+                                                      case __LINE_FEED__:     if (c != '\n') __state__ = __MALFORMED__; else __state__ = __LINE_START__;
+                                                                              break;
+                                                      case __LINE_START__:    if (c == '\r') __state__ = __FINAL_LINE_FEED__;
+                                                                              else if (c == '\n') __endOfHeader__ ();
+                                                                              else if (c == ':' || c == ' ' || c == '\t') __state__ = __MALFORMED__; // empty header name or obsolete line folding
+                                                                              else if (__headerCount__ == HTTP_MAX_HEADERS) __state__ = __MALFORMED__;
+                                                                              else {
+                                                                                __header__ *h = &__headers__ [__headerCount__ ++];
+                                                                                h->name.offset = __parsed__; h->name.length = 1;
+                                                                                h->value.offset = h->value.length = 0;
+                                                                                h->hash = __hashChar__ (HTTP_HASH_SEED, c);
+                                                                                __state__ = __HEADER_NAME__;
+                                                                              }
+                                                                              break;
+                                                      case __HEADER_NAME__:   {
+                                                                                __header__ *h = &__headers__ [__headerCount__ - 1];
+                                                                                if (c == ':') { __state__ = __VALUE_START__; h->value.offset = __parsed__ + 1; }
+                                                                                else if (c == '\r' || c == '\n' || c == ' ' || c == '\t') __state__ = __MALFORMED__;
+                                                                                else { h->name.length ++; h->hash = __hashChar__ (h->hash, c); }
+                                                                              }
+                                                                              break;
+                                                      case __VALUE_START__:   {
+                                                                                __header__ *h = &__headers__ [__headerCount__ - 1];
+                                                                                if (c == ' ' || c == '\t') h->value.offset = __parsed__ + 1; // skip leading white space
+                                                                                else if (c == '\r' || c == '\n') __endOfLine__ (c);
+                                                                                else { h->value.length = 1; __state__ = __HEADER_VALUE__; }
+                                                                              }
+                                                                              break;
+                                                      case __HEADER_VALUE__:  {
+                                                                                __header__ *h = &__headers__ [__headerCount__ - 1];
+                                                                                if (c == '\r' || c == '\n') {
+                                                                                  while (h->value.length && (buffer [h->value.offset + h->value.length - 1] == ' ' || buffer [h->value.offset + h->value.length - 1] == '\t')) h->value.length --; // skip trailing white space
+                                                                                  __endOfLine__ (c);
+                                                                                } else {
+                                                                                  h->value.length ++;
+                                                                                }
+                                                                              }
+                                                                              break;
+                                                      case __FINAL_LINE_FEED__: if (c != '\n') __state__ = __MALFORMED__; else __endOfHeader__ ();
+                                                                              break;
+                                                      default:                break;
+                                                    }
+                                                    if (__state__ != __MALFORMED__) __parsed__ ++;
+                                                  }
+                                                  if (__state__ == __COMPLETE__) return HttpRequest::COMPLETE;
+                                                  if (__state__ == __MALFORMED__) return HttpRequest::MALFORMED;
+                                                  if (__state__ == __UNSUPPORTED__) return HttpRequest::UNSUPPORTED;
+                                                  return HttpRequest::INCOMPLETE;
+                                                }
+
+      void reset ()                             { *this = HttpRequest (); } // prepares the parser for the next request
+
+      bool isComplete ()                        { return __state__ == __COMPLETE__; }
+
+      unsigned int getLength ()                 { return __headerLength__ ? __headerLength__ : __parsed__; } // bytes parsed so far, the length of whole request header once it is complete (without body)
+
+      unsigned long getContentLength ()         { return __contentLength__; } // Content-Length of the request, 0 if there is no body
+
+      HttpStringView getBody ()                 { return __state__ == __COMPLETE__ && __contentLength__ ? HttpStringView (__buffer__ + __headerLength__, __contentLength__) : HttpStringView (); } // a view with data == NULL if there is no body
+
+      HttpStringView getMethod ()               { return __view__ (__method__); }   // GET, PUT, ...
+
+      HttpStringView getPath ()                 { return __view__ (__path__); }     // /index.html, without query
+
+      HttpStringView getQuery ()                { return __view__ (__query__); }    // what follows ? in request target, without ?
+
+      HttpStringView getVersion ()              { return __view__ (__version__); }  // HTTP/1.1, HTTP/1.0 or empty
+
+      HttpStringView getRequest ()              { return HttpStringView (__buffer__, getLength ()); } // the whole request header, including the empty line
+
+      unsigned int getHeaderCount ()            { return __headerCount__; }
+
+      HttpStringView getHeaderName (unsigned int i) { return i < __headerCount__ ? __view__ (__headers__ [i].name) : HttpStringView (); }
+
+      HttpStringView getHeaderValue (unsigned int i) { return i < __headerCount__ ? __view__ (__headers__ [i].value) : HttpStringView (); }
+
+      HttpStringView getHeader (const char *name) { // case insensitive, returns the first header with this name or a view with data == NULL
+                                                  unsigned int length = 0;
+                                                  uint16_t hash = HTTP_HASH_SEED;
+                                                  for (const char *p = name; *p; p++, length++) hash = __hashChar__ (hash, *p);
+                                                  for (unsigned int i = 0; i < __headerCount__; i++)
+                                                    if (__headers__ [i].hash == hash && __headers__ [i].name.length == length && !strncasecmp (__buffer__ + __headers__ [i].name.offset, name, length))
+                                                      return __view__ (__headers__ [i].value);
+                                                  return HttpStringView ();
+                                                }
+
+      bool keepAlive ()                         { // HTTP/1.1 connections are persistent unless the client says otherwise, HTTP/1.0 connections only if the client asks for it
+                                                  if (getVersion () == "HTTP/1.1") return !getHeader ("Connection").hasToken ("close");
+                                                  return getHeader ("Connection").hasToken ("keep-alive");
+                                                }
+
+      unsigned int getPathParameterCount ()     { return __pathParameterCount__; }
+
+      HttpStringView getPathParameter (unsigned int i) { return i < __pathParameterCount__ ? __view__ (__pathParameters__ [i]) : HttpStringView (); }
+
+      HttpStringView getPathParameter (const char *name) { // the part of the path that matched {name} in route's path pattern or a view with data == NULL
+                                                  for (unsigned int i = 0; i < __pathParameterCount__; i++) if (!strcmp (__pathParameterNames__ [i], name)) return __view__ (__pathParameters__ [i]);
+                                                  return HttpStringView ();
+                                                }
+
+    private:
+
+      friend class HttpRoutes;
+
+      struct __span__ {                                             // offset from the beginning of the request, 16 bits are enough for HTTP_MAX_REQUEST_LENGTH
+        uint16_t offset;
+        uint16_t length;
+      };
+
+      struct __header__ {
+        __span__ name;
+        __span__ value;
+        uint16_t hash;                                              // of lower case name
+      };
+
+      enum __PARSER_STATE__ {
+        __METHOD__ = 0,
+        __PATH__,
+        __QUERY__,
+        __HTTP_VERSION__,
+        __LINE_FEED__,                                              // \r has been read, \n should follow
+        __LINE_START__,                                             // a header or the final empty line starts
+        __HEADER_NAME__,
+        __VALUE_START__,
+        __HEADER_VALUE__,
+        __FINAL_LINE_FEED__,                                        // \r of the final empty line has been read
+        __BODY__,                                                   // waiting for __contentLength__ bytes of body
+        __COMPLETE__,
+        __MALFORMED__,
+        __UNSUPPORTED__
+      };
+
+      const char *__buffer__ = NULL;
+      uint16_t __parsed__ = 0;
+      uint16_t __headerLength__ = 0;                                // set when the header is complete
+      unsigned long __contentLength__ = 0;
+      uint8_t __state__ = __METHOD__;
+      uint8_t __headerCount__ = 0;
+      __span__ __method__ = {0, 0};
+      __span__ __path__ = {0, 0};
+      __span__ __query__ = {0, 0};
+      __span__ __version__ = {0, 0};
+      __header__ __headers__ [HTTP_MAX_HEADERS];
+      uint8_t __pathParameterCount__ = 0;
+      __span__ __pathParameters__ [HTTP_MAX_PATH_PARAMETERS];
+      const char *__pathParameterNames__ [HTTP_MAX_PATH_PARAMETERS];       // point into HttpRoutes
+
+      HttpStringView __view__ (__span__ s)      { return __buffer__ ? HttpStringView (__buffer__ + s.offset, s.length) : HttpStringView (); }
+
+      void __endOfHeader__ ()                   { // checks how the body is framed, called when the final empty line has been read
+                                                  __headerLength__ = __parsed__ + 1;
+                                                  bool contentLengthFound = false, transferEncodingFound = false;
+                                                  for (unsigned int i = 0; i < __headerCount__; i++) {
+                                                    HttpStringView name = __view__ (__headers__ [i].name), value = __view__ (__headers__ [i].value);
+                                                    if (name.equalsIgnoreCase ("Transfer-Encoding")) transferEncodingFound = true;
+                                                    else if (name.equalsIgnoreCase ("Content-Length")) {
+                                                      unsigned long contentLength = 0;
+                                                      if (!value.length || value.length > 9) { __state__ = __MALFORMED__; return; } // up to 999999999, doesn't overflow
+                                                      for (unsigned int j = 0; j < value.length; j++) {
+                                                        if (value.data [j] < '0' || value.data [j] > '9') { __state__ = __MALFORMED__; return; }
+                                                        contentLength = contentLength * 10 + value.data [j] - '0';
+                                                      }
+                                                      if (contentLengthFound && contentLength != __contentLength__) { __state__ = __MALFORMED__; return; }
+                                                      contentLengthFound = true;
+                                                      __contentLength__ = contentLength;
+                                                    }
+                                                  }
+                                                  if (transferEncodingFound && contentLengthFound) __state__ = __MALFORMED__;
+                                                  else if (transferEncodingFound || __contentLength__ > HTTP_MAX_BODY_LENGTH) __state__ = __UNSUPPORTED__;
+                                                  else __state__ = __contentLength__ ? __BODY__ : __COMPLETE__;
+                                                }
+
+      void __endOfLine__ (char c)               { __state__ = c == '\r' ? __LINE_FEED__ : __LINE_START__; } // bare \n is accepted as the end of line as well
+
+      static uint16_t __hashChar__ (uint16_t hash, char c) { if (c >= 'A' && c <= 'Z') c += 32; return (uint16_t) (hash * 33 + (uint8_t) c); }
+  };
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * HttpRoutes.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  HttpRoutes is a route table for httpServer: the calling program adds method, path pattern and route handler for each
+ *  REST function once, at startup, instead of comparing every request with all of them in a long if / else chain.
+ *
+ *  Path patterns are split into segments and built into a trie. A segment in {} (like /niceSlider3/{value}) matches any
+ *  non-empty path segment, route handler reads it with HttpRequest::getPathParameter ("value"). Literal segments have
+ *  precedence over {} segments. Trie edges are kept in one open addressing hash table keyed by parent node and segment,
+ *  so finding a route takes one hash look-up per path segment no matter how many routes there are.
+ *
+ *  Routes must all be added before the table is given to httpServer (setRoutes), find () only reads the table so any
+ *  number of request handler threads can use it at the same time.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __HTTP_ROUTES__
+  #define __HTTP_ROUTES__
+
+  #include "HttpRequest.hpp"
+
+
+  typedef String (*HttpRouteHandler) (HttpRequest& httpRequest); // returns the reply or "" if the request is not handled after all
+
+
+  class HttpRoutes {
+
+    public:
+
+      ~HttpRoutes ()                            {
+                                                  for (int i = 0; i < __patternCount__; i++) free (__patterns__ [i]);
+                                                  free (__patterns__); free (__nodes__); free (__handlers__); free (__edges__);
+                                                }
+
+      // adds a route, returns false if the pattern is not valid, the same method and pattern have already been added or there is not enough memory
+      bool add (const char *method, const char *pathPattern, HttpRouteHandler routeHandler) {
+                                                  if (!method || !*method || !pathPattern || *pathPattern != '/' || !routeHandler) return false;
+                                                  // keep a copy of method and pattern, trie points into it
+                                                  if (!__grow__ ((void **) &__patterns__, &__patternCapacity__, __patternCount__ + 1, sizeof (char *))) return false;
+                                                  char *copy = (char *) malloc (strlen (method) + strlen (pathPattern) + 2);
+                                                  if (!copy) return false;
+                                                  __patterns__ [__patternCount__ ++] = copy; // freed by destructor even if add fails later, some edges may already point into it
+                                                  strcpy (copy, method);
+                                                  char *p = strcpy (copy + strlen (method) + 1, pathPattern);
+
+                                                  if (!__nodeCount__ && __newNode__ () < 0) return false; // root node
+                                                  int node = 0;
+                                                  while (*p == '/') {
+                                                    p ++;
+                                                    if (!*p) break; // trailing / is ignored
+                                                    char *q = p; while (*q && *q != '/') q ++;
+                                                    char c = *q; *q = 0; // 0 terminate the segment (parameter name)
+                                                    if (*p == '{') {
+                                                      if (q - p < 3 || q [-1] != '}') return false; // {} or missing }
+                                                      q [-1] = 0;
+                                                      if (__nodes__ [node].parameterChild < 0) {
+                                                        int child = __newNode__ ();
+                                                        if (child < 0) return false;
+                                                        __nodes__ [node].parameterChild = child;
+                                                        __nodes__ [node].parameterName = p + 1;
+                                                      } else if (strcmp (__nodes__ [node].parameterName, p + 1)) {
+                                                        return false; // the same path segment has different names in different patterns
+                                                      }
+                                                      node = __nodes__ [node].parameterChild;
+                                                    } else {
+                                                      if (q == p) return false; // empty segment (//)
+                                                      int child = __findEdge__ (node, p, q - p);
+                                                      if (child < 0) {
+                                                        if ((child = __newNode__ ()) < 0) return false;
+                                                        if (!__addEdge__ (node, p, q - p, child)) return false;
+                                                      }
+                                                      node = child;
+                                                    }
+                                                    *q = c;
+                                                    p = q;
+                                                  }
+                                                  if (*p) return false;
+
+                                                  for (int h = __nodes__ [node].firstHandler; h >= 0; h = __handlers__ [h].next)
+                                                    if (!strcmp (__handlers__ [h].method, method)) return false; // already there
+                                                  if (!__grow__ ((void **) &__handlers__, &__handlerCapacity__, __handlerCount__ + 1, sizeof (__handler__))) return false;
+                                                  __handlers__ [__handlerCount__] = {copy, routeHandler, __nodes__ [node].firstHandler};
+                                                  __nodes__ [node].firstHandler = __handlerCount__ ++;
+                                                  __routeCount__ ++;
+                                                  return true;
+                                                }
+
+      // finds route handler for the request and sets request's path parameters, returns NULL if no route matches
+      HttpRouteHandler find (HttpRequest& httpRequest) {
+                                                  httpRequest.__pathParameterCount__ = 0;
+                                                  if (!__nodeCount__) return NULL;
+                                                  HttpStringView path = httpRequest.getPath ();
+                                                  HttpStringView method = httpRequest.getMethod ();
+                                                  if (!path.data || !path.length || *path.data != '/') return NULL;
+                                                  return __match__ (0, path.data, path.data + path.length, method, httpRequest);
+                                                }
+
+      unsigned int count ()                     { return __routeCount__; } // number of routes added
+
+    private:
+
+      struct __node__ {
+        int parameterChild;                                         // node for {} segment or -1
+        const char *parameterName;
+        int firstHandler;                                           // list of route handlers (one per method) for the path that ends here or -1
+      };
+
+      struct __handler__ {
+        const char *method;
+        HttpRouteHandler routeHandler;
+        int next;
+      };
+
+      struct __edge__ {                                             // trie edge in hash table, child is -1 for empty slot
+        int parent;
+        int child;
+        const char *segment;
+        unsigned int length;
+      };
+
+      char **__patterns__ = NULL;                                   // copies of method and pattern, trie points into them
+      int __patternCount__ = 0;
+      int __patternCapacity__ = 0;
+      __node__ *__nodes__ = NULL;
+      int __nodeCount__ = 0;
+      int __nodeCapacity__ = 0;
+      __handler__ *__handlers__ = NULL;
+      int __handlerCount__ = 0;
+      int __handlerCapacity__ = 0;
+      __edge__ *__edges__ = NULL;                                   // open addressing hash table, __edgeSlots__ is a power of 2
+      unsigned int __edgeSlots__ = 0;
+      unsigned int __edgeCount__ = 0;
+      unsigned int __routeCount__ = 0;
+
+      HttpRouteHandler __match__ (int node, const char *p, const char *end, HttpStringView& method, HttpRequest& httpRequest) {
+                                                  if (p < end) p ++; // skip /
+                                                  if (p == end) { // the whole path has matched, does the method match as well?
+                                                    for (int h = __nodes__ [node].firstHandler; h >= 0; h = __handlers__ [h].next)
+                                                      if (method == __handlers__ [h].method) return __handlers__ [h].routeHandler;
+                                                    return NULL;
+                                                  }
+                                                  const char *q = p; while (q < end && *q != '/') q ++;
+                                                  int child = __findEdge__ (node, p, q - p);
+                                                  if (child >= 0) {
+                                                    HttpRouteHandler routeHandler = __match__ (child, q, end, method, httpRequest);
+                                                    if (routeHandler) return routeHandler;
+                                                  }
+                                                  child = __nodes__ [node].parameterChild;
+                                                  if (child >= 0 && q > p && httpRequest.__pathParameterCount__ < HTTP_MAX_PATH_PARAMETERS) { // try {} segment then
+                                                    int i = httpRequest.__pathParameterCount__ ++;
+                                                    httpRequest.__pathParameters__ [i] = {(uint16_t) (p - httpRequest.__buffer__), (uint16_t) (q - p)};
+                                                    httpRequest.__pathParameterNames__ [i] = __nodes__ [node].parameterName;
+                                                    HttpRouteHandler routeHandler = __match__ (child, q, end, method, httpRequest);
+                                                    if (routeHandler) return routeHandler;
+                                                    httpRequest.__pathParameterCount__ --;
+                                                  }
+                                                  return NULL;
+                                                }
+
+      int __newNode__ ()                        {
+                                                  if (!__grow__ ((void **) &__nodes__, &__nodeCapacity__, __nodeCount__ + 1, sizeof (__node__))) return -1;
+                                                  __nodes__ [__nodeCount__] = {-1, NULL, -1};
+                                                  return __nodeCount__ ++;
+                                                }
+
+      static unsigned int __hash__ (int parent, const char *segment, unsigned int length) { // FNV-1a
+                                                  unsigned int h = 2166136261u ^ (unsigned int) parent;
+                                                  for (unsigned int i = 0; i < length; i++) h = (h ^ (uint8_t) segment [i]) * 16777619u;
+                                                  return h;
+                                                }
+
+      int __findEdge__ (int parent, const char *segment, unsigned int length) {
+                                                  if (!__edgeSlots__) return -1;
+                                                  for (unsigned int i = __hash__ (parent, segment, length) & (__edgeSlots__ - 1); __edges__ [i].child >= 0; i = (i + 1) & (__edgeSlots__ - 1))
+                                                    if (__edges__ [i].parent == parent && __edges__ [i].length == length && !memcmp (__edges__ [i].segment, segment, length)) return __edges__ [i].child;
+                                                  return -1;
+                                                }
+
+      bool __addEdge__ (int parent, const char *segment, unsigned int length, int child) {
+                                                  if ((__edgeCount__ + 1) * 2 > __edgeSlots__) { // keep the table at most half full, rehash into a twice as large one
+                                                    unsigned int slots = __edgeSlots__ ? __edgeSlots__ * 2 : 16;
+                                                    __edge__ *edges = (__edge__ *) malloc (slots * sizeof (__edge__));
+                                                    if (!edges) return false;
+                                                    for (unsigned int i = 0; i < slots; i++) edges [i].child = -1;
+                                                    __edge__ *oldEdges = __edges__;
+                                                    unsigned int oldSlots = __edgeSlots__;
+                                                    __edges__ = edges; __edgeSlots__ = slots;
+                                                    for (unsigned int i = 0; i < oldSlots; i++) if (oldEdges [i].child >= 0) __insertEdge__ (oldEdges [i]);
+                                                    free (oldEdges);
+                                                  }
+                                                  __insertEdge__ ({parent, child, segment, length});
+                                                  __edgeCount__ ++;
+                                                  return true;
+                                                }
+
+      void __insertEdge__ (const __edge__& edge) {
+                                                  unsigned int i = __hash__ (edge.parent, edge.segment, edge.length) & (__edgeSlots__ - 1);
+                                                  while (__edges__ [i].child >= 0) i = (i + 1) & (__edgeSlots__ - 1);
+                                                  __edges__ [i] = edge;
+                                                }
+
+      static bool __grow__ (void **array, int *capacity, int needed, size_t elementSize) { // makes room for needed elements
+                                                  if (needed <= *capacity) return true;
+                                                  int newCapacity = *capacity ? *capacity * 2 : 8;
+                                                  void *newArray = realloc (*array, newCapacity * elementSize);
+                                                  if (!newArray) return false;
+                                                  *array = newArray;
+                                                  *capacity = newCapacity;
+                                                  return true;
+                                                }
+  };
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * TcpFirewall.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  TcpFirewall.hpp contains a firewall rule engine for TcpServer and AsyncTcpServer. Rules are compiled into a binary prefix
+ *  trie and checked against raw 32 bit address of the connecting client before anything else is done with the connection,
+ *  so rejecting a connection needs no String formatting and no heap. Rules are usually read from a file like /etc/firewall.conf:
+ *
+ *    # the most specific rule that matches client's IP decides, the default rule decides if no other rule matches
+ *    default allow
+ *    deny 10.0.0.0/24
+ *    allow 10.0.0.1
+ *
+ *  Each rule counts how many times it has decided about a connection.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __TCP_FIREWALL__
+  #define __TCP_FIREWALL__
+
+  class TcpFirewall {
+
+    public:
+
+      TcpFirewall ()                            {} // allows everything until rules are loaded
+
+      TcpFirewall (String rules)                { loadRules (rules); }
+
+      ~TcpFirewall ()                           { __free__ (__rules__, __nodes__); }
+
+      // compiles rules and replaces existing ones if there are no errors, rule counters start from 0
+      bool loadRules (String rules)             {
+                                                  // the first pass only checks and counts the rules so that exactly the needed memory can be allocated for the second one
+                                                  __ruleType__ *newRules = NULL;
+                                                  __nodeType__ *newNodes = NULL;
+                                                  int ruleCount = 0;
+                                                  int nodeCount = 1; // root
+                                                  bool defaultAllow = true;
+                                                  for (int pass = 0; pass < 2; pass ++) {
+                                                    if (pass) {
+                                                      newRules = (__ruleType__ *) calloc (ruleCount ? ruleCount : 1, sizeof (__ruleType__));
+                                                      newNodes = (__nodeType__ *) calloc (nodeCount, sizeof (__nodeType__));
+                                                      if (!newRules || !newNodes) {
+                                                        __free__ (newRules, newNodes);
+                                                        TcpDmesg ("[TcpFirewall] out of memory, firewall rules are not loaded.");
+                                                        return false;
+                                                      }
+                                                      newNodes [0].rule = -1;
+                                                      ruleCount = 0;
+                                                      nodeCount = 1;
+                                                    }
+                                                    int lineStart = 0;
+                                                    while (lineStart < (int) rules.length ()) {
+                                                      int lineEnd = rules.indexOf ('\n', lineStart);
+                                                      if (lineEnd < 0) lineEnd = rules.length ();
+                                                      char line [64];
+                                                      int lineLength = lineEnd - lineStart < (int) sizeof (line) - 1 ? lineEnd - lineStart : sizeof (line) - 1;
+                                                      memcpy (line, rules.c_str () + lineStart, lineLength);
+                                                      line [lineLength] = 0;
+                                                      lineStart = lineEnd + 1;
+                                                      char *p = strchr (line, '#'); if (p) *p = 0; // skip comments
+                                                      char action [8], address [20];
+                                                      int n = sscanf (line, "%7s %19s", action, address);
+                                                      if (n <= 0) continue; // empty line
+                                                      if (n == 2 && !strcmp (action, "default") && (!strcmp (address, "allow") || !strcmp (address, "deny"))) {
+                                                        defaultAllow = !strcmp (address, "allow");
+                                                        continue;
+                                                      }
+                                                      bool allow = !strcmp (action, "allow");
+                                                      in_addr_t ip;
+                                                      int prefixLength;
+                                                      if (n != 2 || (!allow && strcmp (action, "deny")) || !__parseCidr__ (address, &ip, &prefixLength)) {
+                                                        TcpDmesg ("[TcpFirewall] invalid rule: " + String (line) + ", firewall rules are not loaded."); // only the first pass can get here
+                                                        return false;
+                                                      }
+                                                      if (pass) {
+                                                        newRules [ruleCount] = {ip, (unsigned char) prefixLength, allow, 0};
+                                                        __insert__ (newRules, ruleCount, newNodes, &nodeCount);
+                                                      } else {
+                                                        nodeCount += prefixLength; // worst case, no nodes are shared
+                                                      }
+                                                      ruleCount ++;
+                                                    }
+                                                  }
+                                                  // replace old rules with new ones
+                                                  __ruleType__ *oldRules;
+                                                  __nodeType__ *oldNodes;
+                                                  portENTER_CRITICAL (&__csFirewall__);
+                                                    oldRules = __rules__; oldNodes = __nodes__;
+                                                    __rules__ = newRules; __nodes__ = newNodes;
+                                                    __ruleCount__ = ruleCount;
+                                                    __defaultAllow__ = defaultAllow;
+                                                    __defaultHits__ = 0;
+                                                  portEXIT_CRITICAL (&__csFirewall__);
+                                                  __free__ (oldRules, oldNodes);
+                                                  return true;
+                                                }
+
+      // returns true if connection from ip (in network byte order, like sin_addr.s_addr) is allowed
+      bool allows (in_addr_t ip)                {
+                                                  uint32_t bits = ntohl (ip);
+                                                  bool allow;
+                                                  portENTER_CRITICAL (&__csFirewall__);
+                                                    if (!__nodes__) {
+                                                      allow = __defaultAllow__;
+                                                      __defaultHits__ ++;
+                                                    } else {
+                                                      // walk down the trie and remember the last (the most specific) rule on the way
+                                                      int rule = __nodes__ [0].rule;
+                                                      int node = 0;
+                                                      for (int i = 31; i >= 0 && (node = __nodes__ [node].child [(bits >> i) & 1]); i--)
+                                                        if (__nodes__ [node].rule >= 0) rule = __nodes__ [node].rule;
+                                                      if (rule >= 0) {
+                                                        allow = __rules__ [rule].allow;
+                                                        __rules__ [rule].hits ++;
+                                                      } else {
+                                                        allow = __defaultAllow__;
+                                                        __defaultHits__ ++;
+                                                      }
+                                                    }
+                                                  portEXIT_CRITICAL (&__csFirewall__);
+                                                  return allow;
+                                                }
+
+      // lists the rules with their counters, formatted for telnet
+      String listRules ()                       {
+                                                  String s = "   hits  rule";
+                                                  char line [64];
+                                                  for (int i = 0; ; i++) {
+                                                    __ruleType__ rule;
+                                                    portENTER_CRITICAL (&__csFirewall__); // rules may get reloaded in the meantime, copy one at a time
+                                                      bool found = i < __ruleCount__;
+                                                      if (found) rule = __rules__ [i];
+                                                    portEXIT_CRITICAL (&__csFirewall__);
+                                                    if (!found) break;
+                                                    struct in_addr a = {rule.ip};
+                                                    sprintf (line, "\r\n%7lu  %s %s/%i", rule.hits, rule.allow ? "allow" : "deny ", __inet_ntos__ (a).c_str (), rule.prefixLength);
+                                                    s += line;
+                                                  }
+                                                  sprintf (line, "\r\n%7lu  default %s", __defaultHits__, __defaultAllow__ ? "allow" : "deny");
+                                                  return s + line;
+                                                }
+
+    private:
+
+      struct __ruleType__ {
+        in_addr_t ip;                                                   // network byte order
+        unsigned char prefixLength;
+        bool allow;
+        unsigned long hits;
+      };
+
+      struct __nodeType__ {                                             // binary trie node, one bit of address per level
+        int child [2];                                                  // index of child node, 0 if there is none (root is never a child)
+        int rule;                                                       // index of rule whose prefix ends here, -1 if none
+      };
+
+      portMUX_TYPE __csFirewall__ = portMUX_INITIALIZER_UNLOCKED;
+      __ruleType__ *__rules__ = NULL;
+      __nodeType__ *__nodes__ = NULL;
+      int __ruleCount__ = 0;
+      bool __defaultAllow__ = true;
+      unsigned long __defaultHits__ = 0;
+
+      void __free__ (__ruleType__ *rules, __nodeType__ *nodes) { if (rules) free (rules); if (nodes) free (nodes); }
+
+      bool __parseCidr__ (char *address, in_addr_t *ip, int *prefixLength) { // parses IP or IP/prefixLength
+                                                  *prefixLength = 32;
+                                                  char *slash = strchr (address, '/');
+                                                  if (slash) {
+                                                    *slash = 0;
+                                                    *prefixLength = atoi (slash + 1);
+                                                    if (*prefixLength < 0 || *prefixLength > 32 || !isdigit (slash [1])) return false;
+                                                  }
+                                                  struct in_addr a;
+                                                  if (!inet_aton (address, &a)) return false;
+                                                  *ip = *prefixLength ? a.s_addr & htonl (0xFFFFFFFF << (32 - *prefixLength)) : 0; // clear host bits
+                                                  return true;
+                                                }
+
+      void __insert__ (__ruleType__ *rules, int rule, __nodeType__ *nodes, int *nodeCount) { // inserts rule's prefix into the trie being compiled
+                                                  uint32_t bits = ntohl (rules [rule].ip);
+                                                  int node = 0;
+                                                  for (int i = 0; i < rules [rule].prefixLength; i++) {
+                                                    int bit = (bits >> (31 - i)) & 1;
+                                                    if (!nodes [node].child [bit]) {
+                                                      nodes [node].child [bit] = *nodeCount;
+                                                      nodes [*nodeCount].rule = -1;
+                                                      (*nodeCount) ++;
+                                                    }
+                                                    node = nodes [node].child [bit];
+                                                  }
+                                                  nodes [node].rule = rule; // if the same prefix appears more than once the last rule wins
+                                                }
+
+  };
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * TcpRateLimiter.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  TcpRateLimiter.hpp contains per client IP connection rate limiter for TcpServer and AsyncTcpServer. Each client IP has its own
+ *  token bucket that holds at most burst tokens and is refilled with connectionsPerSecond tokens each second, an accepted connection
+ *  takes one token and it is throttled (reset) if there is none left. The buckets are kept in a fixed size table (set-associative
+ *  hash table: client IP selects a set, within a set the least recently used bucket is evicted when a new IP arrives), so deciding
+ *  about a connection needs no heap. An evicted IP starts again with a full bucket, so the table should be large enough for the
+ *  number of clients that connect at the same time.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ */
+
+
+#ifndef __TCP_RATE_LIMITER__
+  #define __TCP_RATE_LIMITER__
+
+  #define TCP_RATE_LIMITER_SETS 16                                          // must be a power of 2
+  #define TCP_RATE_LIMITER_WAYS 4                                           // buckets per set, 16 x 4 x 12 bytes of table
+
+  class TcpRateLimiter {
+
+    public:
+
+      TcpRateLimiter (unsigned int connectionsPerSecond, unsigned int burst) { setRate (connectionsPerSecond, burst); }
+
+      void setRate (unsigned int connectionsPerSecond, unsigned int burst) { // existing buckets keep their tokens (up to the new burst)
+                                                  portENTER_CRITICAL (&__csRateLimiter__);
+                                                    __tokensPerMilli__ = connectionsPerSecond; // 1000 milli tokens per connection
+                                                    __maxTokens__ = (burst ? burst : 1) * 1000;
+                                                  portEXIT_CRITICAL (&__csRateLimiter__);
+                                                }
+
+      bool allows (in_addr_t ip)                { // takes a token from IP's bucket, returns false if there is none left
+                                                  unsigned long now = millis ();
+                                                  bool allowed;
+                                                  portENTER_CRITICAL (&__csRateLimiter__);
+                                                    __bucketType__ *set = __table__ [(ip * 2654435761u) >> 24 & (TCP_RATE_LIMITER_SETS - 1)]; // Fibonacci hashing, upper bits are well mixed
+                                                    __bucketType__ *bucket = NULL;
+                                                    __bucketType__ *leastRecentlyUsed = set;
+                                                    for (int i = 0; i < TCP_RATE_LIMITER_WAYS; i++) {
+                                                      if (set [i].ip == ip) { bucket = &set [i]; break; }
+                                                      if (!set [i].ip || (leastRecentlyUsed->ip && now - set [i].lastMillis > now - leastRecentlyUsed->lastMillis)) leastRecentlyUsed = &set [i]; // free bucket or the one that has been used the longest time ago
+                                                    }
+                                                    if (bucket) { // refill tokens for the time since the last connection
+                                                      unsigned long elapsed = now - bucket->lastMillis;
+                                                      if (__tokensPerMilli__ && elapsed < __maxTokens__ / __tokensPerMilli__) bucket->tokens += elapsed * __tokensPerMilli__;
+                                                      else if (__tokensPerMilli__)                                          bucket->tokens = __maxTokens__;
+                                                      if (bucket->tokens > __maxTokens__) bucket->tokens = __maxTokens__;
+                                                    } else { // new IP takes the place of least recently used one
+                                                      bucket = leastRecentlyUsed;
+                                                      if (bucket->ip) __evictions__ ++;
+                                                      bucket->ip = ip;
+                                                      bucket->tokens = __maxTokens__;
+                                                    }
+                                                    bucket->lastMillis = now;
+                                                    if ((allowed = bucket->tokens >= 1000)) bucket->tokens -= 1000;
+                                                    else                                    __throttled__ ++;
+                                                  portEXIT_CRITICAL (&__csRateLimiter__);
+                                                  return allowed;
+                                                }
+
+      unsigned int getConnectionsPerSecond ()   { return __tokensPerMilli__; }
+      unsigned int getBurst ()                  { return __maxTokens__ / 1000; }
+      unsigned long getThrottled ()             { return __throttled__; }  // connections that found their bucket empty
+      unsigned long getEvictions ()             { return __evictions__; }  // buckets that were taken over by another IP
+
+    private:
+
+      struct __bucketType__ {
+        in_addr_t ip;                                                     // 0 - bucket is free
+        unsigned long tokens;                                             // in 1/1000 of connection
+        unsigned long lastMillis;                                         // when tokens were last refilled
+      };
+      __bucketType__ __table__ [TCP_RATE_LIMITER_SETS][TCP_RATE_LIMITER_WAYS] = {};
+
+      portMUX_TYPE __csRateLimiter__ = portMUX_INITIALIZER_UNLOCKED;
+      unsigned long __tokensPerMilli__;
+      unsigned long __maxTokens__;
+      unsigned long __throttled__ = 0;
+      unsigned long __evictions__ = 0;
+
+  };
+
+#endif
@@ -38,6 +38,50 @@
  *            February 26, 2020, Bojan Jurca
  *          - elimination of compiler warnings and some bugs
  *            Jun 10, 2020, Bojan Jurca            
+ *          - listener waits for connections in select () instead of polling accept () every millisecond,
+ *            fixed race between connection thread deleting its instance and TcpServer calling started ()
+ *            October 16, 2026
+ *          - added optional pool mode: pre-created worker threads handle connections from a bounded queue
+ *            October 16, 2026
+ *          - recvData and sendData wait in select () until socket is ready or time-out expires instead of retrying every millisecond
+ *            October 16, 2026
+ *          - added sendData (const struct iovec *, int) that sends several buffers with one writev
+ *            October 16, 2026
+ *          - added buffered reading: peek, consume, readUntil and readLine
+ *            October 16, 2026
+ *          - connection time-outs are tracked in a shared timer wheel (TimerWheel.hpp) which shuts down expired sockets proactively
+ *            October 16, 2026
+ *          - added connection admission control (TcpAdmissionControl)
+ *            October 16, 2026
+ *          - added optional TcpFirewall that checks raw client address before anything else, client IP is formatted only once per connection
+ *            October 16, 2026
+ *          - connections keep traffic and latency statistics in TcpConnectionRegistry, servers keep latency and size histograms of finished connections
+ *            October 16, 2026
+ *          - available () reports ERROR once the connection has been closed
+ *            October 16, 2026
+ *          - removed global csTcpConnectionInternalStructure critical section, connections close their sockets with atomic exchange
+ *            and format this side IP only once, time-out timer is removed from timer wheel when connection is deleted
+ *            October 16, 2026
+ *          - added optional output buffer (setOutputBuffer, flush) that coalesces small sendData calls into full TCP segments
+ *            October 16, 2026
+ *          - added sendFile that reads file in large blocks, the next block is read while the previous one is being sent
+ *            October 16, 2026
+ *          - added optional per client IP connection rate limit (TcpRateLimiter), checked before a new connection is created
+ *            October 16, 2026
+ *          - added TcpTaskPolicy: listener and connection tasks can be pinned to a core (or spread round-robin) with a given priority,
+ *            optionally with one listener per core accepting connections on the same port
+ *            October 16, 2026
+ *          - added optional accept filter (setAcceptFilter): connection thread is created only after the client sends something,
+ *            connections that stay silent are closed by listener
+ *            October 16, 2026
+ *          - added TcpConnection::detach () so that a connection can be given back to AsyncTcpServer event loop
+ *            October 16, 2026
+ *          - silent accept filter connections are closed in time even while QUEUE admission is full
+ *            October 16, 2026
+ *          - destructor wakes up all the listeners (listenerPerCore), not just one of them
+ *            October 16, 2026
+ *          - a connection waiting for its socket sleeps until its time-out instead of waking up every second, timer wheel wakes it up
+ *            October 16, 2026
  *          
  */
 
@@ -56,19 +100,22 @@
 
   #include <WiFi.h>
   #include <lwip/sockets.h>
+  #include <FS.h>
+
+  #define tskNORMAL_PRIORITY 1
   
   // TcpConnection can be used in two different modes:
   // - threaded TcpConnection creates a new thread and runs connectionHandlerCallback function through it
   //    successful instance creation can be tested using started () member function - result is available immediately after constructor returns
+  //      (but since a short connection may finish and delete its instance before started () gets called, threadStarted constructor parameter is safer)
   //      if started () then just leave instance running, it will delete () itself when connection finishes 
   //      else you must delete () instance yourself
   //    TO DO: make constructor return NULL in unsuccessful
+  //    if workerPoolSize > 0 threaded TcpServer runs in pool mode: worker threads are created in advance and each of them handles one connection at a time,
+  //    accepted connections wait in a queue of workerQueueDepth places for a free worker thread, new connections are closed immediately if the queue is full
   // - non-threaded TcpConnection can be controlled from calling program
   //    you must delete () instance yourself when no longer needed
 
-      // controll TcpServer critical sections
-      portMUX_TYPE csTcpConnectionInternalStructure = portMUX_INITIALIZER_UNLOCKED;
-
       // controll vTaskDelay - vTaskSuspendAll multi-threading problem while accessing SPIFFS file system (see https://www.esp32.com/viewtopic.php?t=7876)
       SemaphoreHandle_t SPIFFSsemaphore = xSemaphoreCreateMutex ();
 
@@ -105,6 +152,477 @@
                String (*(((byte *) &addr) + 3));
       }
 
+  #include "TimerWheel.hpp"
+  #include "TcpFirewall.hpp"
+  #include "TcpRateLimiter.hpp"
+
+
+  // Connection statistics: each TcpConnection and AsyncTcpConnection keeps a tcpConnectionStatistics structure which is linked into 
+  // TcpConnectionRegistry for as long as the connection exists (this is what telnet netstat command and HTTP /netstat reply show).
+  // Owner of the connection updates the counters without locking, readers may see a value that is a few bytes behind.
+  // When a connection accepted by a server finishes, its figures are added to server's histograms (see TcpAdmissionControl).
+
+  struct tcpConnectionStatistics {
+    tcpConnectionStatistics *next;                                  // registry of live connections
+    tcpConnectionStatistics **pprev;
+    char *otherSideIP;                                              // points to connection's own copy
+    int thisSidePort;
+    int otherSidePort;
+    const char *state;                                              // what the connection is doing at the moment, like "handler"
+    unsigned long acceptedMillis;                                   // when connection has been accepted (or created)
+    unsigned long acceptedMicros;
+    unsigned long firstByteMicros;                                  // accept to the first byte received, 0 until the first byte arrives
+    unsigned long handlerStartMillis;                               // 0 - handler is not running
+    unsigned long handlerStartMicros;
+    unsigned long handlerMicros;                                    // time spent in connection handler (finished calls only)
+    unsigned long bytesReceived;
+    unsigned long bytesSent;
+  };
+
+  // histogram with power of 2 buckets: bucket 0 counts 0 values, bucket i counts values between 2^(i-1) and 2^i - 1
+  struct tcpHistogram {
+    #define TCP_HISTOGRAM_BUCKETS 33
+    unsigned long bucket [TCP_HISTOGRAM_BUCKETS];
+    unsigned long count;
+
+    void add (unsigned long value)              {
+                                                  int i = 0;
+                                                  while (value) { value >>= 1; i ++; }
+                                                  bucket [i] ++;
+                                                  count ++;
+                                                }
+
+    unsigned long percentile (int p)            { // returns the upper bound of the bucket where p % of values is reached, so it is accurate within a factor of 2
+                                                  if (!count) return 0;
+                                                  unsigned long long target = ((unsigned long long) count * p + 99) / 100;
+                                                  unsigned long long sum = 0;
+                                                  for (int i = 0; i < TCP_HISTOGRAM_BUCKETS; i++)
+                                                    if ((sum += bucket [i]) >= target) return i ? (unsigned long) ((1ULL << i) - 1) : 0;
+                                                  return (unsigned long) -1;
+                                                }
+  };
+
+  // elapsed time in microseconds, calculated from millis () after micros () may already have overflowed (> 71 minutes)
+  unsigned long __elapsedMicros__ (unsigned long startMillis, unsigned long startMicros) {
+    unsigned long elapsedMillis = millis () - startMillis;
+    if (elapsedMillis < 3600000) return micros () - startMicros;
+    return elapsedMillis < 4294967 ? elapsedMillis * 1000 : (unsigned long) -1;
+  }
+
+
+  // TcpAdmissionControl decides if a newly accepted connection will be served or rejected. Each server has its own instance
+  // that is shared with its connections (connections may outlive the server, the last one to finish releases it).
+  // Limits (0 means no limit) should be set with server's setAdmissionControl () right after the server is created:
+  //  - maxConnections      - the number of connections the server serves at the same time,
+  //  - maxConnectionsPerIP - the number of connections a single client IP may have at the same time,
+  //  - minFreeHeap         - free heap that must remain available before a new connection is accepted.
+  // What happens to connections that exceed the limits (or couldn't be served since there was no memory to create a thread for them):
+  //  - RESET - the connection is reset (RST) - the default,
+  //  - REPLY - overflowReply is sent (like HTTP "503" or FTP "421") and the connection is closed, 
+  //  - QUEUE - the server stops accepting connections until one of them finishes or there is enough free heap again, new connections 
+  //            wait in TCP listen backlog in the meantime (a client exceeding per IP limit gets REPLY or RESET since it would block everyone else).
+  // Optional per IP connection rate limit (see TcpRateLimiter.hpp) is set with server's setRateLimit () and checked right after accept,
+  // before anything else is done with the connection. Connections over the rate are reset and counted as throttled.
+  // TcpAdmissionControl also keeps histograms of first byte latency, handler duration and bytes of the connections that have finished.
+
+  class TcpAdmissionControl {
+
+    public:
+
+      enum OVERFLOW_TYPE {
+        RESET = 0,
+        REPLY = 1,
+        QUEUE = 2
+      };
+
+      TcpAdmissionControl (int serverPort, const char *overflowReply = "") {
+                                                  __serverPort__ = serverPort;
+                                                  __setOverflowReply__ (overflowReply);
+                                                  __slotReleased__ = xSemaphoreCreateBinary ();
+                                                  portENTER_CRITICAL (&__csAdmissionControls__); // register so telnet can display statistics of all the servers
+                                                    __next__ = __admissionControls__;
+                                                    __admissionControls__ = this;
+                                                  portEXIT_CRITICAL (&__csAdmissionControls__);
+                                                }
+
+      void setLimits (unsigned int maxConnections, unsigned int maxConnectionsPerIP, unsigned long minFreeHeap, TcpAdmissionControl::OVERFLOW_TYPE overflow, const char *overflowReply) {
+                                                  // per IP counters are only needed if per IP limit is set, connections of at most maxConnections (or ADMISSION_IP_SLOTS) different IPs can be counted at the same time
+                                                  #define ADMISSION_IP_SLOTS 16
+                                                  unsigned int ipSlots = maxConnectionsPerIP ? (maxConnections ? maxConnections : ADMISSION_IP_SLOTS) : 0;
+                                                  __ipCounterType__ *ipCounters = ipSlots ? (__ipCounterType__ *) calloc (ipSlots, sizeof (__ipCounterType__)) : NULL;
+                                                  if (ipSlots && !ipCounters) { TcpDmesg ("[TcpAdmissionControl] out of memory."); ipSlots = 0; }
+                                                  __ipCounterType__ *oldIpCounters;
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    __maxConnections__ = maxConnections;
+                                                    __maxConnectionsPerIP__ = ipSlots ? maxConnectionsPerIP : 0;
+                                                    __minFreeHeap__ = minFreeHeap;
+                                                    __overflow__ = overflow;
+                                                    oldIpCounters = __ipCounters__; // connections that are already running won't be counted per IP
+                                                    __ipCounters__ = ipCounters;
+                                                    __ipSlots__ = ipSlots;
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                  if (oldIpCounters) free (oldIpCounters);
+                                                  if (overflowReply) __setOverflowReply__ (overflowReply);
+                                                }
+
+      // connectionsPerSecond 0 turns rate limiting off
+      void setRateLimit (unsigned int connectionsPerSecond, unsigned int burst) {
+                                                  if (!connectionsPerSecond)  { __rateLimited__ = false; return; }
+                                                  if (__rateLimiter__)        __rateLimiter__->setRate (connectionsPerSecond, burst);
+                                                  else if (!(__rateLimiter__ = new TcpRateLimiter (connectionsPerSecond, burst))) { TcpDmesg ("[TcpAdmissionControl] out of memory."); return; }
+                                                  __rateLimited__ = true;
+                                                }
+
+      // server calls withinRateLimit () with raw client address before admit (), a connection that exceeds the rate must be passed to throttle ()
+      bool withinRateLimit (in_addr_t ip)       { return !__rateLimited__ || __rateLimiter__->allows (ip); }
+
+      void throttle (int connectionSocket)      { // resets the connection, it is counted by rate limiter
+                                                  struct linger lingerOption = {1, 0}; // closing with zero linger time resets the connection
+                                                  setsockopt (connectionSocket, SOL_SOCKET, SO_LINGER, &lingerOption, sizeof (lingerOption));
+                                                  close (connectionSocket);
+                                                }
+
+      // server calls admit () for each accepted connection, if it returns true the connection must call release () when it finishes, otherwise server must call reject ()
+      bool admit (char *clientIP)               {
+                                                  if (__minFreeHeap__ && ESP.getFreeHeap () < __minFreeHeap__) return false;
+                                                  in_addr_t ip = inet_addr (clientIP);
+                                                  bool admitted = false;
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    if (!__maxConnections__ || __activeConnections__ < __maxConnections__) {
+                                                      __ipCounterType__ *ipCounter = __maxConnectionsPerIP__ ? __findIpCounter__ (ip) : NULL;
+                                                      if (!__maxConnectionsPerIP__ || (ipCounter && ipCounter->connections < __maxConnectionsPerIP__)) {
+                                                        if (ipCounter) { ipCounter->ip = ip; ipCounter->connections ++; }
+                                                        __activeConnections__ ++;
+                                                        __references__ ++; // the connection keeps this instance alive until it calls release ()
+                                                        __acceptedConnections__ ++;
+                                                        admitted = true;
+                                                      }
+                                                    }
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                  return admitted;
+                                                }
+
+      void release (char *clientIP)             {
+                                                  in_addr_t ip = inet_addr (clientIP);
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    __activeConnections__ --;
+                                                    for (unsigned int i = 0; i < __ipSlots__; i++) 
+                                                      if (__ipCounters__ [i].connections && __ipCounters__ [i].ip == ip) { __ipCounters__ [i].connections --; break; }
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                  if (__overflow__ == TcpAdmissionControl::QUEUE) xSemaphoreGive (__slotReleased__); // wake up listener if it is waiting for a free slot
+                                                  __releaseReference__ ();
+                                                }
+
+      void reject (int connectionSocket)        {
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    __rejectedConnections__ ++;
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                  if (__overflow__ != TcpAdmissionControl::RESET && *__overflowReply__) {
+                                                    send (connectionSocket, __overflowReply__, strlen (__overflowReply__), 0); // just one try, socket is non-blocking and the reply fits into an empty send buffer
+                                                  } else {
+                                                    struct linger lingerOption = {1, 0}; // closing with zero linger time resets the connection
+                                                    setsockopt (connectionSocket, SOL_SOCKET, SO_LINGER, &lingerOption, sizeof (lingerOption));
+                                                  }
+                                                  close (connectionSocket);
+                                                }
+
+      bool enoughHeap ()                        { return !__minFreeHeap__ || ESP.getFreeHeap () >= __minFreeHeap__; } // checked alone when admission is deferred (see AsyncTcpServer::setDeferredAdmission)
+
+      // QUEUE overflow: listener doesn't accept new connections while the server is full
+      bool full ()                              { return __overflow__ == TcpAdmissionControl::QUEUE && ((__maxConnections__ && __activeConnections__ >= __maxConnections__) || (__minFreeHeap__ && ESP.getFreeHeap () < __minFreeHeap__)); }
+
+      void waitWhileFull (unsigned long timeOutMillis) { // listener waits here until a connection finishes or timeOutMillis passes (free heap is only checked again then)
+                                                  if (full () && !__serverStopping__ && xSemaphoreTake (__slotReleased__, pdMS_TO_TICKS (timeOutMillis)) == pdTRUE && __serverStopping__) xSemaphoreGive (__slotReleased__); // pass the wake-up on to the next listener (listenerPerCore)
+                                                }
+
+      void wakeUpListener ()                    { __serverStopping__ = true; xSemaphoreGive (__slotReleased__); } // server is stopping, listeners shouldn't wait for a free slot any longer
+
+      void countQueued ()                       { portENTER_CRITICAL (&__csAdmission__); __queuedConnections__ ++; portEXIT_CRITICAL (&__csAdmission__); } // a connection has been accepted after waiting in listen backlog
+
+      void serverFinished ()                    { // server calls this instead of delete, the instance stays alive until all the connections finish
+                                                  portENTER_CRITICAL (&__csAdmissionControls__);
+                                                    for (TcpAdmissionControl **p = &__admissionControls__; *p; p = &(*p)->__next__) if (*p == this) { *p = __next__; break; }
+                                                  portEXIT_CRITICAL (&__csAdmissionControls__);
+                                                  __releaseReference__ ();
+                                                }
+
+      int getServerPort ()                      { return __serverPort__; }
+      unsigned int getActiveConnections ()      { return __activeConnections__; }
+      unsigned long getAcceptedConnections ()   { return __acceptedConnections__; }  // connections that passed admission control
+      unsigned long getRejectedConnections ()   { return __rejectedConnections__; }  // connections that exceeded limits or couldn't be served since there was not enough memory
+      unsigned long getQueuedConnections ()     { return __queuedConnections__; }    // connections that had to wait in listen backlog before they were accepted (QUEUE overflow)
+      unsigned long getThrottledConnections ()  { return __rateLimiter__ ? __rateLimiter__->getThrottled () : 0; } // connections that exceeded per IP rate limit
+
+      void record (tcpConnectionStatistics *statistics) { // adds figures of a finished connection to server's histograms
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    if (statistics->bytesReceived) __firstByteMicros__.add (statistics->firstByteMicros);
+                                                    if (statistics->handlerMicros) __handlerMicros__.add (statistics->handlerMicros);
+                                                    __bytesPerConnection__.add (statistics->bytesReceived + statistics->bytesSent);
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                }
+
+      #define ADMISSION_STATISTICS_MAX_SERVERS 8
+
+      // statistics of all the servers that are running, formatted for telnet
+      static String statistics ()               {
+                                                  __serverStatisticsType__ stat [ADMISSION_STATISTICS_MAX_SERVERS];
+                                                  int n = __copyStatistics__ (stat);
+                                                  String s = "port    active     max   accepted   rejected     queued  throttled        rate";
+                                                  char line [120];
+                                                  char maxConnections [11];
+                                                  char rate [24];
+                                                  for (int i = 0; i < n; i++) {
+                                                    if (stat [i].maxConnections) sprintf (maxConnections, "%u", stat [i].maxConnections); else strcpy (maxConnections, "-");
+                                                    if (stat [i].ratePerSecond) sprintf (rate, "%u/s %u", stat [i].ratePerSecond, stat [i].rateBurst); else strcpy (rate, "-");
+                                                    sprintf (line, "\r\n%4i %9u %7s %10lu %10lu %10lu %10lu %11s", stat [i].port, stat [i].active, maxConnections, stat [i].accepted, stat [i].rejected, stat [i].queued, stat [i].throttled, rate);
+                                                    s += line;
+                                                  }
+                                                  s += "\r\n\r\nport  finished  first byte [us] p50 / p99   handler [us] p50 / p99         bytes p50 / p99";
+                                                  for (int i = 0; i < n; i++) {
+                                                    sprintf (line, "\r\n%4i %9lu %20lu / %-8lu%14lu / %-8lu%13lu / %lu", stat [i].port, stat [i].finished, stat [i].firstByte50, stat [i].firstByte99, stat [i].handler50, stat [i].handler99, stat [i].bytes50, stat [i].bytes99);
+                                                    s += line;
+                                                  }
+                                                  return s + "\r\n(percentiles are upper bounds of power of 2 buckets, rate is per IP connection rate limit and burst)";
+                                                }
+
+      // the same statistics in JSON format
+      static String statisticsJson ()           {
+                                                  __serverStatisticsType__ stat [ADMISSION_STATISTICS_MAX_SERVERS];
+                                                  int n = __copyStatistics__ (stat);
+                                                  String s = "[";
+                                                  char line [400];
+                                                  for (int i = 0; i < n; i++) {
+                                                    sprintf (line, "%s{\"port\":%i,\"active\":%u,\"maxConnections\":%u,\"accepted\":%lu,\"rejected\":%lu,\"queued\":%lu,\"throttled\":%lu,\"evicted\":%lu,\"finished\":%lu,"
+                                                                   "\"firstByteMicros\":{\"p50\":%lu,\"p99\":%lu},\"handlerMicros\":{\"p50\":%lu,\"p99\":%lu},\"bytes\":{\"p50\":%lu,\"p99\":%lu}}",
+                                                                   i ? "," : "", stat [i].port, stat [i].active, stat [i].maxConnections, stat [i].accepted, stat [i].rejected, stat [i].queued, stat [i].throttled, stat [i].evicted, stat [i].finished,
+                                                                   stat [i].firstByte50, stat [i].firstByte99, stat [i].handler50, stat [i].handler99, stat [i].bytes50, stat [i].bytes99);
+                                                    s += line;
+                                                  }
+                                                  return s + "]";
+                                                }
+
+    private:
+
+      int __serverPort__;
+      char __overflowReply__ [80];
+      unsigned int __maxConnections__ = 0;
+      unsigned int __maxConnectionsPerIP__ = 0;
+      unsigned long __minFreeHeap__ = 0;
+      TcpAdmissionControl::OVERFLOW_TYPE __overflow__ = TcpAdmissionControl::RESET;
+
+      portMUX_TYPE __csAdmission__ = portMUX_INITIALIZER_UNLOCKED;
+      unsigned int __activeConnections__ = 0;
+      unsigned int __references__ = 1;                                  // server + admitted connections
+      unsigned long __acceptedConnections__ = 0;
+      unsigned long __rejectedConnections__ = 0;
+      unsigned long __queuedConnections__ = 0;
+      SemaphoreHandle_t __slotReleased__;
+      volatile bool __serverStopping__ = false;                         // set by wakeUpListener ()
+      tcpHistogram __firstByteMicros__ = {};                            // of finished connections
+      tcpHistogram __handlerMicros__ = {};
+      tcpHistogram __bytesPerConnection__ = {};
+
+      struct __ipCounterType__ {
+        in_addr_t ip;
+        unsigned int connections;                                     // 0 - slot is free
+      };
+      __ipCounterType__ *__ipCounters__ = NULL;
+      unsigned int __ipSlots__ = 0;
+
+      TcpRateLimiter *__rateLimiter__ = NULL;                         // created by the first setRateLimit () and kept until the end, so listener never sees it disappear
+      bool __rateLimited__ = false;
+
+      TcpAdmissionControl *__next__ = NULL;                           // list of all TcpAdmissionControl instances of running servers
+      static TcpAdmissionControl *__admissionControls__;
+      static portMUX_TYPE __csAdmissionControls__;
+
+      ~TcpAdmissionControl ()                   {
+                                                  if (__ipCounters__) free (__ipCounters__);
+                                                  if (__rateLimiter__) delete (__rateLimiter__);
+                                                  if (__slotReleased__) vSemaphoreDelete (__slotReleased__);
+                                                }
+
+      struct __serverStatisticsType__ { int port; unsigned int active; unsigned int maxConnections; unsigned long accepted; unsigned long rejected; unsigned long queued; 
+                                        unsigned long throttled; unsigned long evicted; unsigned int ratePerSecond; unsigned int rateBurst;
+                                        unsigned long finished; unsigned long firstByte50; unsigned long firstByte99; unsigned long handler50; unsigned long handler99; unsigned long bytes50; unsigned long bytes99; };
+
+      static int __copyStatistics__ (__serverStatisticsType__ *stat) { // copies statistics of running servers in the order they were started, String can not be constructed inside critical section
+                                                  int n = 0;
+                                                  portENTER_CRITICAL (&__csAdmissionControls__);
+                                                    for (TcpAdmissionControl *p = __admissionControls__; p && n < ADMISSION_STATISTICS_MAX_SERVERS; p = p->__next__, n++) {
+                                                      portENTER_CRITICAL (&p->__csAdmission__);
+                                                        stat [n] = {p->__serverPort__, p->__activeConnections__, p->__maxConnections__, p->__acceptedConnections__, p->__rejectedConnections__, p->__queuedConnections__,
+                                                                    p->getThrottledConnections (), p->__rateLimiter__ ? p->__rateLimiter__->getEvictions () : 0,
+                                                                    p->__rateLimited__ ? p->__rateLimiter__->getConnectionsPerSecond () : 0, p->__rateLimited__ ? p->__rateLimiter__->getBurst () : 0,
+                                                                    p->__bytesPerConnection__.count, p->__firstByteMicros__.percentile (50), p->__firstByteMicros__.percentile (99), p->__handlerMicros__.percentile (50),
+                                                                    p->__handlerMicros__.percentile (99), p->__bytesPerConnection__.percentile (50), p->__bytesPerConnection__.percentile (99)};
+                                                      portEXIT_CRITICAL (&p->__csAdmission__);
+                                                    }
+                                                  portEXIT_CRITICAL (&__csAdmissionControls__);
+                                                  for (int i = 0; i < n / 2; i++) { __serverStatisticsType__ t = stat [i]; stat [i] = stat [n - 1 - i]; stat [n - 1 - i] = t; } // servers were registered at the beginning of the list
+                                                  return n;
+                                                }
+
+      void __setOverflowReply__ (const char *overflowReply) { strncpy (__overflowReply__, overflowReply, sizeof (__overflowReply__) - 1); __overflowReply__ [sizeof (__overflowReply__) - 1] = 0; }
+
+      __ipCounterType__ *__findIpCounter__ (in_addr_t ip) { // returns IP's counter or a free one, NULL if there are no free counters left (inside critical section)
+                                                  __ipCounterType__ *freeCounter = NULL;
+                                                  for (unsigned int i = 0; i < __ipSlots__; i++) {
+                                                    if (!__ipCounters__ [i].connections) { if (!freeCounter) freeCounter = &__ipCounters__ [i]; }
+                                                    else if (__ipCounters__ [i].ip == ip) return &__ipCounters__ [i];
+                                                  }
+                                                  return freeCounter;
+                                                }
+
+      void __releaseReference__ ()              {
+                                                  portENTER_CRITICAL (&__csAdmission__);
+                                                    bool lastReference = !-- __references__;
+                                                  portEXIT_CRITICAL (&__csAdmission__);
+                                                  if (lastReference) delete (this);
+                                                }
+
+  };
+
+  TcpAdmissionControl *TcpAdmissionControl::__admissionControls__ = NULL;
+  portMUX_TYPE TcpAdmissionControl::__csAdmissionControls__ = portMUX_INITIALIZER_UNLOCKED;
+
+  // TcpConnectionRegistry links together statistics of all live connections
+
+  class TcpConnectionRegistry {
+
+    public:
+
+      static void add (tcpConnectionStatistics *statistics) {
+                                                  portENTER_CRITICAL (&__csRegistry__);
+                                                    statistics->next = __connections__;
+                                                    if (statistics->next) statistics->next->pprev = &statistics->next;
+                                                    statistics->pprev = &__connections__;
+                                                    __connections__ = statistics;
+                                                    __count__ ++;
+                                                  portEXIT_CRITICAL (&__csRegistry__);
+                                                }
+
+      static void remove (tcpConnectionStatistics *statistics) {
+                                                  portENTER_CRITICAL (&__csRegistry__);
+                                                    if (statistics->pprev) {
+                                                      *statistics->pprev = statistics->next;
+                                                      if (statistics->next) statistics->next->pprev = statistics->pprev;
+                                                      statistics->pprev = NULL;
+                                                      __count__ --;
+                                                    }
+                                                  portEXIT_CRITICAL (&__csRegistry__);
+                                                }
+
+      static unsigned int count ()              { return __count__; } // the number of live connections
+
+      // live connections, formatted for telnet
+      static String netstat ()                  {
+                                                  int n;
+                                                  __connectionType__ *connections = __copyConnections__ (&n);
+                                                  if (!connections) return "Out of memory.";
+                                                  String s = "local  remote address          state          age [s]   received       sent  first byte [us]  handler [ms]";
+                                                  char line [140];
+                                                  for (int i = 0; i < n; i++) {
+                                                    __connectionType__ *c = &connections [i];
+                                                    char remote [24]; sprintf (remote, "%s:%i", c->otherSideIP, c->otherSidePort);
+                                                    char firstByte [11]; if (c->firstByteMicros) sprintf (firstByte, "%lu", c->firstByteMicros); else strcpy (firstByte, "-");
+                                                    sprintf (line, "\r\n%5i  %-21s  %-12s %9lu %10lu %10lu %16s %13lu", c->thisSidePort, remote, c->state, c->ageMillis / 1000, c->bytesReceived, c->bytesSent, firstByte, c->handlerMillis);
+                                                    s += line;
+                                                  }
+                                                  free (connections);
+                                                  return s;
+                                                }
+
+      // live connections and statistics of all the servers in JSON format
+      static String json ()                     {
+                                                  int n;
+                                                  __connectionType__ *connections = __copyConnections__ (&n);
+                                                  if (!connections) return "{\"error\":\"out of memory\"}";
+                                                  String s = "{\"connections\":[";
+                                                  char line [300];
+                                                  for (int i = 0; i < n; i++) {
+                                                    __connectionType__ *c = &connections [i];
+                                                    sprintf (line, "%s{\"localPort\":%i,\"remoteIP\":\"%s\",\"remotePort\":%i,\"state\":\"%s\",\"ageMillis\":%lu,\"bytesReceived\":%lu,\"bytesSent\":%lu,\"firstByteMicros\":%lu,\"handlerMillis\":%lu}",
+                                                                   i ? "," : "", c->thisSidePort, c->otherSideIP, c->otherSidePort, c->state, c->ageMillis, c->bytesReceived, c->bytesSent, c->firstByteMicros, c->handlerMillis);
+                                                    s += line;
+                                                  }
+                                                  free (connections);
+                                                  return s + "],\"servers\":" + TcpAdmissionControl::statisticsJson () + "}";
+                                                }
+
+    private:
+
+      struct __connectionType__ {                                   // a copy of statistics taken at the time of listing
+        char otherSideIP [16];
+        int thisSidePort;
+        int otherSidePort;
+        const char *state;
+        unsigned long ageMillis;
+        unsigned long firstByteMicros;
+        unsigned long handlerMillis;                                // including the call that is running at the moment
+        unsigned long bytesReceived;
+        unsigned long bytesSent;
+      };
+
+      static tcpConnectionStatistics *__connections__;
+      static unsigned int __count__;
+      static portMUX_TYPE __csRegistry__;
+
+      static __connectionType__ *__copyConnections__ (int *n) { // copies statistics of live connections to an array that the caller has to free
+                                                  int size = __count__ + 8; // some room for connections that arrive in the meantime, the others will be shown next time
+                                                  __connectionType__ *connections = (__connectionType__ *) malloc (size * sizeof (__connectionType__));
+                                                  if (!connections) return NULL;
+                                                  unsigned long now = millis ();
+                                                  *n = 0;
+                                                  portENTER_CRITICAL (&__csRegistry__);
+                                                    for (tcpConnectionStatistics *p = __connections__; p && *n < size; p = p->next) {
+                                                      __connectionType__ *c = &connections [(*n) ++];
+                                                      strcpy (c->otherSideIP, p->otherSideIP);
+                                                      c->thisSidePort = p->thisSidePort;
+                                                      c->otherSidePort = p->otherSidePort;
+                                                      c->state = p->state;
+                                                      c->ageMillis = now - p->acceptedMillis;
+                                                      c->firstByteMicros = p->firstByteMicros;
+                                                      c->handlerMillis = p->handlerMicros / 1000 + (p->handlerStartMillis ? now - p->handlerStartMillis : 0);
+                                                      c->bytesReceived = p->bytesReceived;
+                                                      c->bytesSent = p->bytesSent;
+                                                    }
+                                                  portEXIT_CRITICAL (&__csRegistry__);
+                                                  return connections;
+                                                }
+
+  };
+
+  tcpConnectionStatistics *TcpConnectionRegistry::__connections__ = NULL;
+  unsigned int TcpConnectionRegistry::__count__ = 0;
+  portMUX_TYPE TcpConnectionRegistry::__csRegistry__ = portMUX_INITIALIZER_UNLOCKED;
+
+  // fills in statistics of a new connection and adds them to the registry
+  void __registerConnection__ (tcpConnectionStatistics *statistics, int socket, char *otherSideIP, const char *state, tcpConnectionStatistics *continued = NULL) {
+    if (continued) { // connection continues in another object (detached from AsyncTcpServer), keep its figures
+      *statistics = *continued;
+    } else {
+      *statistics = {};
+      statistics->acceptedMillis = millis ();
+      statistics->acceptedMicros = micros ();
+      struct sockaddr_in address = {};
+      socklen_t len = sizeof (address);
+      if (getsockname (socket, (struct sockaddr *) &address, &len) != -1) statistics->thisSidePort = ntohs (address.sin_port);
+      len = sizeof (address);
+      if (getpeername (socket, (struct sockaddr *) &address, &len) != -1) statistics->otherSidePort = ntohs (address.sin_port); // client may not be connected yet
+    }
+    statistics->otherSideIP = otherSideIP;
+    statistics->state = state;
+    statistics->next = NULL;
+    statistics->pprev = NULL;
+    TcpConnectionRegistry::add (statistics);
+  }
+
+  // counts received bytes and remembers when the first one arrived
+  inline void __countReceived__ (tcpConnectionStatistics *statistics, int received) {
+    if (!statistics->bytesReceived) { statistics->firstByteMicros = __elapsedMicros__ (statistics->acceptedMillis, statistics->acceptedMicros); if (!statistics->firstByteMicros) statistics->firstByteMicros = 1; }
+    statistics->bytesReceived += received;
+  }
   
   class TcpConnection {                                             
   
@@ -121,30 +639,41 @@
                      unsigned int stackSize,                                        // stack size of a thread where connection runs - this value depends on what server really does (see connectionHandler function) should be set appropriately
                      int socket,                                                    // connection socket
                      char *otherSideIP,                                             // IP address of the other side of connection - 15 characters at most!
-                     unsigned long timeOutMillis)                                   // connection time-out in milli seconds
+                     unsigned long timeOutMillis,                                   // connection time-out in milli seconds
+                     bool *threadStarted = NULL,                                    // if not NULL it receives the information if connection thread has started - unlike started () it is safe to use after constructor returns
+                     TcpAdmissionControl *admission = NULL,                         // if not NULL the connection has been admitted by admission control and will release its slot when it finishes
+                     tcpConnectionStatistics *statistics = NULL,                    // if not NULL the connection continues these statistics (connection detached from AsyncTcpServer)
+                     BaseType_t core = tskNO_AFFINITY,                              // the core connection thread runs on, tskNO_AFFINITY lets FreeRTOS choose
+                     UBaseType_t priority = tskNORMAL_PRIORITY)                     // priority of connection thread
                                                 {             
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] threaded constructor {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
                                                   // copy constructor parameters to local structure
                                                   __connectionHandlerCallback__ = connectionHandlerCallback;
                                                   __connectionHandlerCallbackParamater__ = connectionHandlerCallbackParamater;
+                                                  __admission__ = admission;
                                                   __socket__ = socket;
                                                   strcpy (__otherSideIP__, otherSideIP);
+                                                  __registerConnection__ (&__statistics__, socket, __otherSideIP__, "accepted", statistics);
                                                   __timeOutMillis__ = timeOutMillis; 
+                                                  __armTimeOutTimer__ (); // before the thread starts, connection may finish and delete this instance immediately afterwards
 
                                                   // start connection handler thread (threaded mode)
                                                   __connectionState__ = TcpConnection::RUNNING;
                                                   if (connectionHandlerCallback) {
-                                                    #define tskNORMAL_PRIORITY 1
-                                                    if (pdPASS != xTaskCreate ( __connectionHandler__, 
+                                                    if (pdPASS != xTaskCreatePinnedToCore ( __connectionHandler__, 
                                                                                 "TcpConnection", 
                                                                                 stackSize, 
                                                                                 this, // pass "this" pointer to static member function
-                                                                                tskNORMAL_PRIORITY,
-                                                                                NULL)) {
+                                                                                priority,
+                                                                                NULL,
+                                                                                core)) {
                                                       this->__connectionState__ = TcpConnection::NOT_STARTED;
-                                                      // log_e ("[Thread:%lu][Core:%i][Socket:%i] threaded constructor: xTaskCreate () error\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
+                                                      if (threadStarted) *threadStarted = false;
+                                                      // log_e ("[Thread:%lu][Core:%i][Socket:%i] threaded constructor: xTaskCreatePinnedToCore () error\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
                                                       // TO DO: make constructor return NULL
-                                                    } 
+                                                    } else {
+                                                      if (threadStarted) *threadStarted = true; // connection thread may have already finished and deleted this instance, do not touch it any more
+                                                    }
                                                   } 
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] } threaded constructor\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
                                                 }
@@ -152,13 +681,17 @@
       // non-threaded mode constructor
       TcpConnection (int socket,                                   // connection socket
                      char *otherSideIP,                            // IP address of the other side of connection - 15 characters at most!
-                     unsigned long timeOutMillis)                  // connection time-out in milli seconds
+                     unsigned long timeOutMillis,                  // connection time-out in milli seconds
+                     TcpAdmissionControl *admission = NULL)        // if not NULL the connection has been admitted by admission control and will release its slot when it finishes
                                                 {             
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] non-threaded constructor {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
                                                   // copy constructor parameters to local structure
+                                                  __admission__ = admission;
                                                   __socket__ = socket;
                                                   strcpy (__otherSideIP__, otherSideIP);
+                                                  __registerConnection__ (&__statistics__, socket, __otherSideIP__, "open");
                                                   __timeOutMillis__ = timeOutMillis; 
+                                                  __armTimeOutTimer__ ();
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] } non-threaded constructor\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), socket);
                                                 }
                                               
@@ -168,8 +701,16 @@
                                                   // we may not use vTaskDelete here since __connectionHandlerCallback__ variables would still remain in memory which would cause memory leaks - 
                                                   // __connectionHandlerCallback__ must finish regulary by itself and clean up ist memory before returning
                                                   closeConnection (); 
+                                                  timerWheel.remove (&__timeOutTimer__); // after this time-out callback is not running and will not be called any more so it can not touch this instance
                                                   // wait for __connectionHandler__ to finish before releasing the memory occupied by this instance
                                                   while (__connectionState__ < TcpConnection::FINISHED) SPIFFSsafeDelay (1);
+                                                  if (__inputBuffer__) free (__inputBuffer__);
+                                                  if (__outputBuffer__) free (__outputBuffer__);
+                                                  TcpConnectionRegistry::remove (&__statistics__);
+                                                  if (__admission__) {
+                                                    if (!__statisticsHandedOver__ && (!__connectionHandlerCallback__ || __connectionState__ == TcpConnection::FINISHED)) __admission__->record (&__statistics__); // connection has been served (its thread has run)
+                                                    __admission__->release (__otherSideIP__);
+                                                  }
                                                   // __connectionHandler__ thread will terminate itself
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] } destructor\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__);
                                                   // Serial.printf ("~TcpConnection ()\n");
@@ -177,12 +718,10 @@
   
       virtual void closeConnection ()           {
                                                   // log_v ("[Thread:%lu][Core:%i][Socket:%i] closeConnection {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__);
-                                                  int connectionSocket;
-                                                  portENTER_CRITICAL (&csTcpConnectionInternalStructure);
-                                                    connectionSocket = __socket__;
-                                                    __socket__ = -1;
-                                                  portEXIT_CRITICAL (&csTcpConnectionInternalStructure);
-                                                  if (connectionSocket != -1) { // can not close socket inside of critical section, close it now
+                                                  flush (); // send what is left in output buffer
+                                                  int connectionSocket = __atomic_exchange_n (&__socket__, -1, __ATOMIC_SEQ_CST); // only one caller gets the socket, no lock is needed
+                                                  if (connectionSocket != -1) {
+                                                    while (__atomic_load_n (&__timeOutCallbackRunning__, __ATOMIC_SEQ_CST)); // time-out callback may be just shutting the socket down, its number must not be reused before it finishes
                                                     // if (shutdown (connectionSocket, SHUT_RD) == -1) log_e ("[Thread:%i][Core:%i][Socket:%i] closeConnection: shutdown () error %i\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__, errno);
                                                     // if (close (connectionSocket) == -1);            // log_e ("[Thread:%i][Core:%i][Socket:%i] closeConnection: close () error %i\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__, errno); 
                                                     close (connectionSocket);
@@ -193,17 +732,23 @@
       char *getThisSideIP ()                    {
                                                   // we can not get this information from constructor since connection is not necessarily established when constructor is called
                                                   // if this is a server then we are looking for server side IP, if this is a client then we are looking for client side IP
-                                                  struct sockaddr_in thisAddress = {};
-                                                  socklen_t len = sizeof (thisAddress);
-                                                  if (getsockname (__socket__, (struct sockaddr *) &thisAddress, &len) == -1) {
-                                                    // log_e ("[Thread:%lu][Core:%i][Socket:%i] getThisSideIP: getsockname () error %i\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__, errno);
-                                                    *__thisSideIP__ = 0; // return empty string rather than NULL (error handling is easier - you can sscanf () from "" but not from NULL)
-                                                  } else {
-                                                    portENTER_CRITICAL (&csTcpConnectionInternalStructure);
-                                                      if (!*__thisSideIP__) strcpy (__thisSideIP__, (char *) __inet_ntos__ (thisAddress.sin_addr).c_str ());
-                                                    portEXIT_CRITICAL (&csTcpConnectionInternalStructure);
+                                                  // the first successful call formats it, the following calls just return it
+                                                  char state = __atomic_load_n (&__thisSideIPState__, __ATOMIC_ACQUIRE);
+                                                  if (state == THIS_SIDE_IP_READY) return __thisSideIP__;
+                                                  if (state == THIS_SIDE_IP_UNKNOWN && __atomic_compare_exchange_n (&__thisSideIPState__, &state, THIS_SIDE_IP_FORMATTING, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                                                    struct sockaddr_in thisAddress = {};
+                                                    socklen_t len = sizeof (thisAddress);
+                                                    if (getsockname (__socket__, (struct sockaddr *) &thisAddress, &len) == -1) {
+                                                      // log_e ("[Thread:%lu][Core:%i][Socket:%i] getThisSideIP: getsockname () error %i\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__, errno);
+                                                      __atomic_store_n (&__thisSideIPState__, THIS_SIDE_IP_UNKNOWN, __ATOMIC_RELEASE); // __thisSideIP__ stays empty string rather than NULL (error handling is easier - you can sscanf () from "" but not from NULL)
+                                                    } else {
+                                                      strcpy (__thisSideIP__, (char *) __inet_ntos__ (thisAddress.sin_addr).c_str ());
+                                                      __atomic_store_n (&__thisSideIPState__, THIS_SIDE_IP_READY, __ATOMIC_RELEASE);
+                                                    }
+                                                    // port number can be found this way if needed: ntohs (thisAddress.sin_port);
+                                                    return __thisSideIP__;
                                                   }
-                                                  // port number can be found this way if needed: ntohs (thisAddress.sin_port);
+                                                  while (__atomic_load_n (&__thisSideIPState__, __ATOMIC_ACQUIRE) == THIS_SIDE_IP_FORMATTING); // another thread is formatting it just now, this takes only a few microseconds
                                                   return __thisSideIP__;
                                                 }
   
@@ -212,6 +757,59 @@
       virtual int recvData (char *buffer, int bufferSize)                   // returns the number of bytes actually received or 0 indicating error or closed connection
                                                 { 
                                                   // Serial.printf ("recvData (%lu, %i)\n", (unsigned long) buffer, bufferSize);
+                                                  if (__inputOffset__ < __inputLength__) { // return what is left in input buffer first
+                                                    int n = __inputLength__ - __inputOffset__ < bufferSize ? __inputLength__ - __inputOffset__ : bufferSize;
+                                                    memcpy (buffer, __inputBuffer__ + __inputOffset__, n);
+                                                    consume (n);
+                                                    return n;
+                                                  }
+                                                  return __recvData__ (buffer, bufferSize);
+                                                }
+
+      // buffered reading: data is received into input buffer (allocated at first use) in as large blocks as possible and then parsed there - recvData can be mixed with these functions
+      int peek (char **data)                    { // waits until some data is available, sets *data to point to it within input buffer and returns its length (data stays in input buffer until consume ()) or 0 indicating error or closed connection
+                                                  if (__inputOffset__ == __inputLength__ && !__fillInputBuffer__ ()) return 0;
+                                                  *data = __inputBuffer__ + __inputOffset__;
+                                                  return __inputLength__ - __inputOffset__;
+                                                }
+
+      void consume (int n)                      { // removes n bytes from the beginning of input buffer
+                                                  __inputOffset__ += n < __inputLength__ - __inputOffset__ ? n : __inputLength__ - __inputOffset__;
+                                                  if (__inputOffset__ == __inputLength__) __inputOffset__ = __inputLength__ = 0;
+                                                }
+
+      int readUntil (char *buffer, int bufferSize, const char *delimiter) { // reads data up to delimiter into buffer and terminates it with 0, delimiter is consumed but not copied, returns the length of data or -1 indicating error, closed connection or data too long to fit into buffer
+                                                  int delimiterLength = strlen (delimiter);
+                                                  int scanned = 0; // bytes (from __inputOffset__ on) already searched for delimiter, only new data is scanned after each receive
+                                                  while (true) {
+                                                    int available = __inputLength__ - __inputOffset__;
+                                                    char *p = __inputBuffer__ + __inputOffset__;
+                                                    for (int i = scanned > delimiterLength - 1 ? scanned - delimiterLength + 1 : 0; i <= available - delimiterLength; i++) {
+                                                      if (p [i] == *delimiter && !memcmp (p + i, delimiter, delimiterLength)) { // found
+                                                        if (i >= bufferSize) return -1; // doesn't fit into buffer
+                                                        memcpy (buffer, p, i);
+                                                        buffer [i] = 0;
+                                                        consume (i + delimiterLength);
+                                                        return i;
+                                                      }
+                                                    }
+                                                    scanned = available;
+                                                    if (available >= bufferSize + delimiterLength - 1) return -1; // data wouldn't fit into buffer even if delimiter arrived next
+                                                    if (!__fillInputBuffer__ ()) return -1;
+                                                  }
+                                                }
+
+      int readLine (char *buffer, int bufferSize) { // reads a line terminated by \n or \r\n, see readUntil
+                                                  int i = readUntil (buffer, bufferSize, "\n");
+                                                  if (i > 0 && buffer [i - 1] == '\r') buffer [-- i] = 0;
+                                                  return i;
+                                                }
+
+    private:
+
+      int __recvData__ (char *buffer, int bufferSize)                       // receives directly from socket, returns the number of bytes actually received or 0 indicating error or closed connection
+                                                {
+                                                  if (__outputLength__ && !flush ()) return 0; // the other side may be waiting for buffered output before it sends anything
                                                   while (true) {
                                                     if (__socket__ == -1) return 0; 
                                                     switch (int recvTotal = recv (__socket__, buffer, bufferSize, 0)) {
@@ -221,7 +819,7 @@
                                                                 #define ENAVAIL 119
                                                                 if (errno == EAGAIN || errno == ENAVAIL) {
                                                                   if ((__timeOutMillis__ == TcpConnection::INFINITE) || (millis () - __lastActiveMillis__ < __timeOutMillis__)) { // non-blocking -----
-                                                                    SPIFFSsafeDelay (1);
+                                                                    __waitForSocket__ (false); // sleep until data arrives or time-out expires
                                                                     break;
                                                                   }
                                                                 }
@@ -233,12 +831,33 @@
                                                                 return 0;
                                                       default:  
                                                                 __lastActiveMillis__ = millis ();
+                                                                __countReceived__ (&__statistics__, recvTotal);
                                                                 // log_i ("[Thread:%lu][Core:%i][Socket:%i] recvData: %i bytes\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__, recvTotal);
                                                                 return recvTotal;
                                                     }
                                                   }
                                                 }
 
+      #define TCP_INPUT_BUFFER_SIZE 256                                 // enough for command lines of telnet and FTP
+      char *__inputBuffer__ = NULL;                                     // input buffer for buffered reading, allocated at first use
+      int __inputOffset__ = 0;                                          // the beginning of data not consumed yet
+      int __inputLength__ = 0;                                          // the end of data in input buffer
+
+      bool __fillInputBuffer__ ()               { // receives as much data as fits into input buffer, returns false indicating error, closed connection or full input buffer
+                                                  if (!__inputBuffer__ && !(__inputBuffer__ = (char *) malloc (TCP_INPUT_BUFFER_SIZE))) return false;
+                                                  if (__inputOffset__) { // move unconsumed data to the beginning of input buffer
+                                                    memmove (__inputBuffer__, __inputBuffer__ + __inputOffset__, __inputLength__ - __inputOffset__);
+                                                    __inputLength__ -= __inputOffset__;
+                                                    __inputOffset__ = 0;
+                                                  }
+                                                  if (__inputLength__ == TCP_INPUT_BUFFER_SIZE) return false;
+                                                  int received = __recvData__ (__inputBuffer__ + __inputLength__, TCP_INPUT_BUFFER_SIZE - __inputLength__);
+                                                  __inputLength__ += received;
+                                                  return received > 0;
+                                                }
+
+    public:
+
       // define available data types
       enum AVAILABLE_TYPE {
         NOT_AVAILABLE = 0,  // no data is available to be read 
@@ -246,6 +865,9 @@
         ERROR = 3           // error in communication
       };
       AVAILABLE_TYPE available ()               { // checks if incoming data is pending to be read
+                                                  if (__inputOffset__ < __inputLength__) return TcpConnection::AVAILABLE; // there is still some data in input buffer
+                                                  if (__socket__ == -1) return TcpConnection::ERROR; // connection has already been closed
+                                                  if (__outputLength__ && !flush ()) return TcpConnection::ERROR; // the other side may be waiting for buffered output before it sends anything
                                                   char buffer;
                                                   if (-1 == recv (__socket__, &buffer, sizeof (buffer), MSG_PEEK)) {
                                                     #define EAGAIN 11
@@ -266,7 +888,155 @@
                                                   }
                                                 }
   
-      virtual int sendData (char *buffer, int bufferSize)                   // returns the number of bytes actually sent or 0 indicatig error or closed connection
+      virtual int sendData (char *buffer, int bufferSize)                   // returns the number of bytes actually sent (or put into output buffer) or 0 indicatig error or closed connection
+                                                {
+                                                  if (!__outputBuffer__) return __sendData__ (buffer, bufferSize);
+                                                  if (bufferSize <= __outputBufferSize__ - __outputLength__) { // fits into output buffer
+                                                    memcpy (__outputBuffer__ + __outputLength__, buffer, bufferSize);
+                                                    __outputLength__ += bufferSize;
+                                                    if (__outputLength__ == __outputBufferSize__ && !flush ()) return 0;
+                                                    return bufferSize;
+                                                  }
+                                                  // doesn't fit, send what is in output buffer together with this data in one gather write
+                                                  struct iovec iov [2] = {{__outputBuffer__, (size_t) __outputLength__}, {buffer, (size_t) bufferSize}};
+                                                  int buffered = __outputLength__;
+                                                  __outputLength__ = 0;
+                                                  int written = __sendData__ (iov, 2);
+                                                  return written > buffered ? written - buffered : 0;
+                                                }
+
+      virtual int sendData (char string [])                                 // returns the number of bytes actually sent or 0 indicatig error or closed connection
+                                                {
+                                                  return (sendData (string, strlen (string)));
+                                                }
+      virtual int sendData (String string)                                 // returns the number of bytes actually sent or 0 indicatig error or closed connection
+                                                {
+                                                  return (sendData ((char *) string.c_str (), strlen (string.c_str ())));
+                                                }
+
+      virtual int sendData (const struct iovec *iov, int iovcnt)           // sends all the buffers in one system call if possible (gather write), returns the number of bytes actually sent (or put into output buffer) or 0 indicatig error or closed connection
+                                                {
+                                                  if (__outputBuffer__) {
+                                                    size_t total = 0;
+                                                    for (int i = 0; i < iovcnt; i++) total += iov [i].iov_len;
+                                                    if (total <= (size_t) (__outputBufferSize__ - __outputLength__)) { // fits into output buffer
+                                                      for (int i = 0; i < iovcnt; i++) { memcpy (__outputBuffer__ + __outputLength__, iov [i].iov_base, iov [i].iov_len); __outputLength__ += iov [i].iov_len; }
+                                                      if (__outputLength__ == __outputBufferSize__ && !flush ()) return 0;
+                                                      return total;
+                                                    }
+                                                    if (!flush ()) return 0;
+                                                  }
+                                                  return __sendData__ (iov, iovcnt);
+                                                }
+
+      // output buffering: small sendData calls are collected in output buffer and sent together when it gets full, before receiving, when
+      // connection closes or when flush () is called - handlers that produce output in small pieces (telnet echo, multi-line replies) 
+      // this way send full TCP segments instead of one segment (and system call) per piece
+      bool setOutputBuffer (int size)           { // allocates output buffer of size bytes or releases it if size is 0 (default), returns false if there is not enough memory
+                                                  flush ();
+                                                  if (__outputBuffer__) { free (__outputBuffer__); __outputBuffer__ = NULL; }
+                                                  if (size > 0) __outputBuffer__ = (char *) malloc (size);
+                                                  __outputBufferSize__ = __outputBuffer__ ? size : 0;
+                                                  // what is flushed should go out immediately, output buffer already does what Nagle's algorithm would do and waiting for ACK only adds latency to interactive sessions
+                                                  int noDelay = __outputBuffer__ ? 1 : 0;
+                                                  if (__socket__ != -1) setsockopt (__socket__, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof (noDelay));
+                                                  return size <= 0 || __outputBuffer__;
+                                                }
+
+      bool flush ()                             { // sends whatever is waiting in output buffer, returns false indicating error or closed connection
+                                                  if (!__outputLength__) return true;
+                                                  int length = __outputLength__;
+                                                  __outputLength__ = 0; // before sending since sending may end in closeConnection which flushes as well
+                                                  return __sendData__ (__outputBuffer__, length) == length;
+                                                }
+
+      #ifndef TCP_SEND_FILE_BLOCK_SIZE
+        #define TCP_SEND_FILE_BLOCK_SIZE 4096                           // sendFile reads file in blocks of this size (and needs two of them for double buffering)
+      #endif
+
+      // sends length bytes (or the rest) of an opened file from offset on, reading it in large blocks - when there is enough memory for two blocks the next 
+      // block is read from flash while TCP is still sending the previous one, data waiting in output buffer is sent together with the first block,
+      // crlf converts line endings to \r\n (for terminals), returns the number of file bytes that have been sent
+      unsigned long sendFile (File &file, unsigned long offset = 0, unsigned long length = 0xFFFFFFFF, bool crlf = false) {
+                                                  if (offset > file.size () || !file.seek (offset)) return 0;
+                                                  if (length > file.size () - offset) length = file.size () - offset;
+                                                  char *buffer = (char *) malloc (2 * TCP_SEND_FILE_BLOCK_SIZE);
+                                                  bool doubleBuffered = buffer != NULL;
+                                                  if (!buffer && !(buffer = (char *) malloc (TCP_SEND_FILE_BLOCK_SIZE))) return 0; // not enough memory for two blocks, read and send in turns
+                                                  char *block [2] = {buffer, doubleBuffered ? buffer + TCP_SEND_FILE_BLOCK_SIZE : buffer};
+                                                  int blockLength [2];
+                                                  int fileBytes [2]; // block length differs from the number of file bytes in crlf mode
+                                                  int current = 0;
+                                                  unsigned long fileBytesSent = 0;
+                                                  blockLength [0] = __readFileBlock__ (file, block [0], &length, crlf, &fileBytes [0]);
+                                                  while (fileBytes [current] > 0) {
+                                                    int next = doubleBuffered ? 1 - current : current;
+                                                    int sent;
+                                                    if (__outputLength__) { // send what is waiting in output buffer together with the first block
+                                                      struct iovec iov [2] = {{__outputBuffer__, (size_t) __outputLength__}, {block [current], (size_t) blockLength [current]}};
+                                                      int buffered = __outputLength__;
+                                                      __outputLength__ = 0;
+                                                      if (__sendData__ (iov, 2) != buffered + blockLength [current]) break;
+                                                      sent = blockLength [current];
+                                                    } else {
+                                                      sent = __sendWithoutWaiting__ (block [current], blockLength [current]); // hand the block over to TCP, it will be sending it while the next block is being read
+                                                    }
+                                                    if (doubleBuffered) blockLength [next] = __readFileBlock__ (file, block [next], &length, crlf, &fileBytes [next]);
+                                                    if (sent < blockLength [current] && __sendData__ (block [current] + sent, blockLength [current] - sent) != blockLength [current] - sent) break; // wait until the rest of the block is sent
+                                                    fileBytesSent += fileBytes [current];
+                                                    if (!doubleBuffered) blockLength [next] = __readFileBlock__ (file, block [next], &length, crlf, &fileBytes [next]);
+                                                    current = next;
+                                                  }
+                                                  free (buffer);
+                                                  return fileBytesSent;
+                                                }
+
+    private:
+
+      #ifndef TCP_OUTPUT_BUFFER_SIZE
+        #define TCP_OUTPUT_BUFFER_SIZE 1436                             // one full TCP segment (default ESP32 lwIP MSS), used by telnet and FTP control connections
+      #endif
+      char *__outputBuffer__ = NULL;                                    // output buffer, only if set with setOutputBuffer
+      int __outputBufferSize__ = 0;
+      int __outputLength__ = 0;                                         // the end of data in output buffer
+
+      int __readFileBlock__ (File &file, char *block, unsigned long *length, bool crlf, int *fileBytes) { // reads the next block of at most *length file bytes, returns block length
+                                                  if (!crlf) {
+                                                    *fileBytes = file.read ((uint8_t *) block, *length < TCP_SEND_FILE_BLOCK_SIZE ? *length : TCP_SEND_FILE_BLOCK_SIZE);
+                                                    *length -= *fileBytes;
+                                                    return *fileBytes;
+                                                  }
+                                                  // read into the upper half of the block and convert it into the whole block, there is always room for \r before \n
+                                                  char *half = block + TCP_SEND_FILE_BLOCK_SIZE / 2;
+                                                  *fileBytes = file.read ((uint8_t *) half, *length < TCP_SEND_FILE_BLOCK_SIZE / 2 ? *length : TCP_SEND_FILE_BLOCK_SIZE / 2);
+                                                  *length -= *fileBytes;
+                                                  int blockLength = 0;
+                                                  for (int i = 0; i < *fileBytes; i++) {
+                                                    switch (half [i]) {
+                                                      case '\r':  // ignore
+                                                                  break;
+                                                      case '\n':  // crlf conversion
+                                                                  block [blockLength ++] = '\r';
+                                                                  block [blockLength ++] = '\n';
+                                                                  break;
+                                                      default:
+                                                                  block [blockLength ++] = half [i];
+                                                    }
+                                                  }
+                                                  return blockLength;
+                                                }
+
+      int __sendWithoutWaiting__ (char *buffer, int bufferSize) { // sends as much as fits into socket send buffer at the moment, returns the number of bytes sent - 0 also in case of error which __sendData__ will find out then
+                                                  int connectionSocket = __socket__;
+                                                  if (connectionSocket == -1 || !bufferSize) return 0;
+                                                  int written = send (connectionSocket, buffer, bufferSize, 0);
+                                                  if (written <= 0) return 0;
+                                                  __statistics__.bytesSent += written;
+                                                  __lastActiveMillis__ = millis ();
+                                                  return written;
+                                                }
+
+      int __sendData__ (char *buffer, int bufferSize)                       // sends directly to socket, returns the number of bytes actually sent or 0 indicatig error or closed connection
                                                 {
                                                   // Serial.printf ("sendData (%lu, %i)\n", (unsigned long) buffer, bufferSize);
                                                   int writtenTotal = 0;
@@ -281,7 +1051,7 @@
                                                                 #define ENAVAIL 119
                                                                 if (errno == EAGAIN || errno == ENAVAIL) {
                                                                   if ((__timeOutMillis__ == TcpConnection::INFINITE) || (millis () - __lastActiveMillis__ < __timeOutMillis__)) { 
-                                                                    SPIFFSsafeDelay (1);
+                                                                    __waitForSocket__ (true); // sleep until there is room in send buffer or time-out expires
                                                                     break;
                                                                   }
                                                                 }
@@ -293,6 +1063,7 @@
                                                                 return writtenTotal;
                                                       default:
                                                                 writtenTotal += written;
+                                                                __statistics__.bytesSent += written;
                                                                 buffer += written;
                                                                 bufferSize -= written;
                                                                 __lastActiveMillis__ = millis ();
@@ -303,15 +1074,51 @@
                                                   return writtenTotal;
                                                 }
 
-      virtual int sendData (char string [])                                 // returns the number of bytes actually sent or 0 indicatig error or closed connection
-                                                {
-                                                  return (sendData (string, strlen (string)));
-                                                }
-      virtual int sendData (String string)                                 // returns the number of bytes actually sent or 0 indicatig error or closed connection
+      int __sendData__ (const struct iovec *iov, int iovcnt)               // sends directly to socket, all the buffers in one system call if possible (gather write), returns the number of bytes actually sent or 0 indicatig error or closed connection
                                                 {
-                                                  return (sendData ((char *) string.c_str (), strlen (string.c_str ())));
+                                                  int writtenTotal = 0;
+                                                  #define SEND_IOVEC_MAX 8 // buffers passed to a single writev, longer arrays are sent in parts
+                                                  struct iovec part [SEND_IOVEC_MAX]; // the part that hasn't been sent yet, caller's array stays intact
+                                                  int i = 0;
+                                                  size_t sentFromCurrent = 0; // bytes of iov [i] already sent
+                                                  while (true) {
+                                                    while (i < iovcnt && sentFromCurrent == iov [i].iov_len) { i ++; sentFromCurrent = 0; } // skip what has been sent and empty buffers
+                                                    if (i == iovcnt) break;
+                                                    if (__socket__ == -1) return writtenTotal; 
+                                                    int partCount = 0;
+                                                    for (int j = i; j < iovcnt && partCount < SEND_IOVEC_MAX; j++) part [partCount ++] = iov [j];
+                                                    part [0].iov_base = (char *) part [0].iov_base + sentFromCurrent;
+                                                    part [0].iov_len -= sentFromCurrent;
+                                                    switch (int written = lwip_writev (__socket__, part, partCount)) {
+                                                      case -1:
+                                                                if (errno == EAGAIN || errno == ENAVAIL) {
+                                                                  if ((__timeOutMillis__ == TcpConnection::INFINITE) || (millis () - __lastActiveMillis__ < __timeOutMillis__)) { 
+                                                                    __waitForSocket__ (true); // sleep until there is room in send buffer or time-out expires
+                                                                    break;
+                                                                  }
+                                                                }
+                                                                // else close and continue to case 0
+                                                                __timeOut__ = true;
+                                                                closeConnection ();
+                                                      case 0:   // socket is already closed
+                                                                return writtenTotal;
+                                                      default:
+                                                                writtenTotal += written;
+                                                                __statistics__.bytesSent += written;
+                                                                __lastActiveMillis__ = millis ();
+                                                                while (written) { // advance through the buffers (partial write may end in the middle of any of them)
+                                                                  size_t n = iov [i].iov_len - sentFromCurrent;
+                                                                  if ((size_t) written < n) { sentFromCurrent += written; break; }
+                                                                  written -= n; i ++; sentFromCurrent = 0;
+                                                                }
+                                                                break;
+                                                    }
+                                                  }
+                                                  return writtenTotal;
                                                 }
                                                 
+    public:
+
       virtual bool started ()                   { return __connectionState__ == TcpConnection::RUNNING || !__connectionHandlerCallback__; } // returns true if connection thread has already started - this flag is set before the constructor returns - or if connection runs in non-threaded mode
   
       bool timeOut ()                           { return __timeOut__; } // returns true if time-out has occured
@@ -320,22 +1127,48 @@
                                                 {
                                                   __timeOutMillis__ = timeOutMillis;
                                                   __lastActiveMillis__ = millis ();
+                                                  if (__socket__ != -1) __armTimeOutTimer__ ();
                                                 } 
 
       unsigned long getTimeOut ()               { return __timeOutMillis__; } // returns time-out milliseconds
+
+      int detach (TcpAdmissionControl **admission = NULL, tcpConnectionStatistics *statistics = NULL) { // takes the socket away from the connection without closing it (see AsyncTcpServer::adopt), returns -1 if this is not possible
+                                                  if (__inputOffset__ < __inputLength__ || !flush ()) return -1; // data that has already been read from the socket (or not sent yet) would be lost
+                                                  int connectionSocket = __atomic_exchange_n (&__socket__, -1, __ATOMIC_SEQ_CST); // from now on time-out callback leaves the socket alone
+                                                  if (connectionSocket == -1) return -1;
+                                                  while (__atomic_load_n (&__timeOutCallbackRunning__, __ATOMIC_SEQ_CST)); // wait if time-out callback is just shutting the socket down
+                                                  if (__timeOut__) { close (connectionSocket); return -1; } // socket has been shut down by time-out
+                                                  if (statistics) { // the caller should pass statistics to the new owner so they continue there
+                                                    if (__statistics__.handlerStartMillis) __handlerFinished__ ();
+                                                    *statistics = __statistics__;
+                                                    __statisticsHandedOver__ = true;
+                                                  }
+                                                  if (admission) { *admission = __admission__; __admission__ = NULL; } // the caller should pass admission slot to the new owner, otherwise it is released when this instance is deleted
+                                                  return connectionSocket;
+                                                }
   
     private:
       friend class sslConnection; 
+      friend class TcpServer;
+      friend class httpServer;
     
       void (* __connectionHandlerCallback__) (TcpConnection *, void *) = NULL;  // local copy of constructor parameters
       void *__connectionHandlerCallbackParamater__ = NULL;
       int __socket__ = -1; 
       char __otherSideIP__ [16];
       unsigned long __timeOutMillis__;
+      TcpAdmissionControl *__admission__ = NULL;
 
       unsigned long __lastActiveMillis__ = millis ();                   // needed for time-out detection
       bool __timeOut__ = false;                                         // "time-out" flag      
       char __thisSideIP__ [16] = {};                                    // if this is a server socket then this is going to be a server IP, if this is a client socket then this is going to be client IP
+      enum THIS_SIDE_IP_STATE_TYPE {
+        THIS_SIDE_IP_UNKNOWN = 0,                                       // __thisSideIP__ is empty
+        THIS_SIDE_IP_FORMATTING = 1,                                    // one thread is writing into __thisSideIP__ at the moment
+        THIS_SIDE_IP_READY = 2                                          // __thisSideIP__ is valid and will not change any more
+      };
+      char __thisSideIPState__ = THIS_SIDE_IP_UNKNOWN;
+      bool __timeOutCallbackRunning__ = false;                          // time-out callback is using __socket__ so closeConnection must not close it yet
 
       enum CONNECTION_THREAD_STATE_TYPE {
         NOT_STARTED = 9,                                                // initial state
@@ -343,6 +1176,59 @@
         FINISHED = 2                                                    // connection thread has finished, instance can unload
       };
       CONNECTION_THREAD_STATE_TYPE __connectionState__ = TcpConnection::NOT_STARTED;          
+
+      timerWheelEntry __timeOutTimer__ = {};                            // connection time-out in shared timer wheel
+
+      tcpConnectionStatistics __statistics__;                           // traffic and latency of this connection, linked into TcpConnectionRegistry
+      bool __statisticsHandedOver__ = false;                            // statistics continue in AsyncTcpConnection that took the connection over
+
+      void __handlerStarted__ ()                { __statistics__.handlerStartMicros = micros (); __statistics__.handlerStartMillis = millis (); __statistics__.state = "handler"; }
+
+      void __handlerFinished__ ()               {
+                                                  if (!__statistics__.handlerStartMillis) return; // already finished when connection has been detached
+                                                  __statistics__.handlerMicros += __elapsedMicros__ (__statistics__.handlerStartMillis, __statistics__.handlerStartMicros);
+                                                  if (!__statistics__.handlerMicros) __statistics__.handlerMicros = 1; // 0 means the handler hasn't run
+                                                  __statistics__.handlerStartMillis = 0;
+                                                  __statistics__.state = "finished";
+                                                }
+
+      void __armTimeOutTimer__ ()               {
+                                                  if (__timeOutMillis__ == TcpConnection::INFINITE) timerWheel.remove (&__timeOutTimer__);
+                                                  else timerWheel.add (&__timeOutTimer__, __timeOutMillis__, __timeOutTimerCallback__, this);
+                                                }
+
+      static unsigned long __timeOutTimerCallback__ (void *parameter) { // called from timer wheel thread, activity only updates __lastActiveMillis__ so timer reschedules itself until connection is really idle
+                                                  TcpConnection *ths = (TcpConnection *) parameter;
+                                                  if (ths->__timeOutMillis__ == TcpConnection::INFINITE || ths->__socket__ == -1) return 0;
+                                                  unsigned long idleMillis = millis () - ths->__lastActiveMillis__;
+                                                  if (idleMillis < ths->__timeOutMillis__) return ths->__timeOutMillis__ - idleMillis;
+                                                  ths->__timeOut__ = true;
+                                                  // shut the socket down but leave closing it to the owner, recv () or send () blocked in connection thread returns immediately
+                                                  __atomic_store_n (&ths->__timeOutCallbackRunning__, true, __ATOMIC_SEQ_CST); // closeConnection either sees this flag or it has already taken the socket
+                                                  int connectionSocket = __atomic_load_n (&ths->__socket__, __ATOMIC_SEQ_CST);
+                                                  if (connectionSocket != -1) shutdown (connectionSocket, SHUT_RDWR);
+                                                  __atomic_store_n (&ths->__timeOutCallbackRunning__, false, __ATOMIC_SEQ_CST);
+                                                  return 0;
+                                                }
+
+      void __waitForSocket__ (bool forWriting) {                        // blocks in select () until socket is ready or time-out expires so idle connections do not use CPU or SPIFFSsemaphore
+                                                  int connectionSocket = __socket__;
+                                                  if (connectionSocket == -1) return;
+                                                  // timer wheel shuts the socket down when time-out expires, which wakes up select (), so it can wait for the whole time-out or, with no time-out, until the socket is ready
+                                                  #define CONNECTION_SELECT_TIME_OUT 1000 // ms, only used if timer wheel thread is not running and time-out has to be checked here
+                                                  unsigned long waitMillis = timerWheel.running () ? (unsigned long) -1 : CONNECTION_SELECT_TIME_OUT;
+                                                  if (__timeOutMillis__ != TcpConnection::INFINITE) {
+                                                    unsigned long idleMillis = millis () - __lastActiveMillis__;
+                                                    unsigned long millisLeft = idleMillis < __timeOutMillis__ ? __timeOutMillis__ - idleMillis + 1 : 1;
+                                                    if (millisLeft < waitMillis) waitMillis = millisLeft;
+                                                  }
+                                                  fd_set socketSet;
+                                                  FD_ZERO (&socketSet);
+                                                  FD_SET (connectionSocket, &socketSet);
+                                                  struct timeval selectTimeOut = {(time_t) (waitMillis / 1000), (suseconds_t) ((waitMillis % 1000) * 1000)};
+                                                  // the caller will try recv () or send () again and check time-out regardless of what select () returns
+                                                  select (connectionSocket + 1, forWriting ? NULL : &socketSet, forWriting ? &socketSet : NULL, NULL, waitMillis == (unsigned long) -1 ? NULL : &selectTimeOut);
+                                                }
       
       virtual void __callConnectionHandlerCallback__ () {               // calls connection handler function (just one time from another thread)
                                                           // log_i ("[Thread:%lu][Core:%i][Socket:%i] connection started\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), __socket__);
@@ -353,7 +1239,9 @@
       static void __connectionHandler__ (void *threadParameters) {                                         // envelope for connection handler callback function
                                                   TcpConnection *ths = (TcpConnection *) threadParameters; // this is how you pass "this" pointer to static memeber function
                                                   // log_v ("[Thread:%lu][Core:%i] __connectionHandler__ {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
+                                                  ths->__handlerStarted__ ();
                                                   ths->__callConnectionHandlerCallback__ ();
+                                                  ths->__handlerFinished__ ();
                                                   ths->__connectionState__ = TcpConnection::FINISHED; 
                                                   delete (ths);
                                                   // log_v ("[Thread:%lu][Core:%i] } __connectionHandler__\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
@@ -363,6 +1251,38 @@
   };
   
     
+  // TcpTaskPolicy tells a server on which cores and with what priority its tasks run. On ESP32 the WiFi stack runs on core 0 (PRO_CPU)
+  // and Arduino loop () on core 1 (APP_CPU), so tasks that float between cores compete with both of them. listenerCore is used for
+  // listener task (or AsyncTcpServer event loop), connectionCore for connection and worker pool tasks. A core is either a core number,
+  // TCP_ANY_CORE (FreeRTOS chooses, the default) or TCP_ROUND_ROBIN_CORES (each new task goes to the next core). If listenerPerCore is
+  // set threaded TcpServer runs one listener task pinned to each core, all of them accept connections from the same listening socket.
+  // Host build maps pinned tasks to pthread CPU affinity (see host/include/freertos/FreeRTOS.h), priority is only used on ESP32.
+
+  #define TCP_ANY_CORE          tskNO_AFFINITY
+  #define TCP_ROUND_ROBIN_CORES (-2)
+
+  struct TcpTaskPolicy {
+    BaseType_t listenerCore;
+    BaseType_t connectionCore;
+    UBaseType_t priority;
+    bool listenerPerCore;
+
+    TcpTaskPolicy (BaseType_t listenerCore = TCP_ANY_CORE, BaseType_t connectionCore = TCP_ANY_CORE, UBaseType_t priority = tskNORMAL_PRIORITY, bool listenerPerCore = false) {
+      this->listenerCore = listenerCore;
+      this->connectionCore = connectionCore;
+      this->priority = priority;
+      this->listenerPerCore = listenerPerCore;
+    }
+
+    BaseType_t core (BaseType_t policyCore) { // resolves TCP_ROUND_ROBIN_CORES to the core that the next task should run on
+      if (policyCore != TCP_ROUND_ROBIN_CORES) return policyCore;
+      return (BaseType_t) (__atomic_fetch_add (&__nextCore__, 1, __ATOMIC_RELAXED) % portNUM_PROCESSORS);
+    }
+
+    unsigned int __nextCore__ = 0;
+  };
+
+
   // TcpServer can be used in two different modes:
   // - threaded TcpServer starts new thread that listens for incomming connection and creates a threaded TcpConnection instance for each of them 
   //    successful listener thread creation can be tested using started () member function - result is available immediately after constructor returns
@@ -384,7 +1304,11 @@
                       unsigned long timeOutMillis,                          // connection time-out in milli seconds
                       char *serverIP,                                       // server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
                       int serverPort,                                       // server port
-                      bool (* firewallCallback) (char *)                    // a reference to callback function that will be celled when new connection arrives 
+                      bool (* firewallCallback) (char *),                   // a reference to callback function that will be celled when new connection arrives 
+                      unsigned int workerPoolSize = 0,                      // 0 - a new thread is created for each connection, > 0 - the number of pre-created worker threads that handle connections (pool mode)
+                      unsigned int workerQueueDepth = 0,                    // pool mode only: the number of accepted connections that may wait for a free worker thread, new connections are rejected when the queue is full
+                      TcpFirewall *firewall = NULL,                         // if not NULL firewall rules are checked before firewallCallback is called
+                      const TcpTaskPolicy &taskPolicy = TcpTaskPolicy ()   // cores and priority of listener, connection and worker threads
                      )                          {
                                                   // log_v ("[Thread:%lu][Core:%i] threaded constructor {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
                                                   // copy constructor parameters to local structure
@@ -395,17 +1319,23 @@
                                                   strcpy (__serverIP__, serverIP);  
                                                   __serverPort__ = serverPort;
                                                   __firewallCallback__ = firewallCallback;
+                                                  __firewall__ = firewall;
+                                                  __taskPolicy__ = taskPolicy;
+                                                  __admission__ = new TcpAdmissionControl (serverPort); // no limits until setAdmissionControl () is called, but connections are counted
+
+                                                  // start worker threads before listener so they are ready when the first connection arrives
+                                                  if (workerPoolSize) __startWorkerPool__ (workerPoolSize, workerQueueDepth);
                                                   
-                                                  // start listener thread
+                                                  // start listener thread (the first one runs on core 0 if there is a listener on each core, it starts the others when listening socket is ready)
                                                   __listenerState__ = TcpServer::NOT_RUNNING; 
-                                                  #define tskNORMAL_PRIORITY 1
-                                                  if (pdPASS != xTaskCreate (__listener__, 
+                                                  if (pdPASS != xTaskCreatePinnedToCore (__listener__, 
                                                                              "TcpListener", 
                                                                              2048, // 2 KB stack is large enough for TCP listener
                                                                              this, // pass "this" pointer to static member function
-                                                                             tskNORMAL_PRIORITY,
-                                                                             NULL)) {
-                                                    // log_e ("[Thread:%lu][Core:%i] threaded constructor: xTaskCreate () error\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ()); 
+                                                                             __taskPolicy__.priority,
+                                                                             NULL,
+                                                                             __taskPolicy__.listenerPerCore ? 0 : __taskPolicy__.core (__taskPolicy__.listenerCore))) {
+                                                    // log_e ("[Thread:%lu][Core:%i] threaded constructor: xTaskCreatePinnedToCore () error\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ()); 
                                                     // TO DO: make constructor return NULL
                                                   } 
                                                   while (__listenerState__ == TcpServer::NOT_RUNNING) SPIFFSsafeDelay (1); // listener thread has started successfully and will change listener state soon
@@ -444,7 +1374,11 @@
                                                   // log_v ("[Thread:%lu] destructor {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
                                                   if (__connection__) delete (__connection__); // close non-threaded mode connection if it has been established
                                                   __instanceUnloading__ = true; // signal __listener__ to stop
+                                                  for (unsigned int i = __atomic_load_n (&__listeners__, __ATOMIC_SEQ_CST); i; i--) __wakeUpListener__ (); // listeners are probably blocked in select () - each connection wakes up one of them (there is one per core with listenerPerCore)
+                                                  if (__admission__) __admission__->wakeUpListener (); // or they are waiting for a free slot
                                                   while (__listenerState__ < TcpServer::FINISHED) SPIFFSsafeDelay (1); // wait for __listener__ to finish before releasing the memory occupied by this instance
+                                                  if (__workerPool__) __stopWorkerPool__ (); // active connections will continue to run, the last worker thread will release the pool
+                                                  if (__admission__) __admission__->serverFinished (); // the last connection will release admission control
                                                   // log_v ("[Thread:%lu][Core:%i] } destructor\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
                                                 }
   
@@ -463,6 +1397,41 @@
                                                   } else return false;
                                                 }      
 
+      // pool mode statistics (they are all 0 if server is not running in pool mode)
+      unsigned int getWorkerPoolSize ()         { return __workerPool__ ? __workerPool__->poolSize : 0; }
+      unsigned long getRejectedConnections ()   { return __workerPool__ ? __workerPool__->rejectedConnections : 0; }  // connections rejected because the queue was full
+      unsigned long getQueuedConnections ()     { return __workerPool__ ? __workerPool__->queuedConnections : 0; }    // connections that have been passed to worker threads so far
+      unsigned long getAverageQueueWaitMicros (){                                                                       // average time connections waited in the queue for a free worker thread
+                                                  if (!__workerPool__ || !__workerPool__->queuedConnections) return 0;
+                                                  portENTER_CRITICAL (&__workerPool__->csStatistics);
+                                                    unsigned long averageQueueWaitMicros = (unsigned long) (__workerPool__->totalQueueWaitMicros / __workerPool__->queuedConnections);
+                                                  portEXIT_CRITICAL (&__workerPool__->csStatistics);
+                                                  return averageQueueWaitMicros;
+                                                }
+      unsigned long getMaxQueueWaitMicros ()    { return __workerPool__ ? __workerPool__->maxQueueWaitMicros : 0; }   // the longest time a connection waited in the queue for a free worker thread
+
+      // admission control (threaded mode only), see TcpAdmissionControl, overflowReply NULL keeps the reply that the server has already set
+      void setAdmissionControl (unsigned int maxConnections, unsigned int maxConnectionsPerIP, unsigned long minFreeHeap, TcpAdmissionControl::OVERFLOW_TYPE overflow = TcpAdmissionControl::RESET, const char *overflowReply = NULL) {
+                                                  if (__admission__) __admission__->setLimits (maxConnections, maxConnectionsPerIP, minFreeHeap, overflow, overflowReply);
+                                                }
+
+      TcpAdmissionControl *getAdmissionControl () { return __admission__; } // counters of accepted, rejected and queued connections, NULL in non-threaded mode
+
+      // per client IP connection rate limit (threaded mode only): at most burst connections at once, then connectionsPerSecond, 0 turns it off
+      void setRateLimit (unsigned int connectionsPerSecond, unsigned int burst) { if (__admission__) __admission__->setRateLimit (connectionsPerSecond, burst); }
+
+      // accept filter (threaded mode only): listener keeps a new connection (up to TCP_ACCEPT_FILTER_PENDING of them per listener) until the client
+      // sends something and only then creates a thread for it (or passes it to a worker thread), connections that stay silent for silentMillis are
+      // closed, 0 turns it off - use it only for protocols where the client speaks first (like HTTP), telnet and FTP clients wait for server greeting
+      void setAcceptFilter (unsigned long silentMillis) { if (__threadedMode__ ()) __acceptFilterMillis__ = silentMillis; }
+
+      unsigned long getAcceptFilterPassed ()    { return __acceptFilterPassed__; }  // connections that have sent something before the deadline
+      unsigned long getAcceptFilterClosed ()    { return __acceptFilterClosed__; }  // connections that stayed silent (or were closed by the client before sending anything)
+
+      TcpTaskPolicy &getTaskPolicy ()           { return __taskPolicy__; } // information from constructor
+
+      unsigned int getListenerCount ()          { return __listeners__; } // listener threads accepting connections, more than 1 only if listenerPerCore is set
+
       virtual bool started (void)               { // returns true if listener thread has already started - this flag is set before the constructor returns
                                                   while (__listenerState__ < TcpServer::ACCEPTING_CONNECTIONS) SPIFFSsafeDelay (10); // wait if listener is getting ready
                                                   return (__listenerState__ == TcpServer::ACCEPTING_CONNECTIONS); 
@@ -482,6 +1451,26 @@
       char __serverIP__ [16];
       int __serverPort__;            
       bool (* __firewallCallback__) (char *IP);                                         
+      TcpFirewall *__firewall__ = NULL;
+      TcpAdmissionControl *__admission__ = NULL;                      // threaded mode only
+      TcpTaskPolicy __taskPolicy__;
+      unsigned int __listeners__ = 0;                                 // listener threads in __acceptConnections__, the first one closes listening socket after the others finish
+      int __listenerSocket__ = -1;                                    // listening socket shared by listeners on the other cores
+
+      // accept filter: each listener keeps connections that haven't sent anything yet in its own (stack) array
+      #ifndef TCP_ACCEPT_FILTER_PENDING
+        #define TCP_ACCEPT_FILTER_PENDING 8                           // per listener, connections that arrive when it is full get their threads immediately
+      #endif
+      struct __pendingConnectionType__ {
+        int socket;
+        char clientIP [16];
+        unsigned long acceptedMillis;
+        unsigned long silentMillis;                                   // accept filter setting at the time the connection was accepted
+        bool sentData;                                                // the client has sent something while the server was full (QUEUE), it waits for a free slot
+      };
+      unsigned long __acceptFilterMillis__ = 0;                       // 0 - accept filter is off
+      unsigned long __acceptFilterPassed__ = 0;
+      unsigned long __acceptFilterClosed__ = 0;
   
       TcpConnection *__connection__ = NULL;                           // pointer to TcpConnection instance (non-threaded mode only)
       enum LISTENER_STATE_TYPE {
@@ -498,19 +1487,154 @@
       bool __timeOut__ = false;                                       // used to report time-out
 
       bool __threadedMode__ ()                  { return (__connectionHandlerCallback__ != NULL); } // returns true if server is working in threaded mode
+
+      // pool mode: a fixed number of pre-created worker threads take accepted connections from a bounded queue instead of creating a new thread for each connection
+      struct __queuedConnectionType__ {
+        int socket;                                                   // accepted connection socket, -1 tells the worker thread to finish
+        char clientIP [16];
+        unsigned long queuedMicros;                                   // when the connection was put into the queue
+      };
+      struct __workerPoolType__ {                                     // shared between TcpServer instance and worker threads since active connections may outlive TcpServer instance
+        QueueHandle_t queue;
+        unsigned int poolSize;
+        unsigned int queueDepth;
+        unsigned int runningWorkers;                                  // the last worker thread to finish releases the pool
+        void (* connectionHandlerCallback) (TcpConnection *, void *);
+        void *connectionHandlerCallbackParameter;
+        unsigned long timeOutMillis;
+        TcpAdmissionControl *admission;                               // connections in the queue have already been admitted
+        portMUX_TYPE csStatistics;
+        unsigned long queuedConnections;
+        unsigned long rejectedConnections;
+        unsigned long long totalQueueWaitMicros;
+        unsigned long maxQueueWaitMicros;
+      };
+      __workerPoolType__ *__workerPool__ = NULL;                      // NULL if server is not running in pool mode
+
+      void __startWorkerPool__ (unsigned int poolSize, unsigned int queueDepth) {
+                                                  __workerPoolType__ *pool = new __workerPoolType__;
+                                                  if (!pool) return;
+                                                  // the queue has room for queueDepth connections and for poolSize stop signals, which are sent only after the listener stops
+                                                  if (!(pool->queue = xQueueCreate (queueDepth + poolSize, sizeof (__queuedConnectionType__)))) { delete (pool); return; }
+                                                  pool->poolSize = 0;
+                                                  pool->queueDepth = queueDepth;
+                                                  pool->runningWorkers = 0;
+                                                  pool->connectionHandlerCallback = __connectionHandlerCallback__;
+                                                  pool->connectionHandlerCallbackParameter = __connectionHandlerCallbackParameter__;
+                                                  pool->timeOutMillis = __timeOutMillis__;
+                                                  pool->admission = __admission__;
+                                                  pool->csStatistics = portMUX_INITIALIZER_UNLOCKED;
+                                                  pool->queuedConnections = pool->rejectedConnections = pool->maxQueueWaitMicros = 0;
+                                                  pool->totalQueueWaitMicros = 0;
+                                                  for (unsigned int i = 0; i < poolSize; i++) {
+                                                    portENTER_CRITICAL (&pool->csStatistics);
+                                                      pool->runningWorkers ++;
+                                                    portEXIT_CRITICAL (&pool->csStatistics);
+                                                    if (pdPASS != xTaskCreatePinnedToCore (__poolWorker__, "TcpWorker", __connectionStackSize__, pool, __taskPolicy__.priority, NULL, __taskPolicy__.core (__taskPolicy__.connectionCore))) {
+                                                      portENTER_CRITICAL (&pool->csStatistics);
+                                                        pool->runningWorkers --;
+                                                      portEXIT_CRITICAL (&pool->csStatistics);
+                                                      break;
+                                                    }
+                                                    pool->poolSize ++;
+                                                  }
+                                                  if (!pool->poolSize) { // no worker thread could be started, fall back to a thread per connection
+                                                    TcpDmesg ("[TcpServer] could not start worker threads on port " + String (__serverPort__) + ", a new thread will be created for each connection.");
+                                                    vQueueDelete (pool->queue);
+                                                    delete (pool);
+                                                    return;
+                                                  }
+                                                  if (pool->poolSize < poolSize) TcpDmesg ("[TcpServer] only " + String (pool->poolSize) + " worker threads could be started on port " + String (__serverPort__) + ".");
+                                                  __workerPool__ = pool;
+                                                }
+
+      void __stopWorkerPool__ ()                {
+                                                  // listener has already stopped so there is always room in the queue for stop signals, queued connections will still be handled before them
+                                                  __queuedConnectionType__ stopSignal = {-1, "", 0};
+                                                  for (unsigned int i = 0; i < __workerPool__->poolSize; i++) xQueueSend (__workerPool__->queue, &stopSignal, portMAX_DELAY);
+                                                  __workerPool__ = NULL; // the last worker thread will delete the pool
+                                                }
+
+      bool __queueConnection__ (int connectionSocket, char *clientIP) { // passes accepted connection to a worker thread, returns false if the queue is full
+                                                  __queuedConnectionType__ queuedConnection;
+                                                  queuedConnection.socket = connectionSocket;
+                                                  strcpy (queuedConnection.clientIP, clientIP);
+                                                  queuedConnection.queuedMicros = micros ();
+                                                  if (uxQueueMessagesWaiting (__workerPool__->queue) >= __workerPool__->queueDepth || xQueueSend (__workerPool__->queue, &queuedConnection, 0) != pdTRUE) {
+                                                    portENTER_CRITICAL (&__workerPool__->csStatistics);
+                                                      __workerPool__->rejectedConnections ++;
+                                                    portEXIT_CRITICAL (&__workerPool__->csStatistics);
+                                                    return false;
+                                                  }
+                                                  return true;
+                                                }
+
+      static void __poolWorker__ (void *taskParameters) {
+                                                  __workerPoolType__ *pool = (__workerPoolType__ *) taskParameters;
+                                                  __queuedConnectionType__ queuedConnection;
+                                                  while (xQueueReceive (pool->queue, &queuedConnection, portMAX_DELAY) == pdTRUE && queuedConnection.socket != -1) {
+                                                    unsigned long queueWaitMicros = micros () - queuedConnection.queuedMicros;
+                                                    portENTER_CRITICAL (&pool->csStatistics);
+                                                      pool->queuedConnections ++;
+                                                      pool->totalQueueWaitMicros += queueWaitMicros;
+                                                      if (queueWaitMicros > pool->maxQueueWaitMicros) pool->maxQueueWaitMicros = queueWaitMicros;
+                                                    portEXIT_CRITICAL (&pool->csStatistics);
+                                                    // non-threaded TcpConnection instance on worker's stack, its destructor closes the connection
+                                                    TcpConnection connection (queuedConnection.socket, queuedConnection.clientIP, pool->timeOutMillis, pool->admission);
+                                                    connection.__handlerStarted__ ();
+                                                    pool->connectionHandlerCallback (&connection, pool->connectionHandlerCallbackParameter);
+                                                    connection.__handlerFinished__ ();
+                                                  }
+                                                  portENTER_CRITICAL (&pool->csStatistics);
+                                                    bool lastWorker = !-- pool->runningWorkers;
+                                                  portEXIT_CRITICAL (&pool->csStatistics);
+                                                  if (lastWorker) {
+                                                    vQueueDelete (pool->queue);
+                                                    delete (pool);
+                                                  }
+                                                  vTaskDelete (NULL);
+                                                }
   
       bool __callFirewallCallback__ (char *IP)  { return __firewallCallback__ ? __firewallCallback__ (IP) : true; } // calls firewall function
+
+      void __wakeUpListener__ ()                { // connects to listening socket so that __listener__ wakes up from select (), this way no additional socket is needed just for signalling
+                                                  if (__listenerState__ != TcpServer::ACCEPTING_CONNECTIONS && __listenerState__ != TcpServer::STOPPED) return; // __listener__ is not waiting in select (), listeners on the other cores may still be while it is STOPPED
+                                                  int wakeUpSocket = socket (PF_INET, SOCK_STREAM, 0);
+                                                  if (wakeUpSocket == -1) return; // __listener__ will notice __instanceUnloading__ flag after LISTENER_SELECT_TIME_OUT anyway
+                                                  struct sockaddr_in listenerAddress;
+                                                  memset (&listenerAddress, 0, sizeof (struct sockaddr_in));
+                                                  listenerAddress.sin_family = AF_INET;
+                                                  listenerAddress.sin_addr.s_addr = strcmp (__serverIP__, "0.0.0.0") ? inet_addr (__serverIP__) : inet_addr ("127.0.0.1");
+                                                  listenerAddress.sin_port = htons (__serverPort__);
+                                                  connect (wakeUpSocket, (struct sockaddr *) &listenerAddress, sizeof (listenerAddress)); // blocking connect, __listener__ has to see established connection to wake up
+                                                  close (wakeUpSocket);
+                                                }
   
+      void __rejectConnection__ (int connectionSocket, char *clientIP, bool admitted) { // sends overflow reply or resets the connection and counts it as rejected
+                                                  if (!__admission__) { close (connectionSocket); return; }
+                                                  if (admitted) __admission__->release (clientIP);
+                                                  __admission__->reject (connectionSocket);
+                                                }
+
       virtual void __newConnection__ (int connectionSocket, char *clientIP)   // creates new TcpConnection instance for connectionSocket
                                                 {         
                                                   TcpConnection *newConnection;
-                                                  if (__threadedMode__ ()) { // in threaded mode we pass connectionHandler address to TcpConnection instance
-                                                    newConnection = new TcpConnection (__connectionHandlerCallback__, __connectionHandlerCallbackParameter__, __connectionStackSize__, connectionSocket, clientIP, __timeOutMillis__);
+                                                  if (__admission__ && !__admission__->admit (clientIP)) { // limits exceeded
+                                                    __rejectConnection__ (connectionSocket, clientIP, false);
+                                                  } else if (__workerPool__) { // in pool mode one of worker threads will create TcpConnection instance
+                                                    if (!__queueConnection__ (connectionSocket, clientIP)) __rejectConnection__ (connectionSocket, clientIP, true); // all worker threads are busy and the queue is full
+                                                  } else if (__threadedMode__ ()) { // in threaded mode we pass connectionHandler address to TcpConnection instance
+                                                    bool connectionThreadStarted = false;
+                                                    newConnection = new TcpConnection (__connectionHandlerCallback__, __connectionHandlerCallbackParameter__, __connectionStackSize__, connectionSocket, clientIP, __timeOutMillis__, &connectionThreadStarted, __admission__, NULL, __taskPolicy__.core (__taskPolicy__.connectionCore), __taskPolicy__.priority);
                                                     if (newConnection) {
-                                                      if (!newConnection->started ()) {delete (newConnection);} // also closes the connection
+                                                      if (!connectionThreadStarted) { // not enough memory for connection thread - calling newConnection->started () here instead would be a race with connection thread deleting newConnection
+                                                        newConnection->__socket__ = -1; // keep the socket opened for overflow reply
+                                                        delete (newConnection); // also releases admission slot
+                                                        __rejectConnection__ (connectionSocket, clientIP, false);
+                                                      }
                                                     } else {
                                                       // log_e ("[Thread:%lu][Core:%i][Socket:%i] new () error\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket);
-                                                      close (connectionSocket); // close the connection 
+                                                      __rejectConnection__ (connectionSocket, clientIP, true);
                                                     }
                                                   } else { // in non-threaded mode create non-threaded TcpConnection instance
                                                      newConnection = new TcpConnection (connectionSocket, clientIP, __timeOutMillis__);
@@ -518,6 +1642,121 @@
                                                   }
                                                 } 
 
+      void __acceptConnections__ (int listenerSocket) { // accepts connections until instance starts unloading, non-threaded server returns after the first connection or time-out
+                                                  bool backlogWaiting = false; // connections may have been waiting in listen backlog while the server was full
+                                                  __pendingConnectionType__ pending [TCP_ACCEPT_FILTER_PENDING]; // accept filter: connections waiting for the first data
+                                                  int pendingCount = 0;
+                                                  while (!__instanceUnloading__) { // handle incomming connections
+                                                    // block in select () until a connection arrives, instance starts unloading (__wakeUpListener__) or time-out occurs - this consumes no CPU while waiting
+                                                    #define LISTENER_SELECT_TIME_OUT 1000 // ms, just a safety net in case __wakeUpListener__ () couldn't connect
+                                                    bool full = __admission__ && __admission__->full (); // QUEUE overflow - leave new connections in listen backlog until a connection finishes
+                                                    unsigned long waitMillis = backlogWaiting && !full ? 0 : LISTENER_SELECT_TIME_OUT; // just check what is already waiting in the backlog first
+                                                    if (!__threadedMode__ ()) { // checing time-out makes sense only when working as non-threaded TCP server
+                                                      if (timeOut ()) return;
+                                                      if (__timeOutMillis__ != TcpConnection::INFINITE) {
+                                                        unsigned long millisLeft = __timeOutMillis__ - (millis () - __lastActiveMillis__) + 1;
+                                                        if (millisLeft < waitMillis) waitMillis = millisLeft;
+                                                      }
+                                                    }
+                                                    fd_set readSet;
+                                                    FD_ZERO (&readSet);
+                                                    if (!full) FD_SET (listenerSocket, &readSet);
+                                                    int maxSocket = listenerSocket;
+                                                    for (int i = 0; i < pendingCount; ) { // wait for data on pending connections too, close those that have been silent for too long
+                                                      unsigned long pendingMillis = millis () - pending [i].acceptedMillis;
+                                                      if (!pending [i].sentData && pendingMillis >= pending [i].silentMillis) {
+                                                        char c;
+                                                        if (recv (pending [i].socket, &c, 1, MSG_PEEK) > 0) { // it has sent something while the server was full, keep it until there is a free slot
+                                                          pending [i].sentData = true;
+                                                        } else {
+                                                          close (pending [i].socket);
+                                                          __atomic_add_fetch (&__acceptFilterClosed__, 1, __ATOMIC_RELAXED);
+                                                          pending [i] = pending [-- pendingCount];
+                                                          continue;
+                                                        }
+                                                      }
+                                                      if (!pending [i].sentData && pending [i].silentMillis - pendingMillis < waitMillis) waitMillis = pending [i].silentMillis - pendingMillis;
+                                                      if (!full) { // while the server is full pending connections couldn't get their threads anyway
+                                                        FD_SET (pending [i].socket, &readSet);
+                                                        if (pending [i].socket > maxSocket) maxSocket = pending [i].socket;
+                                                      }
+                                                      i ++;
+                                                    }
+                                                    if (full) { // wait until a connection finishes or it is time to check pending connections again
+                                                      __admission__->waitWhileFull (waitMillis);
+                                                      backlogWaiting = true;
+                                                      continue;
+                                                    }
+                                                    struct timeval selectTimeOut = {(time_t) (waitMillis / 1000), (suseconds_t) ((waitMillis % 1000) * 1000)};
+                                                    if (select (maxSocket + 1, &readSet, NULL, NULL, &selectTimeOut) <= 0) { backlogWaiting = false; continue; } // time-out or error - check if instance is unloading and try again
+                                                    if (__instanceUnloading__) break; // it was __wakeUpListener__ () who connected, not a client
+                                                    for (int i = 0; i < pendingCount; ) { // pending connections that have sent something get their threads now
+                                                      if (!FD_ISSET (pending [i].socket, &readSet)) { i ++; continue; }
+                                                      char c;
+                                                      if (recv (pending [i].socket, &c, 1, MSG_PEEK) > 0) {
+                                                        __atomic_add_fetch (&__acceptFilterPassed__, 1, __ATOMIC_RELAXED);
+                                                        __newConnection__ (pending [i].socket, pending [i].clientIP);
+                                                      } else { // the client has closed the connection without sending anything
+                                                        close (pending [i].socket);
+                                                        __atomic_add_fetch (&__acceptFilterClosed__, 1, __ATOMIC_RELAXED);
+                                                      }
+                                                      pending [i] = pending [-- pendingCount];
+                                                    }
+                                                    if (!FD_ISSET (listenerSocket, &readSet)) continue; // no new connection
+                                                    // accept new connection
+                                                    int connectionSocket;
+                                                    struct sockaddr_in connectingAddress;
+                                                    socklen_t connectingAddressSize = sizeof (connectingAddress);
+                                                    connectionSocket = accept (listenerSocket, (struct sockaddr *) &connectingAddress, &connectingAddressSize);
+                                                    if (connectionSocket != -1) { // non-blocking socket returns -1 if connection has already been reset before we got to accept it
+                                                      if (__firewall__ && !__firewall__->allows (connectingAddress.sin_addr.s_addr)) { // check raw address first, rejecting the connection costs no heap
+                                                        close (connectionSocket);
+                                                        continue;
+                                                      }
+                                                      if (__admission__ && !__admission__->withinRateLimit (connectingAddress.sin_addr.s_addr)) { // the client is connecting too fast
+                                                        __admission__->throttle (connectionSocket);
+                                                        continue;
+                                                      }
+                                                      char clientIP [16];
+                                                      inet_ntoa_r (connectingAddress.sin_addr, clientIP, sizeof (clientIP));
+                                                      // log_i ("[Thread:%lu][Core:%i][Socket:%i] __listener__: new connection from %s\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, clientIP); 
+                                                      if (!__callFirewallCallback__ (clientIP)) {
+                                                        close (connectionSocket);
+                                                        // log_e ("[Thread:%lu][Core:%i][Socket:%i] __listener__: %s was rejected by firewall\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, clientIP);
+                                                        continue;
+                                                      } else {
+                                                        // log_i ("[Thread:%lu][Core:%i][Socket:%i] __listener__: firewall let %s through\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, clientIP);
+                                                      }
+                                                      if (fcntl (connectionSocket, F_SETFL, O_NONBLOCK) == -1) {
+                                                        // log_e ("[Thread:%lu][Core:%i][Socket:%i] __listener__: connection socket fcntl () error %i\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, errno);
+                                                        close (connectionSocket);
+                                                        continue;
+                                                      }
+                                                      if (backlogWaiting && __admission__) __admission__->countQueued ();
+                                                      unsigned long silentMillis = __acceptFilterMillis__;
+                                                      if (silentMillis && pendingCount < TCP_ACCEPT_FILTER_PENDING) { // accept filter: wait until the client sends something
+                                                        pending [pendingCount].socket = connectionSocket;
+                                                        strcpy (pending [pendingCount].clientIP, clientIP);
+                                                        pending [pendingCount].acceptedMillis = millis ();
+                                                        pending [pendingCount].silentMillis = silentMillis;
+                                                        pending [pendingCount].sentData = false;
+                                                        pendingCount ++;
+                                                        continue;
+                                                      }
+                                                      __newConnection__ (connectionSocket, clientIP);
+                                                      if (!__threadedMode__ ()) return; // in non-threaded mode server only accepts one connection
+                                                    } // new connection
+                                                  } // handle incomming connections
+                                                  while (pendingCount) close (pending [-- pendingCount].socket); // instance is unloading
+                                                }
+
+      static void __additionalListener__ (void *taskParameters) {                              // listener on another core (listenerPerCore), shares listening socket with __listener__
+                                                TcpServer *ths = (TcpServer *) taskParameters;
+                                                ths->__acceptConnections__ (ths->__listenerSocket__);
+                                                __atomic_sub_fetch (&ths->__listeners__, 1, __ATOMIC_SEQ_CST);
+                                                vTaskDelete (NULL);
+                                              }
+
       static void __listener__ (void *taskParameters) {                                        // listener running in its own thread imlemented as static memeber function
                                                 TcpServer *ths = (TcpServer *) taskParameters; // this is how you pass "this" pointer to static memeber function
                                                 // log_v ("[Thread:%lu][Core:%i] __listener__ {\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
@@ -567,38 +1806,25 @@
                                                   }
                                                   // log_i ("[Thread:%lu][Core:%i] __listener__: started accepting connections on %s : %i\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), ths->getServerIP (), ths->getServerPort ());
 
-                                                  while (!ths->__instanceUnloading__) { // handle incomming connections
-                                                    SPIFFSsafeDelay (1);
-                                                    if (!ths->__threadedMode__ ()) { // checing time-out makes sense only when working as non-threaded TCP server
-                                                      if (ths->timeOut ()) goto terminateListener;
-                                                    }
-                                                    // accept new connection
-                                                    ths->__listenerState__ = TcpServer::ACCEPTING_CONNECTIONS;
-                                                    int connectionSocket;
-                                                    struct sockaddr_in connectingAddress;
-                                                    socklen_t connectingAddressSize = sizeof (connectingAddress);
-                                                    connectionSocket = accept (listenerSocket, (struct sockaddr *) &connectingAddress, &connectingAddressSize);
-                                                    if (connectionSocket != -1) { // non-blocking socket keeps returning -1 until new connection arrives
-                                                      // log_i ("[Thread:%lu][Core:%i][Socket:%i] __listener__: new connection from %s\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, (char *) __inet_ntos__ (connectingAddress.sin_addr).c_str ()); 
-                                                      if (!ths->__callFirewallCallback__ ((char *) __inet_ntos__ (connectingAddress.sin_addr).c_str ())) {
-                                                        close (connectionSocket);
-                                                        // log_e ("[Thread:%lu][Core:%i][Socket:%i] __listener__: %s was rejected by firewall\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, (char *) __inet_ntos__ (connectingAddress.sin_addr).c_str ());
-                                                        continue;
-                                                      } else {
-                                                        // log_i ("[Thread:%lu][Core:%i][Socket:%i] __listener__: firewall let %s through\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, (char *) __inet_ntos__ (connectingAddress.sin_addr).c_str ());
-                                                      }
-                                                      if (fcntl (connectionSocket, F_SETFL, O_NONBLOCK) == -1) {
-                                                        // log_e ("[Thread:%lu][Core:%i][Socket:%i] __listener__: connection socket fcntl () error %i\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), connectionSocket, errno);
-                                                        close (connectionSocket);
-                                                        continue;
+                                                  ths->__listeners__ = 1;
+                                                  ths->__listenerState__ = TcpServer::ACCEPTING_CONNECTIONS;
+                                                  if (ths->__taskPolicy__.listenerPerCore && ths->__threadedMode__ ()) { // start listeners on the other cores, they share listening socket
+                                                    ths->__listenerSocket__ = listenerSocket;
+                                                    for (BaseType_t core = 1; core < portNUM_PROCESSORS; core++) {
+                                                      __atomic_add_fetch (&ths->__listeners__, 1, __ATOMIC_SEQ_CST);
+                                                      if (pdPASS != xTaskCreatePinnedToCore (__additionalListener__, "TcpListener", 2048, ths, ths->__taskPolicy__.priority, NULL, core)) {
+                                                        __atomic_sub_fetch (&ths->__listeners__, 1, __ATOMIC_SEQ_CST);
+                                                        TcpDmesg ("[TcpServer] could not start listener on core " + String (core) + " for port " + String (ths->getServerPort ()) + ".");
                                                       }
-                                                      ths->__newConnection__ (connectionSocket, (char *) __inet_ntos__ (connectingAddress.sin_addr).c_str ());
-                                                      if (!ths->__threadedMode__ ()) goto terminateListener; // in non-threaded mode server only accepts one connection
-                                                    } // new connection
-                                                  } // handle incomming connections
+                                                    }
+                                                  }
+                                                  ths->__acceptConnections__ (listenerSocket);
+                                                  break; // unloading or non-threaded server has got its connection (or time-out)
                                                 } // prepare listener socket
 terminateListener:
                                                 ths->__listenerState__ = TcpServer::STOPPED;
+                                                if (ths->__listeners__) __atomic_sub_fetch (&ths->__listeners__, 1, __ATOMIC_SEQ_CST);
+                                                while (__atomic_load_n (&ths->__listeners__, __ATOMIC_SEQ_CST)) SPIFFSsafeDelay (1); // wait for listeners on the other cores before closing shared listening socket
                                                 close (listenerSocket);
                                                 // log_v ("[Thread:%lu][Core:%i] } __listener__\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
                                                 ths->__listenerState__ = TcpServer::FINISHED;
@@ -0,0 +1,215 @@
+/*
+ * TimerWheel.hpp
+ *
+ *  This file is part of Esp32_web_ftp_telnet_server_template project: https://github.com/BojanJurca/Esp32_web_ftp_telnet_server_template
+ *
+ *  TimerWheel.hpp contains a hierarchical timer wheel shared by all the servers. Timers are added, refreshed and removed
+ *  in constant time regardless of how many of them there are, a single thread calls callback functions of expired timers.
+ *  The thread only runs (every TIMER_WHEEL_TICK milliseconds) while there are some timers in the wheel.
+ *
+ *  Three levels of 64 slots cover 64 ticks (6.4 s), 64 * 64 ticks (almost 7 min) and 64 * 64 * 64 ticks (more than 7 h),
+ *  timers that expire even later wait in the last slot and get rescheduled when it comes to them.
+ *
+ *  A callback function returns the number of milliseconds after which it wants to be called again or 0 if the timer
+ *  is finished. This way the owner of a timer that is refreshed very often (like connection time-out) doesn't have to
+ *  touch the wheel at all - the callback function checks when the owner was last active and reschedules itself.
+ *
+ *  Callback functions are called from timer wheel thread so they must be short and must never block.
+ *
+ * History:
+ *          - first release,
+ *            October 16, 2026
+ *          - added running ()
+ *            October 16, 2026
+ *          - callers of add () wait until timer wheel thread has been started
+ *            October 16, 2026
+ */
+
+
+#ifndef __TIMER_WHEEL__
+  #define __TIMER_WHEEL__
+
+  #define TIMER_WHEEL_TICK 100          // ms, timer wheel resolution
+  #define TIMER_WHEEL_SLOTS 64          // slots per level, must be a power of 2
+  #define TIMER_WHEEL_SLOT_BITS 6       // log2 (TIMER_WHEEL_SLOTS)
+  #define TIMER_WHEEL_LEVELS 3
+
+
+  struct timerWheelEntry {                                          // owner of the timer keeps this structure, timer wheel only links it into its slots
+    timerWheelEntry *next;
+    timerWheelEntry **pprev;                                        // points to previous entry's next (or slot's head) so entry can be unlinked without knowing the slot
+    unsigned long expiresTick;
+    unsigned long (* callback) (void *);                            // returns milliseconds to the next call or 0
+    void *parameter;
+    bool scheduled;
+  };
+
+
+  class TimerWheel {
+
+    public:
+
+      // adds the timer or reschedules it if it is already in the wheel
+      void add (timerWheelEntry *entry, unsigned long millisFromNow, unsigned long (* callback) (void *), void *parameter) {
+                                                  if (!__threadStarted__) __startThread__ ();
+                                                  portENTER_CRITICAL (&__csTimerWheel__);
+                                                    if (entry->scheduled) { __unlink__ (entry); __count__ --; }
+                                                    if (!__count__ && !__ticking__) __catchUp__ (); // wheel has been idle, move it to current time
+                                                    entry->callback = callback;
+                                                    entry->parameter = parameter;
+                                                    entry->expiresTick = __currentTick__ + (millisFromNow + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+                                                    if (entry->expiresTick == __currentTick__) entry->expiresTick ++;
+                                                    __insert__ (entry);
+                                                    bool wasIdle = !__count__ ++;
+                                                  portEXIT_CRITICAL (&__csTimerWheel__);
+                                                  if (wasIdle && __threadRunning__) xSemaphoreGive (__wakeUpSemaphore__); // timer wheel thread is waiting for the first timer
+                                                }
+
+      // removes the timer, if its callback function is running at the moment it waits until it returns so the owner can safely release the entry afterwards
+      void remove (timerWheelEntry *entry) {
+                                                  while (true) {
+                                                    portENTER_CRITICAL (&__csTimerWheel__);
+                                                      if (entry->scheduled) { __unlink__ (entry); __count__ --; }
+                                                      bool firing = (__firingEntry__ == entry);
+                                                    portEXIT_CRITICAL (&__csTimerWheel__);
+                                                    if (!firing) return;
+                                                    SPIFFSsafeDelay (1);
+                                                  }
+                                                }
+
+      unsigned int count ()                     { return __count__; } // number of timers in the wheel
+
+      bool running ()                           { return __threadRunning__; } // false if timer wheel thread couldn't be started, owners of the timers have to check them themselves then
+
+    private:
+
+      portMUX_TYPE __csTimerWheel__ = portMUX_INITIALIZER_UNLOCKED;
+      timerWheelEntry *__slots__ [TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS] = {};
+      unsigned long __currentTick__ = 0;                            // the last tick that has been processed
+      unsigned long __lastTickMillis__ = 0;                         // millis () of __currentTick__
+      unsigned int __count__ = 0;
+      timerWheelEntry *__firingEntry__ = NULL;                      // the entry whose callback function is running at the moment
+      SemaphoreHandle_t __wakeUpSemaphore__ = NULL;
+      bool __threadStarting__ = false;                              // some thread has already taken care of starting timer wheel thread
+      volatile bool __threadStarted__ = false;                      // starting has finished, __wakeUpSemaphore__ and __threadRunning__ are valid from now on
+      volatile bool __threadRunning__ = false;                      // timer wheel thread has been created successfully
+      bool __ticking__ = false;                                     // timer wheel thread is processing ticks
+
+      void __startThread__ ()                   {
+                                                  static portMUX_TYPE csStartThread = portMUX_INITIALIZER_UNLOCKED;
+                                                  bool startThread = false;
+                                                  portENTER_CRITICAL (&csStartThread);
+                                                    if (!__threadStarting__) startThread = __threadStarting__ = true;
+                                                  portEXIT_CRITICAL (&csStartThread);
+                                                  if (!startThread) { // wait until the other caller finishes starting the thread
+                                                    while (!__threadStarted__) SPIFFSsafeDelay (1);
+                                                    return;
+                                                  }
+                                                  __lastTickMillis__ = millis ();
+                                                  __wakeUpSemaphore__ = xSemaphoreCreateBinary ();
+                                                  #define tskNORMAL_PRIORITY 1
+                                                  if (!__wakeUpSemaphore__ || pdPASS != xTaskCreate (__timerWheelThread__, "TimerWheel", 2048, this, tskNORMAL_PRIORITY, NULL)) {
+                                                    TcpDmesg ("[TimerWheel] could not start timer wheel thread, time-outs will only be detected by connections themselves.");
+                                                  } else {
+                                                    __threadRunning__ = true;
+                                                  }
+                                                  __threadStarted__ = true;
+                                                }
+
+      void __catchUp__ ()                       { // moves an empty wheel to current time (inside critical section)
+                                                  unsigned long ticks = (millis () - __lastTickMillis__) / TIMER_WHEEL_TICK;
+                                                  __currentTick__ += ticks;
+                                                  __lastTickMillis__ += ticks * TIMER_WHEEL_TICK;
+                                                }
+
+      void __unlink__ (timerWheelEntry *entry) { // (inside critical section)
+                                                  *entry->pprev = entry->next;
+                                                  if (entry->next) entry->next->pprev = entry->pprev;
+                                                  entry->scheduled = false;
+                                                }
+
+      void __insert__ (timerWheelEntry *entry) { // puts the entry in the right slot (inside critical section)
+                                                  unsigned long ticksLeft = entry->expiresTick - __currentTick__;
+                                                  timerWheelEntry **slot;
+                                                  if (ticksLeft < TIMER_WHEEL_SLOTS) {
+                                                    slot = &__slots__ [0][entry->expiresTick & (TIMER_WHEEL_SLOTS - 1)];
+                                                  } else if (ticksLeft < TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS) {
+                                                    slot = &__slots__ [1][(entry->expiresTick >> TIMER_WHEEL_SLOT_BITS) & (TIMER_WHEEL_SLOTS - 1)];
+                                                  } else if (ticksLeft < TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS * TIMER_WHEEL_SLOTS) {
+                                                    slot = &__slots__ [2][(entry->expiresTick >> (2 * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1)];
+                                                  } else { // too far away, wait in the last slot and get rescheduled later
+                                                    slot = &__slots__ [2][((__currentTick__ >> (2 * TIMER_WHEEL_SLOT_BITS)) - 1) & (TIMER_WHEEL_SLOTS - 1)];
+                                                  }
+                                                  entry->next = *slot;
+                                                  if (entry->next) entry->next->pprev = &entry->next;
+                                                  entry->pprev = slot;
+                                                  *slot = entry;
+                                                  entry->scheduled = true;
+                                                }
+
+      void __cascade__ (int level, int slot)    { // reinserts all the entries of a higher level slot into lower levels (inside critical section)
+                                                  timerWheelEntry *entry = __slots__ [level][slot];
+                                                  __slots__ [level][slot] = NULL;
+                                                  while (entry) {
+                                                    timerWheelEntry *next = entry->next;
+                                                    __insert__ (entry);
+                                                    entry = next;
+                                                  }
+                                                }
+
+      void __tick__ ()                          { // processes all the ticks up to current time
+                                                  while (true) {
+                                                    portENTER_CRITICAL (&__csTimerWheel__);
+                                                      if (millis () - __lastTickMillis__ < TIMER_WHEEL_TICK) {
+                                                        __ticking__ = false;
+                                                        portEXIT_CRITICAL (&__csTimerWheel__);
+                                                        return;
+                                                      }
+                                                      __ticking__ = true;
+                                                      __lastTickMillis__ += TIMER_WHEEL_TICK;
+                                                      unsigned long tick = ++ __currentTick__;
+                                                      if (!(tick & (TIMER_WHEEL_SLOTS - 1))) {
+                                                        if (!((tick >> TIMER_WHEEL_SLOT_BITS) & (TIMER_WHEEL_SLOTS - 1))) __cascade__ (2, (tick >> (2 * TIMER_WHEEL_SLOT_BITS)) & (TIMER_WHEEL_SLOTS - 1));
+                                                        __cascade__ (1, (tick >> TIMER_WHEEL_SLOT_BITS) & (TIMER_WHEEL_SLOTS - 1));
+                                                      }
+                                                    portEXIT_CRITICAL (&__csTimerWheel__);
+                                                    // call callback functions of expired entries one by one
+                                                    while (true) {
+                                                      portENTER_CRITICAL (&__csTimerWheel__);
+                                                        timerWheelEntry *entry = __slots__ [0][tick & (TIMER_WHEEL_SLOTS - 1)];
+                                                        while (entry && (long) (tick - entry->expiresTick) < 0) entry = entry->next; // just in case, never fire an entry before its time
+                                                        if (entry) {
+                                                          __unlink__ (entry);
+                                                          __count__ --;
+                                                          __firingEntry__ = entry;
+                                                        }
+                                                      portEXIT_CRITICAL (&__csTimerWheel__);
+                                                      if (!entry) break;
+                                                      unsigned long millisToNextCall = entry->callback (entry->parameter);
+                                                      portENTER_CRITICAL (&__csTimerWheel__);
+                                                        if (millisToNextCall && !entry->scheduled) { // reschedule
+                                                          entry->expiresTick = tick + (millisToNextCall + TIMER_WHEEL_TICK - 1) / TIMER_WHEEL_TICK;
+                                                          if (entry->expiresTick == tick) entry->expiresTick ++;
+                                                          __insert__ (entry);
+                                                          __count__ ++;
+                                                        }
+                                                        __firingEntry__ = NULL;
+                                                      portEXIT_CRITICAL (&__csTimerWheel__);
+                                                    }
+                                                  }
+                                                }
+
+      static void __timerWheelThread__ (void *taskParameters) {
+                                                  TimerWheel *ths = (TimerWheel *) taskParameters; // this is how you pass "this" pointer to static memeber function
+                                                  while (true) {
+                                                    // sleep until the first timer is added if the wheel is empty, otherwise until the next tick
+                                                    xSemaphoreTake (ths->__wakeUpSemaphore__, ths->__count__ ? pdMS_TO_TICKS (TIMER_WHEEL_TICK) : portMAX_DELAY);
+                                                    if (ths->__count__) ths->__tick__ ();
+                                                  }
+                                                }
+
+  };
+
+  TimerWheel timerWheel;                                            // timer wheel shared by all the servers
+
+#endif
@@ -15,6 +15,8 @@
  *            September 8, Bojan Jurca
  *          - elimination of compiler warnings and some bugs
  *            Jun 10, 2020, Bojan Jurca
+ *          - added fileSystemChanged notification for modules that keep file contents in memory
+ *            October 16, 2026
  *  
  */
 
@@ -38,6 +40,9 @@
   }
   void (* fileSystemDmesg) (String) = __fileSystemDmesg__; // use this pointer to display / record system messages
 
+  void (* fileSystemChanged) (const char *) = NULL; // if set, it is called with SPIFFSsemaphore taken after a file has been written or deleted (NULL for all files after formatting), httpServer uses it to invalidate its file cache
+  void notifyFileSystemChanged (const char *fileName) { if (fileSystemChanged) fileSystemChanged (fileName); }
+
   bool __fileSystemMounted__ = false;
 
 
@@ -83,6 +88,7 @@
         return false;                
       } else {
         file.close ();
+        notifyFileSystemChanged (fileName);
         return true;        
       }
     }
@@ -23,6 +23,20 @@
  *            October 29, 2019, Bojan Jurca
  *          - elimination of compiler warnings and some bugs
  *            Jun 10, 2020, Bojan Jurca 
+ *          - commands are read with TcpConnection::readUntil
+ *            October 16, 2026
+ *          - connections over admission control limits get "421" reply
+ *            October 16, 2026
+ *          - added optional TcpFirewall constructor parameter
+ *            October 16, 2026
+ *          - control connection uses output buffer
+ *            October 16, 2026
+ *          - RETR sends file with TcpConnection::sendFile
+ *            October 16, 2026
+ *          - added optional TcpTaskPolicy constructor parameter
+ *            October 16, 2026
+ *          - STOR and XRMD call notifyFileSystemChanged so that httpServer file cache forgets changed files
+ *            October 16, 2026
  *  
  */
 
@@ -70,10 +84,13 @@
   
       ftpServer (char *serverIP,                                       // FTP server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
                  int serverPort,                                       // FTP server port
-                 bool (* firewallCallback) (char *)                    // a reference to callback function that will be celled when new connection arrives 
-                ): TcpServer (__ftpConnectionHandler__, NULL, 8192, 300000, serverIP, serverPort, firewallCallback)
+                 bool (* firewallCallback) (char *),                   // a reference to callback function that will be celled when new connection arrives 
+                 TcpFirewall *firewall = NULL,                         // firewall rules that are checked before firewallCallback is called or NULL
+                 const TcpTaskPolicy &taskPolicy = TcpTaskPolicy ()   // cores and priority of listener and control connection threads
+                ): TcpServer (__ftpConnectionHandler__, NULL, 8192, 300000, serverIP, serverPort, firewallCallback, 0, 0, firewall, taskPolicy)
                                                 {
-                                                  if (started ()) ftpDmesg ("[ftpServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback ? " with firewall." : "."));
+                                                  setAdmissionControl (0, 0, 0, TcpAdmissionControl::REPLY, "421 too many connections, try again later\r\n"); // no limits by default, 421 is sent if there is no memory left for connection thread
+                                                  if (started ()) ftpDmesg ("[ftpServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback || firewall ? " with firewall." : "."));
                                                   else            ftpDmesg ("[ftpServer] couldn't start.");
                                                 }
       
@@ -90,6 +107,7 @@
         bool loggedIn = false;              // "logged in" flag
         char homeDir [33]; *homeDir = 0;    // store home directory of the user that has logged in here
         char fileName [33];                 // define once here, will be used in several places of this function latter
+        connection->setOutputBuffer (TCP_OUTPUT_BUFFER_SIZE); // multi-line replies are sent in one segment, replies are flushed when the next command is read
         File file;                          // define once here, will be used in several places of this function latter
 
         if (!__fileSystemMounted__) {
@@ -105,16 +123,12 @@
         #endif  
         
         while (true) { // read and process incomming commands in an endless loop
-          int receivedTotal = 0;
           #define ftpCmd buffer
           char *endOfCmd;
           char *ftpParam;
-          do {
-            int received;
-            buffer [receivedTotal += (received = connection->recvData (buffer + receivedTotal, sizeof (buffer) - receivedTotal - 1))] = 0; // read incomming characters and mark the end with 0
-            if (!received) goto closeFtpConnection;
-          } while (!(endOfCmd = strstr (buffer, "\r\n")));
-          *endOfCmd = 0; // mark the end of received command
+          int cmdLength = connection->readUntil (buffer, sizeof (buffer), "\r\n"); // read the command without \r\n, the data after it stays buffered for the next command
+          if (cmdLength < 0) goto closeFtpConnection;
+          endOfCmd = buffer + cmdLength; // the end of received command is already marked with 0
           // log_v ("[Thread:%lu][Core:%i] new command = %s\n", (unsigned long) xTaskGetCurrentTaskHandle (), xPortGetCoreID (), buffer);
           if ((ftpParam = strstr (buffer, " "))) *ftpParam++ = 0; else ftpParam = endOfCmd; // mark the end of command and the beginning of parameter
           
@@ -200,7 +214,7 @@
           } else if (!strcmp (ftpCmd, "NLST") || !strcmp (ftpCmd, "LIST")) {  // ---------- LIST ---------- // "ls" or "dir" command requires ASCII mode data transfer to the client - the content is a list of file names
             
                 if (!loggedIn) goto closeFtpConnection; // someone is not playing by the rules
-                if (!connection->sendData ((char *) "150 starting transfer\r\n")) goto closeFtpConnection; 
+                if (!connection->sendData ((char *) "150 starting transfer\r\n") || !connection->flush ()) goto closeFtpConnection; // client waits for 150 before it starts transferring data
                   // list file as UNIX does
                   String s = "";
                   char d [33]; strcpy (d, homeDir); if (strlen (d) > 1 && *(d + strlen (d) - 1) == '/') *(d + strlen (d) - 1) = 0;
@@ -259,7 +273,7 @@
                 
                 xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
                 
-                if (strlen (homeDir) + strlen (ftpParam) < sizeof (fileName) && sprintf (fileName, "%s%s", homeDir, ftpParam) && SPIFFS.remove (fileName)) sprintf (buffer, "250 %s deleted\r\n", fileName);
+                if (strlen (homeDir) + strlen (ftpParam) < sizeof (fileName) && sprintf (fileName, "%s%s", homeDir, ftpParam) && SPIFFS.remove (fileName)) { notifyFileSystemChanged (fileName); sprintf (buffer, "250 %s deleted\r\n", fileName); }
                 else                                                                                                                                       sprintf (buffer, "452 file could not be deleted\r\n");
                 
                 xSemaphoreGive (SPIFFSsemaphore);                
@@ -271,7 +285,7 @@
                 if (!loggedIn) goto closeFtpConnection; // someone is not playing by the rules
                 if (*ftpParam == '/') ftpParam++; // trim possible prefix
                 int bytesWritten = -1; int bytesRead = 0;
-                if (!connection->sendData ((char *) "150 starting transfer\r\n")) goto closeFtpConnection; 
+                if (!connection->sendData ((char *) "150 starting transfer\r\n") || !connection->flush ()) goto closeFtpConnection; // client waits for 150 before it starts transferring data
                   TcpConnection *dataConnection = NULL;
                   if (pasiveDataServer) while (!(dataConnection = pasiveDataServer->connection ()) && !pasiveDataServer->timeOut ()) SPIFFSsafeDelay (1); // wait until a connection arrives to non-threaded server or time-out occurs
                   if (activeDataClient) dataConnection = activeDataClient->connection (); // non-threaded client differs from non-threaded server - connection is established before constructor returns or not at all
@@ -282,16 +296,8 @@
                       
                       if ((bool) (file = SPIFFS.open (fileName, FILE_READ))) {
                         if (!file.isDirectory ()) {
-                          byte *buff = (byte *) malloc (2048); // get 2048 B of memory from heap (not from the stack)
-                          if (buff) {
-                            int i = bytesWritten = 0;
-                            while (file.available ()) {
-                              *(buff + i++) = file.read ();
-                              if (i == 2048) { bytesRead += 2048; bytesWritten += dataConnection->sendData ((char *) buff, 2048); i = 0; }
-                            }
-                            if (i) { bytesRead += i; bytesWritten += dataConnection->sendData ((char *) buff, i); }
-                            free (buff);
-                          }
+                          bytesRead = file.size ();
+                          bytesWritten = dataConnection->sendFile (file);
                         }
                         file.close ();
                       }
@@ -311,7 +317,7 @@
               if (!loggedIn) goto closeFtpConnection; // someone is not playing by the rules
                 if (*ftpParam == '/') ftpParam++; // trim possible prefix
                 int bytesRead = -1; int bytesWritten = 0;
-                if (!connection->sendData ((char *) "150 starting transfer\r\n")) goto closeFtpConnection; 
+                if (!connection->sendData ((char *) "150 starting transfer\r\n") || !connection->flush ()) goto closeFtpConnection; // client waits for 150 before it starts transferring data
                   TcpConnection *dataConnection = NULL;
                   if (pasiveDataServer) while (!(dataConnection = pasiveDataServer->connection ()) && !pasiveDataServer->timeOut ()) SPIFFSsafeDelay (1); // wait until a connection arrives to non-threaded server or time-out occurs
                   if (activeDataClient) dataConnection = activeDataClient->connection (); // non-threaded client differs from non-threaded server - connection is established before constructor returns or not at all
@@ -332,6 +338,7 @@
                           free (buff);
                         }
                         file.close ();
+                        notifyFileSystemChanged (fileName); // the file has changed even if the transfer has failed
                       }
                       
                       xSemaphoreGive (SPIFFSsemaphore);
@@ -38,6 +38,24 @@
  *            February 27, 2020, Bojan Jurca
  *          - elimination of compiler warnings and some bugs
  *            Jun 11, 2020, Bojan Jurca 
+ *          - command line is read with TcpConnection::peek, characters that arrived together are echoed together,
+ *            fixed backspace leaving the deleted character in command line
+ *            October 16, 2026
+ *          - added netstat -s command that displays admission control counters of all the servers,
+ *            connections over admission control limits get "too many connections" reply
+ *            October 16, 2026
+ *          - added optional TcpFirewall constructor parameter
+ *            October 16, 2026
+ *          - netstat command without options lists live connections with their traffic and latency, netstat -s also shows latency percentiles
+ *            October 16, 2026
+ *          - telnet connections use output buffer so echo, replies and prompt are sent together
+ *            October 16, 2026
+ *          - cat sends file with TcpConnection::sendFile
+ *            October 16, 2026
+ *          - added optional TcpTaskPolicy constructor parameter
+ *            October 16, 2026
+ *          - rm and mkfs.spiffs call notifyFileSystemChanged so that httpServer file cache forgets changed files
+ *            October 16, 2026
  *            
  */
 
@@ -198,10 +216,13 @@
                     unsigned int stackSize,                                                          // stack size of httpRequestHandler thread, usually 4 KB will do 
                     char *serverIP,                                                                  // telnet server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
                     int serverPort,                                                                  // telnet server port
-                    bool (*firewallCallback) (char *)                                                // a reference to callback function that will be celled when new connection arrives 
-                   ): TcpServer (__telnetConnectionHandler__, (void *) telnetCommandHandler, stackSize, 300000, serverIP, serverPort, firewallCallback)
+                    bool (*firewallCallback) (char *),                                               // a reference to callback function that will be celled when new connection arrives 
+                    TcpFirewall *firewall = NULL,                                                    // firewall rules that are checked before firewallCallback is called or NULL
+                    const TcpTaskPolicy &taskPolicy = TcpTaskPolicy ()                              // cores and priority of listener and connection threads
+                   ): TcpServer (__telnetConnectionHandler__, (void *) telnetCommandHandler, stackSize, 300000, serverIP, serverPort, firewallCallback, 0, 0, firewall, taskPolicy)
                                 {
-                                  if (started ()) dmesg ("[telnetServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback ? " with firewall." : "."));
+                                  setAdmissionControl (0, 0, 0, TcpAdmissionControl::REPLY, "Too many connections, try again later.\r\n"); // no limits by default, the reply is sent if there is no memory left for connection thread
+                                  if (started ()) dmesg ("[telnetServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback || firewall ? " with firewall." : "."));
                                   else            dmesg ("[telnetServer] couldn't start.");
                                 }
 
@@ -220,6 +241,7 @@
         #define ECHO 1
         char user [33]; *user = 0;          // store the name of the user that has logged in here 
         char homeDir [33]; *homeDir = 0;    // store home directory of the user that has logged in here
+        connection->setOutputBuffer (TCP_OUTPUT_BUFFER_SIZE); // echo of each character and replies sent in pieces are collected and sent together before the next character is read
 
         #if USER_MANAGEMENT == NO_USER_MANAGEMENT
           getUserHomeDirectory (homeDir, "root");
@@ -465,6 +487,7 @@
                       // connection->sendData ((char *) "Formatting flash drive from command line is not supported yet.");
                       connection->sendData ((char *) "formatting, please wait ... "); 
                       if (SPIFFS.format ()) {
+                        notifyFileSystemChanged (NULL);
                         connection->sendData ((char *) "formatted.");
                         if (SPIFFS.begin (false)) {
                           connection->sendData ((char *) "\r\nSPIFFS mounted");
@@ -595,6 +618,13 @@
                     else if (telnetArgc == 3 && telnetArgv [1] == "-s" && (n = telnetArgv [2].toInt ()) > 0 && n < 300) __free__ (connection, n);
                     else                                                                                                connection->sendData ((char *) "The only free syntax supported is free (-s <n>   where 0 < n < 300).");
                 
+                // ----- netstat -----
+
+                  } else if (telnetArgv [0] == "netstat") {
+                         if (telnetArgc == 1)                          connection->sendData (TcpConnectionRegistry::netstat ());
+                    else if (telnetArgc == 2 && telnetArgv [1] == "-s") connection->sendData (TcpAdmissionControl::statistics ());
+                    else                                                connection->sendData ((char *) "The only netstat syntax supported is netstat (-s).");
+
                 // ----- dmesg -----
 
                   } else if (telnetArgv [0] == "dmesg") {
@@ -637,33 +667,43 @@
 
       // returns true if command line is read, false if connection is closed while reading
       static bool __readCommandLine__ (char *buffer, int bufferSize, bool echo, TcpConnection *connection) {
-        unsigned char c;
+        char *data;
         int i = 0;
         *buffer = 0; 
-        while (connection->recvData ((char *) &c, 1)) { // read and process incomming data in a loop
-          switch (c) {
-              case 3:   // Ctrl-C
-                        return false;
-              case 127: // ignore
-              case 10:  // ignore
-                        break;
-              case 8:   // backspace - delete last character from the buffer and from the screen
-                        if (i) {
-                          buffer [i--] = 0; // delete the last character from buffer
-                          if (echo) if (!connection->sendData ((char *) "\x08 \x08")) return false; // delete the last character from the screen
-                        }
-                        break;                        
-              case 13:  // end of command line
-                        __trimCString__ (buffer);
-                        return true;
-              default:  // fill buffer if the character is a valid character and there is still space in a buffer
-                        if (c >= ' ' && c < 240 && i < bufferSize - 1) { // ignore control characters
-                          buffer [i++] = c; // insert character into buffer
-                          buffer [i] = 0;
-                          if (echo) if (!connection->sendData ((char *) &c, 1)) return false; // write character to the screen
-                        }
-                        break;
-          } // switch
+        while (int dataLength = connection->peek (&data)) { // process all the characters that have arrived so far at once
+          int echoFrom = i; // characters inserted into buffer since echoFrom are echoed together
+          for (int k = 0; k < dataLength; k++) {
+            unsigned char c = data [k];
+            switch (c) {
+                case 3:   // Ctrl-C
+                          connection->consume (k + 1);
+                          return false;
+                case 127: // ignore
+                case 10:  // ignore
+                          break;
+                case 8:   // backspace - delete last character from the buffer and from the screen
+                          if (echo && i > echoFrom) if (!connection->sendData (buffer + echoFrom, i - echoFrom)) return false; // echo what has been typed before backspace first
+                          if (i) {
+                            buffer [--i] = 0; // delete the last character from buffer
+                            if (echo) if (!connection->sendData ((char *) "\x08 \x08")) return false; // delete the last character from the screen
+                          }
+                          echoFrom = i;
+                          break;                        
+                case 13:  // end of command line
+                          if (echo && i > echoFrom) if (!connection->sendData (buffer + echoFrom, i - echoFrom)) return false;
+                          connection->consume (k + 1); // the rest of data stays in input buffer for the next command line
+                          __trimCString__ (buffer);
+                          return true;
+                default:  // fill buffer if the character is a valid character and there is still space in a buffer
+                          if (c >= ' ' && c < 240 && i < bufferSize - 1) { // ignore control characters
+                            buffer [i++] = c; // insert character into buffer
+                            buffer [i] = 0;
+                          }
+                          break;
+            } // switch
+          } // for
+          connection->consume (dataLength);
+          if (echo && i > echoFrom) if (!connection->sendData (buffer + echoFrom, i - echoFrom)) return false; // write characters to the screen
         } // while
         return false;
       }
@@ -729,27 +769,7 @@
         xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
           if ((bool) (file = SPIFFS.open (fileName, FILE_READ))) {
             if (!file.isDirectory ()) {
-              char *buff = (char *) malloc (2048); // get 2 KB of memory from heap (not from the stack)
-              if (buff) {
-                *buff = 0;
-                int i = strlen (buff);
-                while (file.available ()) {
-                  switch (*(buff + i) = file.read ()) {
-                    case '\r':  // ignore
-                                break;
-                    case '\n':  // crlf conversion
-                                *(buff + i ++) = '\r'; 
-                                *(buff + i ++) = '\n';
-                                break;
-                    default:
-                                i ++;                  
-                  }
-                  if (i >= 2048 - 2) { connection->sendData ((char *) buff, i); i = 0; }
-                }
-                if (i) { connection->sendData ((char *) buff, i); }
-                free (buff);
-                retVal = true;
-              } 
+              retVal = connection->sendFile (file, 0, file.size (), true) == file.size (); // with crlf conversion
               file.close ();
             } else {
               connection->sendData ((char *) "Failed to open " + fileName);
@@ -768,6 +788,7 @@
     
         xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
           if (SPIFFS.remove (fileName)) {
+            notifyFileSystemChanged (fileName.c_str ());
             xSemaphoreGive (SPIFFSsemaphore);
               connection->sendData (fileName + " deleted.");
               return true;
@@ -946,6 +967,7 @@
         
         while ((pds.pingSeqNum < pingCount) && (!pds.stopped)) {
           if (__pingSend__ (&pds, s, &pingTarget, pingSize) == ERR_OK) if (!__pingRecv__ (&pds, telnetConnection, s)) return false;
+          if (!telnetConnection->flush ()) return false; // display each reply before waiting for the next one
           SPIFFSsafeDelay (pingInterval * 1000L);
         }
       
@@ -980,6 +1002,7 @@
         }
     
         struct __telnetStruct__ telnetSessionSharedMemory = {clientConnection, true, otherServer->connection (), true, false};
+        clientConnection->setOutputBuffer (0); // client connection is going to be used by two threads, what they send must go out immediately anyway
         #define tskNORMAL_PRIORITY 1
         if (pdPASS != xTaskCreate ( [] (void *param)  { // other server -> client data transfer  
                                                         struct __telnetStruct__ *telnetSessionSharedMemory = (struct __telnetStruct__ *) param;
@@ -1035,6 +1058,7 @@
           return;
         } 
         while (telnetSessionSharedMemory.otherServerConnectionRunning || telnetSessionSharedMemory.clientConnectionRunning) SPIFFSsafeDelay (10); // wait untill both threads stop
+        clientConnection->setOutputBuffer (TCP_OUTPUT_BUFFER_SIZE);
     
         if (telnetSessionSharedMemory.receivedDataFromOtherServer) {
           // send to the client IAC DONT ECHO again just in case ther server has changed this
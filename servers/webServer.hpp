@@ -30,6 +30,41 @@
  *            February 27.2.2020, Bojan Jurca 
  *          - elimination of compiler warnings and some bugs
  *            Jun 11, 2020, Bojan Jurca            
+ *          - httpServer is now inherited from AsyncTcpServer, HTTP requests are read in its event loop and only
+ *            complete requests get their own thread
+ *            October 16, 2026
+ *          - HTTP reply header and body and WebSocket frame header and payload are sent with one gather write
+ *            October 16, 2026
+ *          - connections over admission control limits get "503" reply
+ *            October 16, 2026
+ *          - added optional TcpFirewall constructor parameter
+ *            October 16, 2026
+ *          - request handler connection continues statistics of the connection that has read the request
+ *            October 16, 2026
+ *          - files are sent with TcpConnection::sendFile
+ *            October 16, 2026
+ *          - WebSocket::available () reports ERROR when the other side closes the connection instead of reading an empty frame
+ *            October 16, 2026
+ *          - Sec-WebSocket-Accept calculation moved to webSocketAcceptKey () so that CoroutineTcpServer WebSocket example can use it
+ *            October 16, 2026
+ *          - added optional TcpTaskPolicy constructor parameter
+ *            October 16, 2026
+ *          - HTTP request header has to arrive within a total time budget and at a minimum rate (setHeaderLimits), slow clients get 408
+ *            October 16, 2026
+ *          - HTTP/1.1 persistent connections with idle time-out and maximum number of requests per connection (setKeepAlive)
+ *            October 16, 2026
+ *          - pipelined HTTP requests are served back-to-back by the same request handler thread
+ *            October 16, 2026
+ *          - HTTP requests are parsed in place by HttpRequest while they arrive, httpRequestHandler and wsRequestHandler get HttpRequest& instead of String&
+ *            October 16, 2026
+ *          - route table (HttpRoutes) with path parameters, set by setRoutes
+ *            October 16, 2026
+ *          - static files are served from in-RAM LRU cache (HttpFileCache) without taking SPIFFSsemaphore
+ *            October 16, 2026
+ *          - request body (Content-Length) is read before the request is handed over, chunked or too long bodies get 411 / 413 and close the connection
+ *            October 16, 2026
+ *          - admission slot is taken when the request is handed over to request handler thread, not when the connection is accepted
+ *            October 16, 2026
  *
  */
 
@@ -54,6 +89,10 @@
   void (* webDmesg) (String) = __webDmesg__; // use this pointer to display / record system messages  
 
   #include "TcpServer.hpp"        // webServer.hpp is built upon TcpServer.hpp  
+  #include "AsyncTcpServer.hpp"   // httpServer reads HTTP requests in AsyncTcpServer event loop
+  #include "HttpRequest.hpp"      // ... and parses them while they arrive
+  #include "HttpRoutes.hpp"       // ... and finds route handlers for them
+  #include "HttpFileCache.hpp"    // ... and keeps recently served files in RAM
   #include "user_management.h"    // webServer.hpp needs user_management.h to get www home directory
   #include "file_system.h"        // webServer.hpp needs file_system.h to read files  from home directory
   #include "network.h"            // webServer.hpp needs network.h
@@ -90,6 +129,22 @@
   #include <hwcrypto/sha.h>       // needed for websockets support 
   #include <mbedtls/base64.h>     // needed for websockets support
 
+  bool webSocketAcceptKey (char *wsRequest, char *acceptKey) { // calculates Sec-WebSocket-Accept from Sec-WebSocket-Key found in wsRequest into acceptKey (32 bytes), returns success
+    char *i = strstr (wsRequest, "Sec-WebSocket-Key: ");
+    if (!i) return false; // log_e ("[webSocket] key not found in webRequest\n");
+    i += 19;
+    char *j = strstr (i, "\r\n");
+    if (!j) return false; // log_e ("[webSocket] key not found in webRequest\n");
+    #define WS_CLIENT_KEY_LENGTH  24
+    if (j - i > WS_CLIENT_KEY_LENGTH) return false; // Sec-WebSocket-Key is not supposed to exceed 24 characters - log_e ("[webSocket] key in wsRequest too long\n");
+    // calculate Sec-WebSocket-Accept
+    char s1 [64]; memcpy (s1, i, j - i); strcpy (s1 + (j - i), "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"); 
+    #define SHA1_RESULT_SIZE 20
+    unsigned char s2 [SHA1_RESULT_SIZE]; esp_sha (SHA1, (unsigned char *) s1, strlen (s1), s2);
+    size_t olen = WS_CLIENT_KEY_LENGTH;
+    return !mbedtls_base64_encode ((unsigned char *) acceptKey, 32, &olen, s2, SHA1_RESULT_SIZE);
+  }
+
   class WebSocket {  
   
     public:
@@ -102,37 +157,18 @@
                                                   __wsRequest__ = wsRequest;
 
                                                   // do the handshake with the browser so it would consider webSocket connection established
-                                                  int i = wsRequest.indexOf ("Sec-WebSocket-Key: ");
-                                                  if (i > -1) {
-                                                    int j = wsRequest.indexOf ("\r\n", i + 19);
-                                                    if (j > -1) {
-                                                      String key = wsRequest.substring (i + 19, j);
-                                                      if (key.length () <= 24) { // Sec-WebSocket-Key is not supposed to exceed 24 characters
-                                                         
-                                                        // calculate Sec-WebSocket-Accept
-                                                        char s1 [64]; strcpy (s1, key.c_str ()); strcat (s1, "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"); 
-                                                        #define SHA1_RESULT_SIZE 20
-                                                        unsigned char s2 [SHA1_RESULT_SIZE]; esp_sha (SHA1,(unsigned char*) s1, strlen (s1), s2);
-                                                        #define WS_CLIENT_KEY_LENGTH  24
-                                                        size_t olen = WS_CLIENT_KEY_LENGTH;
-                                                        char s3 [32];
-                                                        mbedtls_base64_encode ((unsigned char *) s3, 32, &olen, s2, SHA1_RESULT_SIZE);
-                                                        // compose websocket accept reply and send it back to the client
-                                                        char buffer  [255]; // this will do
-                                                        sprintf (buffer, "HTTP/1.1 101 Switching Protocols \r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", s3);
-                                                        if (connection->sendData (buffer)) {
-                                                          // Serial.printf ("[webSocket] connection confirmed\n");
-                                                        } else {
-                                                          // log_e ("[webSocket] couldn't send accept key back to browser\n");
-                                                        }
-                                                      } else { // |key| > 24
-                                                        // log_e ("[webSocket] key in wsRequest too long\n");
-                                                      }
-                                                    } else { // j == -1
-                                                      // log_e ("[webSocket] key not found in webRequest\n");
+                                                  char acceptKey [32];
+                                                  if (webSocketAcceptKey ((char *) wsRequest.c_str (), acceptKey)) {
+                                                    // compose websocket accept reply and send it back to the client
+                                                    char buffer  [255]; // this will do
+                                                    sprintf (buffer, "HTTP/1.1 101 Switching Protocols \r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n", acceptKey);
+                                                    if (connection->sendData (buffer)) {
+                                                      // Serial.printf ("[webSocket] connection confirmed\n");
+                                                    } else {
+                                                      // log_e ("[webSocket] couldn't send accept key back to browser\n");
                                                     }
-                                                  } else { // i == -1
-                                                    // log_e ("[webSocket] key not found in webRequest\n");
+                                                  } else {
+                                                    // log_e ("[webSocket] key not found in webRequest or too long\n");
                                                   }
                                                   
                                                   // we won't do the checking if everythingg was sucessfull in constructor,
@@ -184,7 +220,9 @@
                                                                                     }
                                                                     
                                                                                     // read 6 bytes of short header
-                                                                                    if (6 != (__bytesRead__ += __connection__->recvData ((char *) __header__ + __bytesRead__, 6 - __bytesRead__))) return WebSocket::NOT_AVAILABLE; // if we haven't got 6 bytes continue reading short header the next time available () is called
+                                                                                    int received = __connection__->recvData ((char *) __header__ + __bytesRead__, 6 - __bytesRead__);
+                                                                                    if (!received) return WebSocket::ERROR; // connection has been closed or timed out
+                                                                                    if (6 != (__bytesRead__ += received)) return WebSocket::NOT_AVAILABLE; // if we haven't got 6 bytes continue reading short header the next time available () is called
 
                                                                                     // check if this frame type is supported
                                                                                     if (!(__header__ [0] & 0b10000000)) { // check fin bit
@@ -230,7 +268,9 @@
                                                                                     // we don't have to repeat the checking already done in short header case, just read additiona 2 bytes and correct data structure
 
                                                                                     // read additional 2 bytes (8 altogether) bytes of medium header
-                                                                                    if (8 != (__bytesRead__ += __connection__->recvData ((char *) __header__ + __bytesRead__, 8 - __bytesRead__))) return WebSocket::NOT_AVAILABLE; // if we haven't got 8 bytes continue reading medium header the next time available () is called
+                                                                                    int received = __connection__->recvData ((char *) __header__ + __bytesRead__, 8 - __bytesRead__);
+                                                                                    if (!received) return WebSocket::ERROR; // connection has been closed or timed out
+                                                                                    if (8 != (__bytesRead__ += received)) return WebSocket::NOT_AVAILABLE; // if we haven't got 8 bytes continue reading medium header the next time available () is called
                                                                                     // correct internal structure for reading into extended buffer and continue at FILLING_EXTENDED_BUFFER immediately
                                                                                     __payloadLength__ = __header__ [2] << 8 | __header__ [3];
                                                                                     __mask__ = __header__ + 4; // bytes 4, 5, 6, 7
@@ -248,7 +288,9 @@ readingPayload:
                                                                                   // Serial.printf ("[webSocket] READING_PAYLOAD, reading %i bytes of payload\n", __payloadLength__);
                                                                                   {
                                                                                     // read all payload bytes
-                                                                                    if (__payloadLength__ != (__bytesRead__ += __connection__->recvData ((char *) __payload__ + __bytesRead__, __payloadLength__ - __bytesRead__))) {
+                                                                                    int received = __connection__->recvData ((char *) __payload__ + __bytesRead__, __payloadLength__ - __bytesRead__);
+                                                                                    if (!received) return WebSocket::ERROR; // connection has been closed or timed out
+                                                                                    if (__payloadLength__ != (__bytesRead__ += received)) {
                                                                                       return WebSocket::NOT_AVAILABLE; // if we haven't got all payload bytes continue reading the next time available () is called
                                                                                     }
                                                                                     // all is read, decode (unmask) the data
@@ -336,37 +378,24 @@ readingPayload:
                                                   __connection__->closeConnection ();
                                                   return false;                         
                                                 } 
-                                                byte *frame = NULL;
-                                                int frameSize;
+                                                byte header [4];
+                                                int headerSize;
+                                                header [0] = 0b10000000 | dataType; // set FIN bit and frame data type
                                                 if (bufferSize > 125) { // medium frame size
-                                                  if (!(frame = (byte *) malloc (frameSize = 4 + bufferSize))) { // 4 bytes for header (without mask) + payload
-                                                    Serial.printf ("[webSocket] malloc failed - out of memory\n");
-                                                    __connection__->closeConnection ();
-                                                    return false;
-                                                  }
-                                                  // frame type
-                                                  frame [0] = 0b10000000 | dataType; // set FIN bit and frame data type
-                                                  frame [1] = 126; // medium frame size, without masking (we won't do the masking, won't set the MASK bit)
-                                                  frame [2] = bufferSize >> 8; // / 256;
-                                                  frame [3] = bufferSize; // % 256;
-                                                  memcpy (frame + 4, buffer, bufferSize);  
+                                                  header [1] = 126; // medium frame size, without masking (we won't do the masking, won't set the MASK bit)
+                                                  header [2] = bufferSize >> 8; // / 256;
+                                                  header [3] = bufferSize; // % 256;
+                                                  headerSize = 4; // 4 bytes for header (without mask)
                                                 } else { // small frame size
-                                                  if (!(frame = (byte *) malloc (frameSize = 2 + bufferSize))) { // 2 bytes for header (without mask) + payload
-                                                    Serial.printf ("[webSocket] malloc failed - out of memory\n");
-                                                    __connection__->closeConnection ();
-                                                    return false;
-                                                  }
-                                                  frame [0] = 0b10000000 | dataType; // set FIN bit and frame data type
-                                                  frame [1] = bufferSize; // small frame size, without masking (we won't do the masking, won't set the MASK bit)
-                                                  if (bufferSize) memcpy (frame + 2, buffer, bufferSize);  
+                                                  header [1] = bufferSize; // small frame size, without masking (we won't do the masking, won't set the MASK bit)
+                                                  headerSize = 2; // 2 bytes for header (without mask)
                                                 }
-                                                if (__connection__->sendData ((char *) frame, frameSize) != frameSize) {
-                                                  free (frame);
+                                                struct iovec frame [2] = {{header, (size_t) headerSize}, {buffer, bufferSize}}; // header and payload go out together without copying payload into a new frame
+                                                if (__connection__->sendData (frame, 2) != headerSize + (int) bufferSize) {
                                                   __connection__->closeConnection ();
                                                   Serial.printf ("[webSocket] failed to send frame\n");
                                                   return false;
                                                 }
-                                                free (frame);
                                                 return true;
                                               }
 
@@ -389,31 +418,76 @@ readingPayload:
   };
 
 /*
- * httpServer is inherited from TcpServer with connection handler that handles connections according
- * to HTTP protocol - HTTP 1.0 in this particular implementation, meaning that connection is closed
- * immediatelly after beeing served.
+ * httpServer is inherited from AsyncTcpServer. Its event loop reads HTTP requests of all connections so
+ * that connections that haven't sent a (whole) request yet cost no stack. When the request is complete the
+ * connection is detached from the event loop and handed over to a threaded TcpConnection with request handler
+ * that handles the request according to HTTP protocol. 
+ * 
+ * HTTP/1.1 connections (and HTTP/1.0 connections that ask for Connection: keep-alive) are persistent: after the reply
+ * the request handler thread detaches the connection and gives it back to the event loop (AsyncTcpServer::adopt)
+ * where it waits for the next request without a thread of its own. An idle connection is closed after keepAliveMillis,
+ * a connection is closed after keepAliveMaxRequests requests (setKeepAlive). Every reply has Content-Length and
+ * Connection header so the client knows where the reply ends and if the connection stays opened.
+ * 
+ * The event loop parses the request (HttpRequest.hpp) while it arrives, in the buffer it has been received into.
+ * httpRequestHandler and wsRequestHandler get the parsed HttpRequest: method, path, query, version and headers are
+ * pointer / length views into that buffer, so handlers don't have to copy or search the request text. Malformed
+ * requests get "400" reply. A request with Content-Length is handed over when its body has arrived too, handlers read
+ * it with getBody () and the next request on the connection starts after it. Chunked bodies (Transfer-Encoding) and
+ * bodies longer than HTTP_MAX_BODY_LENGTH get "411" or "413" reply and the connection is closed since it is not known
+ * where the next request would start.
+ * 
+ * A client may send (pipeline) several requests without waiting for replies. The event loop hands all that has
+ * arrived over to the request handler thread which serves complete requests back-to-back, in the same order, and
+ * collects their replies into full TCP segments. Each request is skipped together with its body. An incomplete
+ * request at the end goes back to the event loop together with the connection.
  * 
- * Connection handler tries to resolve HTTP request in three ways:
+ * Since the connection time-out is refreshed by every byte that arrives, a client that sends its request one byte
+ * every few seconds (slowloris) could keep the connection (and its socket) forever. The event loop therefore also
+ * checks the time since the connection has been accepted: the whole request header (and body) has to arrive within
+ * headerMillis and, once the client has started sending, at no less than minBytesPerSecond on average.
+ * 
+ * Admission control (setAdmissionControl) limits request handler threads, not connections: the event loop takes an
+ * admission slot only when the request is complete and the connection is handed over to a thread, and kept-alive
+ * connections give it back when they return to the event loop. Slow clients thus can't take the slots that normal
+ * clients need. A request that finds no free slot gets "503" reply or, with QUEUE overflow, waits in the event loop.
+ * 
+ * Instead of comparing each request with all its REST functions in httpRequestHandler the calling program can add them
+ * to HttpRoutes (method, path pattern like /niceSlider3/{value} and route handler) once, at startup, and give the table
+ * to httpServer with setRoutes. Finding the route handler then costs one hash look-up per path segment regardless of
+ * the number of routes.
+ * 
+ * Recently served files (up to HTTP_FILE_CACHE_SIZE bytes) are kept in httpFileCache together with their reply headers,
+ * so they are sent without taking SPIFFSsemaphore and reading flash. FTP STOR, XRMD and telnet rm notify the cache
+ * (fileSystemChanged) when a file changes. Cache hits, misses and evictions are counted (httpFileCache.json ()).
+ * 
+ * Request handler tries to resolve HTTP request in these ways:
  *  1. checks if the request is a WS request and starts WebSocket in this case
  *  2. asks httpRequestHandler provided by the calling program if it is going to provide the reply
- *  3. checks /var/www/html directry for .html file that suits the request
- *  4. replyes with 404 - not found 
+ *  3. asks the route handler that HttpRoutes finds for the request (if the calling program has set routes)
+ *  4. checks file cache and then /var/www/html directry for .html file that suits the request
+ *  5. replyes with 404 - not found 
  */
   
-  class httpServer: public TcpServer {                                             
+  class httpServer: public AsyncTcpServer {                                             
   
     public:
   
-      httpServer (String (*httpRequestHandler) (String& httpRequest),                 // httpRequestHandler callback function provided by calling program
-                  void (*wsRequestHandler) (String& wsRequest, WebSocket *webSocket), // httpRequestHandler callback function provided by calling program      
+      httpServer (String (*httpRequestHandler) (HttpRequest& httpRequest),            // httpRequestHandler callback function provided by calling program
+                  void (*wsRequestHandler) (HttpRequest& wsRequest, WebSocket *webSocket), // httpRequestHandler callback function provided by calling program      
                   unsigned int stackSize,                                             // stack size of httpRequestHandler thread, usually 4 KB will do 
                   char *serverIP,                                                     // web server IP address, 0.0.0.0 for all available IP addresses - 15 characters at most!
                   int serverPort,                                                     // web server port
-                  bool (*firewallCallback) (char *)                                   // a reference to callback function that will be celled when new connection arrives 
-                 ): TcpServer (__webConnectionHandler__, this, stackSize, 10000, serverIP, serverPort, firewallCallback)
+                  bool (*firewallCallback) (char *),                                  // a reference to callback function that will be celled when new connection arrives 
+                  TcpFirewall *firewall = NULL,                                       // firewall rules that are checked before firewallCallback is called or NULL
+                  const TcpTaskPolicy &taskPolicy = TcpTaskPolicy ()                 // event loop runs on listenerCore, request handler threads on connectionCore
+                 ): AsyncTcpServer (__webEvent__, this, 10000, serverIP, serverPort, firewallCallback, firewall, taskPolicy)
                                 {
                                   __httpRequestHandler__ = httpRequestHandler;
                                   __wsRequestHandler__ = wsRequestHandler; 
+                                  __stackSize__ = stackSize;
+                                  setAdmissionControl (0, 0, 0, TcpAdmissionControl::REPLY, "HTTP/1.0 503 Service Unavailable\r\nContent-Length:0\r\n\r\n"); // no limits by default, 503 is sent if there is no memory left for request handler thread
+                                  setDeferredAdmission (true); // admission control limits request handler threads, see above
                                   char homeDir [33];
                                   char *p = getUserHomeDirectory (homeDir, (char *) "webserver"); 
                                   if (p && strlen (p) < sizeof (__webHomeDirectory__)) strcpy (__webHomeDirectory__, p);
@@ -421,120 +495,327 @@ readingPayload:
                                     webDmesg ("[httpServer] home directory for webserver system account is not set.");
                                     return;
                                   }
+                                  fileSystemChanged = __httpFileCacheInvalidate__; // FTP and telnet let the cache know when files change
                                   __started__ = true; // we have initialized everything needed for TCP connection
-                                  if (started ()) webDmesg ("[httpServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback ? " with firewall." : "."));
+                                  if (started ()) webDmesg ("[httpServer] started on " + String (serverIP) + ":" + String (serverPort) + (firewallCallback || firewall ? " with firewall." : "."));
                                 }
       
       ~httpServer ()            { if (started ()) webDmesg ("[httpServer] stopped."); }
       
-      bool started ()           { return TcpServer::started () && __started__; } 
+      bool started ()           { return AsyncTcpServer::started () && __started__; } 
 
       char *getHomeDirectory () { return __webHomeDirectory__; }
 
+      // limits for reading HTTP request header (see above), 0 turns a limit off
+      void setHeaderLimits (unsigned long headerMillis, unsigned int minBytesPerSecond) { __headerMillis__ = headerMillis; __minHeaderBytesPerSecond__ = minBytesPerSecond; }
+
+      unsigned long getSlowClients () { return __slowClients__; } // connections closed because their request header was arriving too slowly
+
+      // HTTP/1.1 persistent connections: idle connection is closed after idleMillis, a connection serves at most maxRequests requests, (0, 0) closes connections after each reply
+      void setKeepAlive (unsigned long idleMillis, unsigned int maxRequests) { __keepAliveMillis__ = idleMillis; __keepAliveMaxRequests__ = maxRequests; }
+
+      // route table that is asked after httpRequestHandler, all routes have to be added before, NULL turns routes off
+      void setRoutes (HttpRoutes *routes) { __routes__ = routes; }
+
+      HttpRoutes *getRoutes () { return __routes__; }
+
     private:
 
-      String (*__httpRequestHandler__) (String& httpRequest);                 // httpRequestHandler callback function provided by calling program
-      void (*__wsRequestHandler__) (String& wsRequest, WebSocket *webSocket); // wsRequestHandler callback function provided by calling program
+      String (*__httpRequestHandler__) (HttpRequest& httpRequest);            // httpRequestHandler callback function provided by calling program
+      void (*__wsRequestHandler__) (HttpRequest& wsRequest, WebSocket *webSocket); // wsRequestHandler callback function provided by calling program
+      HttpRoutes *__routes__ = NULL;                                          // route table provided by calling program
+      unsigned int __stackSize__;                                             // stack size of request handler threads
       char __webHomeDirectory__ [33] = {};                                    // webServer system account home directory
 
       bool __started__ = false;
 
-      static void __webConnectionHandler__ (TcpConnection *connection, void *thisWebServer) {  // connectionHandler callback function
+      unsigned long __headerMillis__ = 5000;                                  // the whole request header has to arrive in 5 s ...
+      unsigned int __minHeaderBytesPerSecond__ = 32;                          // ... with at least 32 bytes per second
+      unsigned long __slowClients__ = 0;
+
+      unsigned long __keepAliveMillis__ = 5000;                               // kept-alive connection is closed if the next request doesn't start in 5 s ...
+      unsigned int __keepAliveMaxRequests__ = 100;                            // ... or after 100 requests
+
+      struct __webConnection__ {                                              // state of a connection, kept in its userData while event loop reads the request, then handed over to request handler thread
+        httpServer *server;
+        String httpRequest;                                                   // the part of HTTP request received so far (possibly followed by pipelined requests)
+        HttpRequest request;                                                  // parsed while httpRequest arrives
+        unsigned int requests = 0;                                            // requests already served on this (persistent) connection
+        unsigned long headerStartMillis = 0;                                  // when the first byte of current request header arrived (or the connection was accepted)
+        unsigned long headerStartBytes = 0;                                   // bytes received on the connection before current request header
+        bool waitingForSlot = false;                                          // complete request waits in event loop until admission control lets it through
+      };
+
+      static void __webEvent__ (AsyncTcpConnection *connection, AsyncTcpServer::EVENT_TYPE event, char *data, int dataLength, void *thisWebServer) { // event callback function, called from event loop
         httpServer *ths = (httpServer *) thisWebServer; // this is how you pass "this" pointer to static memeber function
-        // log_v ("[Thread:%i][Core:%i] connection has started\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID ());  
-        char buffer [4096];  // make sure there is enough space for each type of use but be modest - this buffer uses thread stack
-        int receivedTotal = buffer [0] = 0;
-        while (int received = connection->recvData (buffer + receivedTotal, sizeof (buffer) - receivedTotal - 1)) { // this loop may not seem necessary but TCP protocol does not guarantee that a whole request arrives in a single data block althought it usually does
-          buffer [receivedTotal += received] = 0; // mark the end of received request
-          if (strstr (buffer, "\r\n\r\n")) { // is the end of HTTP request is reached?
-            // log_v ("[Thread:%i][Core:%i] new request:\n%s", xTaskGetCurrentTaskHandle (), xPortGetCoreID (), buffer);
-
-            // ----- make a String copy of the http request -----
-            String httpRequest = String (buffer);
-
-            // ----- first check if this is a websocket request -----
-
-            if (stristr (buffer, (char *) "CONNECTION: UPGRADE")) {
-              connection->setTimeOut (300000); // set time-out to 5 minutes fro WebSockets
-              WebSocket webSocket (connection, httpRequest); 
-              if (ths->__wsRequestHandler__) ths->__wsRequestHandler__ (httpRequest, &webSocket);
-              goto closeWebConnection;
-            }
+        __webConnection__ *webConnection = (__webConnection__ *) connection->userData; // NULL until the first data arrives, already set for kept-alive connections
+        switch (event) {
+          case AsyncTcpServer::CONNECTED:
+                                      if (webConnection) connection->setTimer (ths->__keepAliveMillis__ && ths->__keepAliveMillis__ < 1000 ? ths->__keepAliveMillis__ : 1000); // kept-alive connection waits for the next request
+                                      else if (ths->__headerMillis__ || ths->__minHeaderBytesPerSecond__) connection->setTimer (ths->__headerMillis__ && ths->__headerMillis__ < 1000 ? ths->__headerMillis__ : 1000); // check the progress of request header every second
+                                      break;
+          case AsyncTcpServer::TIMER: {
+                                        if (webConnection && webConnection->waitingForSlot) { // complete request is waiting for a free request handler slot (QUEUE overflow)
+                                          __handOver__ (ths, connection, webConnection);
+                                          break;
+                                        }
+                                        if (webConnection && webConnection->requests && !webConnection->httpRequest.length ()) { // idle kept-alive connection
+                                          unsigned long idleMillis = millis () - connection->getConnectedMillis ();
+                                          if (ths->__keepAliveMillis__ && idleMillis >= ths->__keepAliveMillis__) connection->closeConnection (); // the client may open a new connection later
+                                          else connection->setTimer (ths->__keepAliveMillis__ && ths->__keepAliveMillis__ - idleMillis < 1000 ? ths->__keepAliveMillis__ - idleMillis : 1000);
+                                          break;
+                                        }
+                                        if (!ths->__headerMillis__ && !ths->__minHeaderBytesPerSecond__) break;
+                                        unsigned long headerMillis = millis () - (webConnection ? webConnection->headerStartMillis : connection->getConnectedMillis ());
+                                        unsigned long bytesReceived = connection->getBytesReceived () - (webConnection ? webConnection->headerStartBytes : 0);
+                                        if ((ths->__headerMillis__ && headerMillis >= ths->__headerMillis__) ||
+                                            (ths->__minHeaderBytesPerSecond__ && bytesReceived && headerMillis >= 1000 && bytesReceived * 1000 < (unsigned long) ths->__minHeaderBytesPerSecond__ * headerMillis)) {
+                                          ths->__slowClients__ ++; // only event loop thread changes it
+                                          connection->sendData ((char *) "HTTP/1.0 408 Request Timeout\r\nContent-Length:0\r\n\r\n");
+                                          connection->closeConnection ();
+                                        } else {
+                                          unsigned long timerMillis = 1000;
+                                          if (ths->__headerMillis__ && ths->__headerMillis__ - headerMillis < timerMillis) timerMillis = ths->__headerMillis__ - headerMillis;
+                                          connection->setTimer (timerMillis);
+                                        }
+                                      }
+                                      break;
+          case AsyncTcpServer::DATA: {
+                                        if (!webConnection) {
+                                          connection->userData = webConnection = new __webConnection__ ();
+                                          if (!webConnection) { connection->closeConnection (); return; }
+                                          webConnection->server = ths;
+                                          webConnection->headerStartMillis = connection->getConnectedMillis ();
+                                        } else if (webConnection->requests && !webConnection->httpRequest.length ()) { // the next request on kept-alive connection starts, header limits apply to it from now on
+                                          webConnection->headerStartMillis = millis ();
+                                          webConnection->headerStartBytes = connection->getBytesReceived () - dataLength;
+                                        }
+                                        webConnection->httpRequest.concat (data, dataLength); // request body may contain '\0'
+                                        switch (webConnection->request.parse (webConnection->httpRequest.c_str (), webConnection->httpRequest.length ())) { // only the new data is parsed
+                                          case HttpRequest::COMPLETE:
+                                                                      __handOver__ (ths, connection, webConnection);
+                                                                      break;
+                                          case HttpRequest::MALFORMED:
+                                                                      webDmesg ("[httpServer] malformed or too long http request, server is closing the connection.");
+                                                                      connection->sendData ((char *) "HTTP/1.0 400 Bad Request\r\nContent-Length:0\r\n\r\n");
+                                                                      connection->closeConnection ();
+                                                                      break;
+                                          case HttpRequest::UNSUPPORTED:
+                                                                      webDmesg ("[httpServer] http request body is chunked or too long, server is closing the connection.");
+                                                                      connection->sendData ((char *) __unsupportedBodyReply__ (webConnection->request));
+                                                                      connection->closeConnection ();
+                                                                      break;
+                                          default:                    // wait for the rest of the request
+                                                                      break;
+                                        }
+                                      }
+                                      break;
+          case AsyncTcpServer::TIME_OUT:
+                                      if (webConnection && webConnection->httpRequest.length ()) webDmesg ("[httpServer] http request does not end properly, server is closing the connection.");
+                                      break;
+          case AsyncTcpServer::CLOSED:
+                                      if (webConnection) delete (webConnection);
+                                      break;
+          default:
+                                      break;
+        }
+      }
 
-            // ----- then ask httpRequestHandler (if it is provided by the calling program) if it is going to handle this HTTP request -----
+      static void __handOver__ (httpServer *ths, AsyncTcpConnection *connection, __webConnection__ *webConnection) { // hands the connection, together with its state, over to a thread that may block while handling the request
+        // admission slot is taken only now, connections that are still sending their requests don't hold any
+        if (!connection->admit ()) {
+          TcpAdmissionControl *admission = ths->getAdmissionControl ();
+          if (admission->full ()) { // QUEUE overflow - keep the request in event loop and try again a little later
+            webConnection->waitingForSlot = true;
+            connection->setReceiving (false);
+            connection->setTimer (ASYNC_ADMISSION_RETRY_TIME);
+            return;
+          }
+          connection->userData = NULL;
+          delete (webConnection);
+          admission->reject (connection->detach ()); // reply with 503
+          return;
+        }
+        webConnection->waitingForSlot = false;
+        connection->userData = NULL; // request handler thread owns webConnection from now on
+        char clientIP [16]; strcpy (clientIP, connection->getOtherSideIP ());
+        TcpAdmissionControl *admission;
+        tcpConnectionStatistics statistics;
+        int connectionSocket = connection->detach (&admission, &statistics); // the connection takes its admission slot and statistics along
+        bool requestThreadStarted = false;
+        TcpConnection *requestConnection = new TcpConnection (__webRequestHandler__, webConnection, ths->__stackSize__, connectionSocket, clientIP, connection->getTimeOut (), &requestThreadStarted, admission, &statistics, ths->getTaskPolicy ().core (ths->getTaskPolicy ().connectionCore), ths->getTaskPolicy ().priority);
+        if (!requestConnection) { 
+          if (admission) { admission->release (clientIP); admission->reject (connectionSocket); } // reply with 503
+          else close (connectionSocket);
+          delete (webConnection);
+        } else if (!requestThreadStarted) { // not enough memory for request handler thread
+          requestConnection->__socket__ = -1; // keep the socket opened for 503 reply
+          delete (requestConnection); // also releases admission slot
+          if (admission) admission->reject (connectionSocket); else close (connectionSocket);
+          delete (webConnection);
+        }
+      }
 
-            // log_v ("[Thread:%i][Core:%i] trying to get a reply from calling program\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
-            String httpReply;
-            unsigned long timeOutMillis = connection->getTimeOut (); connection->setTimeOut (TcpConnection::INFINITE); // disable time-out checking while proessing httpRequestHandler to allow longer processing times
-            if (ths->__httpRequestHandler__ && (httpReply = ths->__httpRequestHandler__ (httpRequest)) != "") {
-              httpReply = "HTTP/1.0 200 OK\r\nContent-Type:text/html;\r\nCache-control:no-cache\r\nContent-Length:" + String (httpReply.length ()) + "\r\n\r\n" + httpReply; // add HTTP header
-              connection->sendData (httpReply); // send everything to the client
-              connection->setTimeOut (timeOutMillis); // restore time-out checking before sending reply back to the client
-              goto closeWebConnection;
-            }
-            connection->setTimeOut (timeOutMillis); // restore time-out checking
-
-            // ----- check if request is of type GET filename - if yes then reply with filename content -----
-
-            char htmlFile [33] = {};
-            char fullHtmlFilePath [33];
-            if (buffer == strstr (buffer, "GET ")) {
-              char *p; if ((p = strstr (buffer + 4, " ")) && (p - buffer) < (sizeof (htmlFile) + 4)) memcpy (htmlFile, buffer + 4, p - buffer - 4);
-              if (*htmlFile == '/') strcpy (htmlFile, htmlFile + 1); if (!*htmlFile) strcpy (htmlFile, "index.html");
-              char homeDir [33];
-              if ((p = getUserHomeDirectory (homeDir, (char *) "webserver"))) {
-                if (strlen (p) + strlen (htmlFile) < sizeof (fullHtmlFilePath)) strcat (strcpy (fullHtmlFilePath, p), htmlFile);
-                xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
-                  File file;                
-                  if ((bool) (file = SPIFFS.open (fullHtmlFilePath, FILE_READ))) {
-                    if (!file.isDirectory ()) {
-                      char *buff = (char *) malloc (4096); // get 4 KB of memory from heap (not from the stack)
-                      if (buff) {
-                        sprintf (buff, "HTTP/1.0 200 OK\r\nContent-Type:text/html;\r\nCache-control:no-cache\r\nContent-Length:%i\r\n\r\n", file.size ());
-                        int i = strlen (buff);
-                        while (file.available ()) {
-                          *(buff + i++) = file.read ();
-                          if (i == 4096) { connection->sendData ((char *) buff, 4096); i = 0; }
-                        }
-                        if (i) { connection->sendData ((char *) buff, i); }
-                        free (buff);
-                      } 
+      static void __webRequestHandler__ (TcpConnection *connection, void *parameter) {  // connectionHandler callback function, runs in its own thread
+        __webConnection__ *webConnection = (__webConnection__ *) parameter; // taken over from event loop together with the connection
+        httpServer *ths = webConnection->server;
+        String& httpRequests = webConnection->httpRequest; // complete request, possibly followed by more (pipelined) requests
+        HttpRequest& httpRequest = webConnection->request; // event loop has already parsed the first request
+
+        // ----- handle pipelined requests back-to-back, replies go out in the same order -----
+
+        unsigned int requestStart = 0;
+        while (true) {
+          webConnection->requests ++;
+          // log_v ("[Thread:%i][Core:%i] new request:\n%s", xTaskGetCurrentTaskHandle (), xPortGetCoreID (), httpRequest.getRequest ().toString ().c_str ());
+
+          // ----- first check if this is a websocket request -----
+
+          if (httpRequest.getHeader ("Connection").hasToken ("upgrade")) {
+            connection->setTimeOut (300000); // set time-out to 5 minutes fro WebSockets
+            WebSocket webSocket (connection, httpRequest.getRequest ().toString ()); 
+            if (ths->__wsRequestHandler__) ths->__wsRequestHandler__ (httpRequest, &webSocket);
+            delete (webConnection);
+            return;
+          }
+
+          // ----- reply and, if both sides want it, continue with the next request -----
+
+          bool keepAlive = ths->__keepAliveMaxRequests__ && webConnection->requests < ths->__keepAliveMaxRequests__ && httpRequest.keepAlive ();
+          requestStart += httpRequest.getLength () + httpRequest.getContentLength (); // the next pipelined request starts after the body
+          #define HTTP_PIPELINE_OUTPUT_BUFFER 1460
+          if (keepAlive && requestStart < httpRequests.length () && connection->__outputBufferSize__ < HTTP_PIPELINE_OUTPUT_BUFFER) connection->setOutputBuffer (HTTP_PIPELINE_OUTPUT_BUFFER); // more replies may follow, collect them into full TCP segments
+          __httpReply__ (ths, connection, httpRequest, keepAlive);
+          if (!keepAlive) { delete (webConnection); return; } // pipelined requests after this one (if any) are ignored, the connection will be closed
+          httpRequest.reset ();
+          if (requestStart == httpRequests.length ()) break;
+          HttpRequest::PARSE_RESULT parseResult = httpRequest.parse (httpRequests.c_str () + requestStart, httpRequests.length () - requestStart); // the next request, in place
+          if (parseResult == HttpRequest::INCOMPLETE) break;
+          if (parseResult == HttpRequest::MALFORMED) { 
+            connection->sendData ((char *) "HTTP/1.0 400 Bad Request\r\nContent-Length:0\r\n\r\n");
+            delete (webConnection); 
+            return; 
+          }
+          if (parseResult == HttpRequest::UNSUPPORTED) { // the body can't be skipped, so the connection can't be used any more
+            connection->sendData ((char *) __unsupportedBodyReply__ (httpRequest));
+            delete (webConnection); 
+            return; 
+          }
+        }
+
+        // ----- give the connection back to event loop to wait for the next request, together with the part of it that may have already arrived -----
+
+        httpRequests.remove (0, requestStart); // parser keeps offsets from the beginning of the request so they stay valid
+        ths->__keepAlive__ (connection, webConnection);
+      }
+
+      static const char *__unsupportedBodyReply__ (HttpRequest& httpRequest) { // reply to a request whose body can't be read
+        if (httpRequest.getHeader ("Transfer-Encoding").data) return "HTTP/1.0 411 Length Required\r\nConnection:close\r\nContent-Length:0\r\n\r\n";
+        return "HTTP/1.0 413 Payload Too Large\r\nConnection:close\r\nContent-Length:0\r\n\r\n";
+      }
+
+      static char *__httpHeader__ (char *httpHeader, const char *status, unsigned long contentLength, bool keepAlive) { // Content-Length is always there so the client knows where the reply ends without waiting for the connection to close
+        sprintf (httpHeader, "%s %s\r\nContent-Type:text/html;\r\nCache-control:no-cache\r\nConnection:%s\r\nContent-Length:%lu\r\n\r\n", keepAlive ? "HTTP/1.1" : "HTTP/1.0", status, keepAlive ? "keep-alive" : "close", contentLength);
+        return httpHeader;
+      }
+
+      static void __httpReply__ (httpServer *ths, TcpConnection *connection, HttpRequest& httpRequest, bool keepAlive) {
+        char httpHeader [160];
+
+        // ----- ask httpRequestHandler and then route handler (if they are provided by the calling program) if they are going to handle this HTTP request -----
+
+        // log_v ("[Thread:%i][Core:%i] trying to get a reply from calling program\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID ());
+        {
+          String httpReply;
+          HttpRouteHandler routeHandler;
+          unsigned long timeOutMillis = connection->getTimeOut (); connection->setTimeOut (TcpConnection::INFINITE); // disable time-out checking while proessing httpRequestHandler to allow longer processing times
+          if (ths->__httpRequestHandler__) httpReply = ths->__httpRequestHandler__ (httpRequest);
+          if (httpReply == "" && ths->__routes__ && (routeHandler = ths->__routes__->find (httpRequest))) httpReply = routeHandler (httpRequest);
+          if (httpReply != "") {
+            __httpHeader__ (httpHeader, "200 OK", httpReply.length (), keepAlive);
+            struct iovec iov [2] = {{httpHeader, strlen (httpHeader)}, {(char *) httpReply.c_str (), httpReply.length ()}}; // send HTTP header and reply together without copying them into one buffer
+            connection->sendData (iov, 2); // send everything to the client
+            connection->setTimeOut (timeOutMillis); // restore time-out checking before sending reply back to the client
+            return;
+          }
+          connection->setTimeOut (timeOutMillis); // restore time-out checking
+        }
+
+        // ----- check if request is of type GET filename - if yes then reply with filename content -----
+
+        char htmlFile [33] = {};
+        char fullHtmlFilePath [33];
+        if (httpRequest.getMethod () == "GET") {
+          HttpStringView path = httpRequest.getPath ();
+          if (path.startsWith ("/")) path = path.substring (1);
+          if (!path.length) strcpy (htmlFile, "index.html"); else path.copyTo (htmlFile, sizeof (htmlFile)); // htmlFile stays empty if path is too long
+          if (*htmlFile && strlen (ths->__webHomeDirectory__) + strlen (htmlFile) < sizeof (fullHtmlFilePath)) {
+            strcat (strcpy (fullHtmlFilePath, ths->__webHomeDirectory__), htmlFile);
+            HttpCachedFile *cachedFile = httpFileCache.get (fullHtmlFilePath);
+            if (!cachedFile) {
+              xSemaphoreTake (SPIFFSsemaphore, portMAX_DELAY);
+                File file;                
+                if ((bool) (file = SPIFFS.open (fullHtmlFilePath, FILE_READ))) {
+                  if (!file.isDirectory ()) {
+                    char closeHttpHeader [160];
+                    __httpHeader__ (httpHeader, "200 OK", file.size (), true);
+                    __httpHeader__ (closeHttpHeader, "200 OK", file.size (), false);
+                    if (!(cachedFile = httpFileCache.load (file, fullHtmlFilePath, httpHeader, closeHttpHeader))) { // file is too large or there is not enough memory to cache it, send it from flash
+                      if (connection->__outputBufferSize__ < (int) sizeof (httpHeader)) connection->setOutputBuffer (sizeof (httpHeader)); // HTTP header waits in output buffer and goes out together with the first block of file
+                      connection->sendData (keepAlive ? httpHeader : closeHttpHeader);
+                      connection->sendFile (file);
                       file.close ();
                       xSemaphoreGive (SPIFFSsemaphore);
-                      goto closeWebConnection;
-                    } // if file is a file, not a directory
-                    file.close ();
-                  } // if file is opened
-                xSemaphoreGive (SPIFFSsemaphore);
-              }
+                      return;
+                    }
+                  } // if file is a file, not a directory
+                  file.close ();
+                } // if file is opened
+              xSemaphoreGive (SPIFFSsemaphore);
+            }
+            if (cachedFile) { // send HTTP header and file content together, without holding SPIFFSsemaphore
+              struct iovec iov [2] = {{(char *) cachedFile->header (keepAlive), strlen (cachedFile->header (keepAlive))}, {(char *) cachedFile->content, cachedFile->contentLength}};
+              connection->sendData (iov, 2);
+              httpFileCache.release (cachedFile);
+              return;
             }
-    
-            // ----- if request was GET / and index.html couldn't be found then send special reply -----
-            
-            if (!strcmp (htmlFile, "index.html")) {
-              #define NO_INDEX_HTML_MESSAGE "Please use FTP, loggin as webadmin / webadminpassword and upload *.html and *.png files found in Esp32_web_ftp_telnet_server_template package into webserver home directory."
-              sprintf (buffer, "HTTP/1.0 200 OK\r\nContent-Type:text/html;\r\nCache-control:no-cache\r\nContent-Length:%i\r\n\r\n%s", strlen (NO_INDEX_HTML_MESSAGE), NO_INDEX_HTML_MESSAGE);
-              connection->sendData (buffer);
-              goto closeWebConnection;
-            } 
-
-// reply404:
-          
-            // ----- 404 page not found reply -----
-            
-            #define response404 "HTTP/1.0 404 Not found\r\nContent-Type:text/html;\r\nContent-Length:20\r\n\r\nPage does not exist." // HTTP header and content
-            connection->sendData ((char *) response404); // send response
-            webDmesg (String ("[httpServer] don't know how to handle http request from " + String (connection->getOtherSideIP ()) + "\r\n") + httpRequest);
-            
-          } else { // is the end of HTTP request is reached?
-            webDmesg ("[httpServer] http request does not end properly, server is closing the connection.");
           }
         }
-      
-      closeWebConnection:
-        ;
+    
+        // ----- if request was GET / and index.html couldn't be found then send special reply -----
+        
+        if (!strcmp (htmlFile, "index.html")) {
+          #define NO_INDEX_HTML_MESSAGE "Please use FTP, loggin as webadmin / webadminpassword and upload *.html and *.png files found in Esp32_web_ftp_telnet_server_template package into webserver home directory."
+          __httpHeader__ (httpHeader, "200 OK", strlen (NO_INDEX_HTML_MESSAGE), keepAlive);
+          struct iovec iov [2] = {{httpHeader, strlen (httpHeader)}, {(char *) NO_INDEX_HTML_MESSAGE, strlen (NO_INDEX_HTML_MESSAGE)}};
+          connection->sendData (iov, 2);
+          return;
+        } 
+
+        // ----- 404 page not found reply -----
+        
+        #define response404 "Page does not exist."
+        __httpHeader__ (httpHeader, "404 Not found", strlen (response404), keepAlive);
+        struct iovec iov [2] = {{httpHeader, strlen (httpHeader)}, {(char *) response404, strlen (response404)}}; // HTTP header and content
+        connection->sendData (iov, 2); // send response
+        webDmesg (String ("[httpServer] don't know how to handle http request from " + String (connection->getOtherSideIP ()) + "\r\n") + httpRequest.getRequest ().toString ());
         // log_v ("[Thread:%i][Core:%i] connection has ended\n", xTaskGetCurrentTaskHandle (), xPortGetCoreID ());    
       }
+
+      void __keepAlive__ (TcpConnection *connection, __webConnection__ *webConnection) { // gives the connection back to event loop, together with its state, admission slot and statistics
+        char clientIP [16]; strcpy (clientIP, connection->getOtherSideIP ());
+        TcpAdmissionControl *admission = NULL;
+        tcpConnectionStatistics statistics;
+        int connectionSocket = connection->detach (&admission, &statistics);
+        if (connectionSocket == -1) { delete (webConnection); return; } // the connection has timed out (or reply hasn't been sent), TcpConnection will close it
+        webConnection->headerStartMillis = millis (); // the beginning of the next request may have arrived together with the previous one
+        webConnection->headerStartBytes = statistics.bytesReceived - webConnection->httpRequest.length ();
+        if (!adopt (connectionSocket, clientIP, admission, &statistics, webConnection)) { // event loop is not running any more
+          close (connectionSocket);
+          if (admission) { admission->record (&statistics); admission->release (clientIP); }
+          delete (webConnection);
+        }
+      }
       
   };
 